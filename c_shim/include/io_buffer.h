@@ -106,6 +106,8 @@ typedef struct io_buffer *_IO_BUFFER;
 #define _IO_UNGET_SLOP_FULL(io) ((io)->inptr == (io)->buffer)
 
 size_t __iob_write(_IO_BUFFER io, const char *buffer, size_t count);
+char *__iob_reserve(_IO_BUFFER io, size_t count);
+size_t __iob_commit(_IO_BUFFER io, size_t count);
 size_t __iob_read(_IO_BUFFER io, char *buffer, size_t count);
 int __iob_ungetc(_IO_BUFFER io, char c);
 
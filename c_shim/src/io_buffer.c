@@ -19,7 +19,7 @@
 #include <io_buffer.h>
 #include <stdbool.h>
 #include <stdio.h>  // For _IOFBF, _IOLBF, _IONBF.
-#include <string.h> // for memcpy.
+#include <string.h> // for memcpy and memchr.
 
 /* Assume a and b are size_t. */
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -130,6 +130,73 @@ size_t __iob_write(_IO_BUFFER io, const char *buffer, size_t count) {
   return written;
 }
 
+/**
+ * @brief Reserves space for a zero-copy write at the end of the output buffer.
+ *
+ * The caller stores up to @p count bytes at the returned address and then
+ * calls `__iob_commit()` with the number of bytes stored; the stream must not
+ * be used in between. Pending input is dropped, and the buffer is flushed
+ * first if fewer than @p count bytes are free.
+ *
+ * @param io Pointer to the I/O buffer object.
+ * @param count Number of bytes to reserve.
+ * @return Pointer into the output buffer, or NULL if the stream has no buffer,
+ * @p count is larger than the buffer, or the flush failed; in that case, use
+ * `__iob_write()`.
+ */
+char *__iob_reserve(_IO_BUFFER io, size_t count) {
+  if (count == 0 || count > io->buf_size)
+    return NULL;
+
+  // Flush input buffer if there's pending input.
+  if (io->in) {
+    if (io->ops->flush(io))
+      return NULL;
+  }
+
+  if (io->buf_size - io->out < count) {
+    if (io->ops->flush(io) || io->buf_size - io->out < count)
+      return NULL;
+  }
+
+  return &io->buffer[io->out];
+}
+
+/**
+ * @brief Completes a write started with `__iob_reserve()`.
+ *
+ * In line-buffered mode, the buffer is flushed if the committed bytes contain
+ * a newline; in unbuffered mode, it is always flushed. A fully buffered stream
+ * is flushed by the next reservation that does not fit.
+ *
+ * @param io Pointer to the I/O buffer object.
+ * @param count Number of bytes stored, at most the reserved size.
+ * @return @p count, or 0 if the flush failed (the bytes stay buffered).
+ */
+size_t __iob_commit(_IO_BUFFER io, size_t count) {
+  const char *data = &io->buffer[io->out];
+  bool flush;
+
+  io->out += count;
+
+  switch (io->mode) {
+  case _IOFBF:
+    flush = false;
+    break;
+  case _IOLBF:
+    flush = memchr(data, '\n', count) != NULL;
+    break;
+  case _IONBF:
+  default:
+    flush = true;
+  }
+
+  if (flush && io->ops->flush(io))
+    return 0;
+
+  return count;
+}
+
 /**
  * @brief Reads data from a buffered stream.
  *
@@ -1,6 +1,7 @@
 /**
  * @file iob_snprintf.c
- * @brief `snprintf` implementation using the `_IO_BUFFER` formatting backend.
+ * @brief `snprintf`/`vsnprintf` implementation using the `_IO_BUFFER`
+ *        formatting backend.
  *
  * This module adapts a custom `_IO_BUFFER`-based formatter (`iob_vsnprintf`)
  * to the standard `snprintf` interface. It provides a minimal I/O backend
@@ -63,7 +64,7 @@ static struct io_buffer_ops ops = {
 /**
  * @brief Print formatted data to a string using the `_IO_BUFFER` formatter.
  *
- * Adapts `iob_vsnprintf()` to standard `snprintf` semantics:
+ * Adapts `iob_vsnprintf()` to standard `vsnprintf` semantics:
  *
  * - Writes at most @p size bytes to @p str, including the terminating NULL.
  * - If @p size is greater than zero, the result is always NULL-terminated.
@@ -75,14 +76,14 @@ static struct io_buffer_ops ops = {
  * @param str  Destination buffer.
  * @param size Size of @p str in bytes. May be zero.
  * @param fmt  `printf`-style format string.
- * @param ...  Variadic arguments consumed according to @p fmt.
+ * @param ap   Arguments consumed according to @p fmt.
  * @return The number of characters that would have been written, not counting
  *         the terminating NULL.
  *
  * @note When @p size is zero, no bytes are written and the buffer is not
  *       dereferenced; the return value still reflects the full length.
  */
-int snprintf(char *str, size_t size, const char *fmt, ...) {
+int vsnprintf(char *str, size_t size, const char *fmt, va_list ap) {
   struct iob iob = {0};
   int ret;
 
@@ -93,14 +94,23 @@ int snprintf(char *str, size_t size, const char *fmt, ...) {
   iob.io.ops = &ops;
   // iob.io.io_unget_slop == 0, no __iob_read() and __iob_ungetc().
 
-  va_list ap;
-  va_start(ap, fmt);
   // @ret should be "would-have-written" size.
   ret = iob_vsnprintf(&iob.io, fmt, ap);
-  va_end(ap);
 
   if (size)
     *iob.str = '\0';
 
   return ret;
 }
+
+/** @brief Variadic form of @ref vsnprintf(). */
+int snprintf(char *str, size_t size, const char *fmt, ...) {
+  int ret;
+
+  va_list ap;
+  va_start(ap, fmt);
+  ret = vsnprintf(str, size, fmt, ap);
+  va_end(ap);
+
+  return ret;
+}
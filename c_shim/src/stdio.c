@@ -3,13 +3,18 @@
  * @brief Minimal implementation of stdio-style APIs for use with `_IO_BUFFER`.
  *
  * This file provides a thin wrapper over the `_IO_BUFFER` interface to
- * implement standard C stdio-like functions (`fprintf`, `fflush`, `fputc`,
- * `fwrite`, etc.) in environments where the standard `FILE` stream is not
- * available or desirable.
+ * implement standard C stdio-like functions (`printf`, `fprintf`, `fflush`,
+ * `fputc`, `fwrite`, etc.) in environments where the standard `FILE` stream is
+ * not available or desirable.
  *
  * The implementation redefines `FILE` to use `struct io_buffer`, and forwards
  * calls to internal `_iob_*` functions.
  *
+ * Every call goes through the weak `iob_get_stream()`/`iob_put_stream()`
+ * pair, so the environment can substitute its own buffered stream for
+ * `stdout` and `stderr` (e.g. one per CPU) for the duration of the call. By
+ * default, the streams are used as they are, unbuffered.
+ *
  * @author Amirreza Zarrabi
  * @date 2025
  */
@@ -20,6 +25,9 @@
 #define __DEFINED_struct__IO_FILE
 #define __DEFINED_FILE
 
+struct io_buffer *iob_get_stream(struct io_buffer *io) __attribute__((weak));
+void iob_put_stream(struct io_buffer *io) __attribute__((weak));
+
 /**
  * @typedef FILE
  * @brief Redefines FILE to point to @ref io_buffer for custom stream handling.
@@ -32,9 +40,13 @@ typedef struct io_buffer FILE;
 #include <stdio.h>
 
 int vfprintf(FILE *stream, const char *fmt, va_list ap) {
-  _IO_BUFFER io = stream;
+  _IO_BUFFER io = iob_get_stream(stream);
+  int ret;
+
+  ret = iob_vsnprintf(io, fmt, ap);
+  iob_put_stream(io);
 
-  return iob_vsnprintf(io, fmt, ap);
+  return ret;
 }
 
 int fprintf(FILE *stream, const char *fmt, ...) {
@@ -48,25 +60,50 @@ int fprintf(FILE *stream, const char *fmt, ...) {
   return ret;
 }
 
+int vprintf(const char *fmt, va_list ap) { return vfprintf(stdout, fmt, ap); }
+
+int printf(const char *fmt, ...) {
+  int ret;
+
+  va_list ap;
+  va_start(ap, fmt);
+  ret = vprintf(fmt, ap);
+  va_end(ap);
+
+  return ret;
+}
+
 int fflush(FILE *stream) {
-  _IO_BUFFER io = stream;
+  _IO_BUFFER io = iob_get_stream(stream);
+  int ret;
 
-  return io->ops->flush(io);
+  ret = io->ops->flush(io);
+  iob_put_stream(io);
+
+  return ret;
 }
 
 int fputc(int c, FILE *stream) {
   char ch = (char)c;
+  size_t n;
 
-  _IO_BUFFER io = stream;
-  if (!__iob_write(io, &ch, 1))
+  _IO_BUFFER io = iob_get_stream(stream);
+  n = __iob_write(io, &ch, 1);
+  iob_put_stream(io);
+
+  if (!n)
     return EOF;
   return c;
 }
 
 size_t fwrite(const void *ptr, size_t size, size_t nitems, FILE *stream) {
-  _IO_BUFFER io = stream;
+  _IO_BUFFER io = iob_get_stream(stream);
+  size_t ret;
+
+  ret = __iob_write(io, ptr, size * nitems);
+  iob_put_stream(io);
 
-  return __iob_write(io, ptr, size * nitems);
+  return ret;
 }
 
 /* stderr and stdout. */
@@ -75,8 +112,13 @@ size_t iob_write_stdout(struct io_buffer *io, const char *buf, size_t count)
     __attribute__((weak));
 
 static int iob_flush_stdout(struct io_buffer *io) {
-  (void)io;
-  // NOTHING TO DO.
+  // Write out what is buffered, if the stream has a buffer.
+  if (io->out) {
+    if (iob_write_stdout(io, io->buffer, io->out) != io->out)
+      return EOF;
+    io->out = 0;
+  }
+
   return 0;
 }
 
@@ -100,8 +142,13 @@ size_t iob_write_stderr(struct io_buffer *io, const char *buf, size_t count)
     __attribute__((weak));
 
 static int iob_flush_stderr(struct io_buffer *io) {
-  (void)io;
-  // NOTHING TO DO.
+  // Write out what is buffered, if the stream has a buffer.
+  if (io->out) {
+    if (iob_write_stderr(io, io->buffer, io->out) != io->out)
+      return EOF;
+    io->out = 0;
+  }
+
   return 0;
 }
 
@@ -121,6 +168,14 @@ static struct io_buffer __stderr = {
 
 FILE *const stderr = &__stderr;
 
+/* Default hooks. */
+
+struct io_buffer *iob_get_stream(struct io_buffer *io) {
+  return io;
+}
+
+void iob_put_stream(struct io_buffer *io) { (void)io; }
+
 /* Default writers. */
 
 size_t iob_write_stdout(struct io_buffer *io, const char *buf, size_t count) {
@@ -11,8 +11,10 @@
  * formatting, and `hh`, `h`, `l`, `ll` length modifiers.
  *
  * @note Floating point formatting is not supported.
- * @note All output is written to a user-defined `_IO_BUFFER` via `__iob_write`.
- * @note It is not thread-safe.
+ * @note Output is stored directly in the `_IO_BUFFER` buffer with
+ *       `__iob_reserve`/`__iob_commit`, a run at a time (a literal run of the
+ *       format, a padding run, a number or a string); streams without a
+ *       buffer get the same runs through `__iob_write`.
  *
  * @author Amirreza Zarrabi
  * @date 2025
@@ -76,32 +78,65 @@
 enum { RANK_CHAR = -2, RANK_SHORT, RANK_INT, RANK_LONG, RANK_LLONG };
 
 /**
- * @brief Running count of bytes written by `iob_vsnprintf`.
+ * @struct out
+ * @brief Output stream and running count of bytes of one `iob_vsnprintf` call.
  */
-static int iob_count;
+struct out {
+  _IO_BUFFER io;
+  int count;
+};
 
 /**
- * @brief Writes a single character to the buffer.
+ * @brief Writes @p len bytes of @p s to the buffer in one run.
  */
-static void put_char(_IO_BUFFER io, char c) {
-  __iob_write(io, &c, 1);
-  iob_count++;
+static void put_str(struct out *o, const char *s, size_t len) {
+  char *p = __iob_reserve(o->io, len);
+
+  if (p) {
+    memcpy(p, s, len);
+    __iob_commit(o->io, len);
+  } else if (len) {
+    __iob_write(o->io, s, len);
+  }
+
+  o->count += len;
 }
 
+/**
+ * @brief Writes a single character to the buffer.
+ */
+static void put_char(struct out *o, char c) { put_str(o, &c, 1); }
+
 /**
  * @brief Pads the output with a specific character.
  *
- * @param io Destination I/O buffer.
+ * @param o Destination output.
  * @param left If true, pad to the left (right-align).
  * @param c Padding character (typically ' ' or '0').
  * @param width Desired total field width.
  * @param len Actual length of printed content.
  */
-static void pad(_IO_BUFFER io, bool left, char c, int width, int len) {
-  int i;
-  if (!left && width > len) {
-    for (i = width - len; i > 0; i--)
-      put_char(io, c);
+static void pad(struct out *o, bool left, char c, int width, int len) {
+  if (!left || width <= len)
+    return;
+
+  size_t n = width - len;
+  char *p = __iob_reserve(o->io, n);
+
+  if (p) {
+    memset(p, c, n);
+    __iob_commit(o->io, n);
+    o->count += n;
+    return;
+  }
+
+  // No buffer: write the padding in chunks.
+  char chunk[16];
+  memset(chunk, c, sizeof(chunk));
+  while (n) {
+    size_t m = n < sizeof(chunk) ? n : sizeof(chunk);
+    put_str(o, chunk, m);
+    n -= m;
   }
 }
 
@@ -112,7 +147,7 @@ static const char *digit_table(unsigned flags) {
 /**
  * @brief Formats an integer and writes it to the buffer.
  */
-static void format_integer(_IO_BUFFER io, unsigned long long value,
+static void format_integer(struct out *o, unsigned long long value,
                            unsigned flags, int base, int width, int precision) {
   char buf[65];
   int pos = 0;
@@ -157,15 +192,19 @@ static void format_integer(_IO_BUFFER io, unsigned long long value,
 
   int total_len = prefix_len + pos;
 
-  pad(io, !(flags & FL_MINUS), (flags & FL_ZERO) ? '0' : ' ', width, total_len);
+  // Prefix and digits in output order, written as one run.
+  char text[sizeof(prefix) + sizeof(buf)];
+  int len = 0;
 
   for (int i = 0; i < prefix_len; i++)
-    put_char(io, prefix[i]);
+    text[len++] = prefix[i];
 
   while (pos--)
-    put_char(io, buf[pos]);
+    text[len++] = buf[pos];
 
-  pad(io, (flags & FL_MINUS), ' ', width, total_len);
+  pad(o, !(flags & FL_MINUS), (flags & FL_ZERO) ? '0' : ' ', width, total_len);
+  put_str(o, text, len);
+  pad(o, (flags & FL_MINUS), ' ', width, total_len);
 }
 
 /**
@@ -218,7 +257,7 @@ static void get_arg_int(va_list *ap, int rank, unsigned flags,
  *
  * Handles width, alignment, and precision.
  */
-static void format_string(_IO_BUFFER io, const char *s, unsigned flags,
+static void format_string(struct out *o, const char *s, unsigned flags,
                           int width, int precision) {
   int len = s ? strlen(s) : 6;
 
@@ -228,10 +267,9 @@ static void format_string(_IO_BUFFER io, const char *s, unsigned flags,
   if (precision >= 0 && len > precision)
     len = precision;
 
-  pad(io, !(flags & FL_MINUS), ' ', width, len);
-  __iob_write(io, s, len);
-  iob_count += len;
-  pad(io, (flags & FL_MINUS), ' ', width, len);
+  pad(o, !(flags & FL_MINUS), ' ', width, len);
+  put_str(o, s, len);
+  pad(o, (flags & FL_MINUS), ' ', width, len);
 }
 
 /**
@@ -247,8 +285,8 @@ static void format_string(_IO_BUFFER io, const char *s, unsigned flags,
  * format).
  */
 int iob_vsnprintf(_IO_BUFFER io, const char *fmt, va_list ap_src) {
+  struct out o = {io, 0};
   va_list ap;
-  iob_count = 0;
   va_copy(ap, ap_src);
 
   unsigned flags = 0;
@@ -257,7 +295,11 @@ int iob_vsnprintf(_IO_BUFFER io, const char *fmt, va_list ap_src) {
 
   while (*p) {
     if (*p != '%') {
-      put_char(io, *p++);
+      // Copy the literal run up to the next conversion.
+      const char *run = p;
+      while (*p && *p != '%')
+        p++;
+      put_str(&o, run, p - run);
       continue;
     }
 
@@ -329,13 +371,13 @@ int iob_vsnprintf(_IO_BUFFER io, const char *fmt, va_list ap_src) {
     case 'u': {
       unsigned long long val;
       get_arg_int(&ap, rank, flags, &val);
-      format_integer(io, val, flags, 10, width, precision);
+      format_integer(&o, val, flags, 10, width, precision);
       break;
     }
     case 'o': {
       unsigned long long val;
       get_arg_int(&ap, rank, flags, &val);
-      format_integer(io, val, flags, 8, width, precision);
+      format_integer(&o, val, flags, 8, width, precision);
       break;
     }
     case 'X':
@@ -343,26 +385,26 @@ int iob_vsnprintf(_IO_BUFFER io, const char *fmt, va_list ap_src) {
     case 'x': {
       unsigned long long val;
       get_arg_int(&ap, rank, flags, &val);
-      format_integer(io, val, flags, 16, width, precision);
+      format_integer(&o, val, flags, 16, width, precision);
       break;
     }
     case 'P':
       flags |= FL_UPPER;
     case 'p':
       flags |= FL_HASH;
-      format_integer(io, (unsigned long long)va_arg(ap, void *), flags, 16,
+      format_integer(&o, (unsigned long long)va_arg(ap, void *), flags, 16,
                      width, sizeof(void *) * 2);
       break;
     case 'c': {
       char c = (char)va_arg(ap, int);
-      format_string(io, &c, flags, width, 1);
+      format_string(&o, &c, flags, width, 1);
       break;
     }
     case 's':
-      format_string(io, va_arg(ap, const char *), flags, width, precision);
+      format_string(&o, va_arg(ap, const char *), flags, width, precision);
       break;
     case '%':
-      put_char(io, '%');
+      put_char(&o, '%');
       break;
     default:
       // Unsupported format specifier
@@ -372,5 +414,5 @@ int iob_vsnprintf(_IO_BUFFER io, const char *fmt, va_list ap_src) {
 
   va_end(ap);
 
-  return iob_count;
+  return o.count;
 }
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""Decode xino trace dumps (see ukernel/include/trace.hpp).
+
+`xino::trace::dump()` prints the per-CPU trace rings as `xino-trace:` lines:
+
+    xino-trace: v1 <CNTFRQ> <nr_cpus>
+    xino-trace: <cpu> <ts hex> <id hex> [<arg hex> ...]
+    xino-trace: end
+
+The ID of an entry is the offset of its `<phase><name>\\0<format>\\0` string
+in the `.trace_fmt` section of ukernel.elf. This tool reads the section,
+formats the arguments with the printf-style format, and writes a Chrome
+trace JSON file (open it in https://ui.perfetto.dev or chrome://tracing) or
+plain text.
+
+    xino_trace.py ukernel.elf console.log -o trace.json
+    xino_trace.py ukernel.elf console.log --text
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+MARKER = "xino-trace:"
+
+
+def read_section(elf_path, name):
+    """Return the contents of section `name` of a little-endian ELF64 file."""
+    with open(elf_path, "rb") as f:
+        data = f.read()
+
+    if data[:4] != b"\x7fELF" or data[4] != 2 or data[5] != 1:
+        sys.exit(f"{elf_path}: not a little-endian ELF64 file")
+
+    shoff, = struct.unpack_from("<Q", data, 0x28)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x3a)
+
+    def section(i):
+        # sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size.
+        return struct.unpack_from("<IIQQQQ", data, shoff + i * shentsize)
+
+    strtab = section(shstrndx)
+    for i in range(shnum):
+        sh = section(i)
+        start = strtab[4] + sh[0]
+        sh_name = data[start:data.index(b"\0", start)].decode()
+        if sh_name == name:
+            return data[sh[4]:sh[4] + sh[5]]
+
+    sys.exit(f"{elf_path}: no {name} section (built without UKERNEL_TRACE?)")
+
+
+def trace_point(fmts, trace_id):
+    """Return (phase, name, format) of the trace point at `trace_id`."""
+    end = fmts.index(b"\0", trace_id)
+    fmt_end = fmts.index(b"\0", end + 1)
+    head = fmts[trace_id:end].decode()
+
+    return head[0], head[1:], fmts[end + 1:fmt_end].decode()
+
+
+CONV = re.compile(
+    r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcps%])")
+
+
+def format_args(fmt, args):
+    """printf-style formatting of raw 64-bit argument words."""
+    args = list(args)
+
+    def conv(m):
+        flags, width, prec, length, spec = m.groups()
+        if spec == "%":
+            return "%"
+
+        word = args.pop(0) if args else 0
+        bits = {"hh": 8, "h": 16, None: 32}.get(length, 64)
+        word &= (1 << bits) - 1
+
+        if spec in "di" and word >> (bits - 1):
+            word -= 1 << bits
+        if spec == "c":
+            return chr(word & 0xff)
+        if spec in "ps":
+            # Pointers (and strings, which live in target memory) as hex.
+            return f"{word:#x}"
+
+        py = "%" + flags + width + ("." + prec if prec else "") + \
+            ("d" if spec in "iu" else spec)
+        return py % word
+
+    return CONV.sub(conv, fmt)
+
+
+def parse_dump(lines):
+    """Yield (freq, entries) for every dump found in the console log."""
+    freq, entries = None, []
+
+    for line in lines:
+        pos = line.find(MARKER)
+        if pos < 0:
+            continue
+
+        fields = line[pos + len(MARKER):].split()
+        if not fields:
+            continue
+
+        if fields[0] == "v1":
+            freq, entries = int(fields[1]), []
+        elif fields[0] == "end":
+            if freq is not None:
+                yield freq, entries
+            freq = None
+        elif freq is not None:
+            cpu = int(fields[0])
+            ts, trace_id = int(fields[1], 16), int(fields[2], 16)
+            entries.append((ts, cpu, trace_id,
+                            [int(a, 16) for a in fields[3:]]))
+
+
+def chrome_trace(fmts, freq, entries):
+    events = []
+    t0 = min((e[0] for e in entries), default=0)
+
+    for cpu in sorted({e[1] for e in entries}):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                       "tid": cpu, "args": {"name": f"cpu{cpu}"}})
+
+    for ts, cpu, trace_id, args in entries:
+        phase, name, fmt = trace_point(fmts, trace_id)
+        ev = {"name": name, "ph": phase, "pid": 0, "tid": cpu,
+              "ts": (ts - t0) * 1e6 / freq}
+        if phase == "i":
+            ev["s"] = "t"
+        if fmt:
+            ev["args"] = {"msg": format_args(fmt, args)}
+        events.append(ev)
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def text_trace(fmts, freq, entries):
+    t0 = min((e[0] for e in entries), default=0)
+
+    for ts, cpu, trace_id, args in entries:
+        phase, name, fmt = trace_point(fmts, trace_id)
+        us = (ts - t0) * 1e6 / freq
+        msg = f": {format_args(fmt, args)}" if fmt else ""
+        yield f"{us:14.3f} us cpu{cpu} {phase} {name}{msg}"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf", help="ukernel.elf the dump was taken from")
+    ap.add_argument("log", help="console log with the dump ('-' for stdin)")
+    ap.add_argument("-o", "--output", default="-",
+                    help="output file (default: stdout)")
+    ap.add_argument("--text", action="store_true",
+                    help="write text instead of Chrome trace JSON")
+    ap.add_argument("--dump", type=int, default=-1,
+                    help="which dump of the log to decode (default: last)")
+    opts = ap.parse_args()
+
+    fmts = read_section(opts.elf, ".trace_fmt")
+
+    src = sys.stdin if opts.log == "-" else open(opts.log, errors="replace")
+    with src:
+        dumps = list(parse_dump(src))
+    if not dumps:
+        sys.exit(f"{opts.log}: no complete trace dump")
+
+    freq, entries = dumps[opts.dump]
+    # Rings are dumped per CPU; merge them by time (stable for equal stamps).
+    entries.sort(key=lambda e: e[0])
+
+    out = sys.stdout if opts.output == "-" else open(opts.output, "w")
+    with out:
+        if opts.text:
+            for line in text_trace(fmts, freq, entries):
+                print(line, file=out)
+        else:
+            json.dump(chrome_trace(fmts, freq, entries), out)
+            print(file=out)
+
+
+if __name__ == "__main__":
+    main()
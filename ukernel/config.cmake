@@ -4,6 +4,15 @@
 
 set(UKERNEL_SMP FALSE CACHE BOOL "Multicore uKernel")
 
+set(UKERNEL_BENCH FALSE CACHE BOOL "Run in-kernel benchmarks from main()")
+
+set(UKERNEL_LOCKSTAT FALSE CACHE BOOL "Collect spin_lock contention statistics")
+
+set(UKERNEL_TRACE FALSE CACHE BOOL "Record trace points into per-CPU rings")
+
+set(UKERNEL_KLOG_DUMP FALSE CACHE BOOL
+  "Print the retained kernel log of every CPU at the end of main()")
+
 set(UKERNEL_PROFILE "standalone" CACHE STRING
   "Kernel profile: standalone (4K + 39-bit VA) or embedded (16K + 36-bit VA)")
 set_property(CACHE UKERNEL_PROFILE PROPERTY STRINGS standalone embedded)
@@ -22,13 +31,28 @@ set(UKERNEL_KIMAGE_SLOT_SIZE "0x20000000" CACHE INTERNAL
 set(UKERNEL_DEVMAP_SLOT_SIZE "0x4000000" CACHE INTERNAL
   "Device mapping size" FORCE)  # 64 Mb.
 
-set(UKERNEL_BOOT_HEAP_SIZE "0x2000000" CACHE INTERNAL
-  "uKernel heap used during boot" FORCE) # 32 Mb.
+set(UKERNEL_VMALLOC_SLOT_SIZE "0x10000000" CACHE INTERNAL
+  "vmalloc mapping size" FORCE) # 256 Mb.
+
+set(UKERNEL_BOOT_HEAP_SIZE "0x2000000" CACHE STRING
+  "uKernel heap used during boot, until the main allocator takes over") # 32 Mb.
+
+set(UKERNEL_PERCPU_DYN_SIZE "0x4000" CACHE STRING
+  "Per-CPU bytes reserved for alloc_percpu() in each CPU area") # 16 Kb.
+
+set(UKERNEL_DMA_POOL_SIZE "0x100000" CACHE STRING
+  "Non-cacheable pool for coherent DMA memory and bounce buffers") # 1 Mb.
+
+set(UKERNEL_KLOG_RECORDS "128" CACHE STRING
+  "Kernel log records per CPU (a power of two, 128 bytes each)")
+
+set(UKERNEL_TRACE_ENTRIES "1024" CACHE STRING
+  "Trace entries per CPU with UKERNEL_TRACE (a power of two, 64 bytes each)")
 
 # Platform:
 
 set(UKERNEL_PLATFORM "rock5b" CACHE STRING "Target platform")
-set_property(CACHE UKERNEL_PLATFORM PROPERTY STRINGS rock5b)
+set_property(CACHE UKERNEL_PLATFORM PROPERTY STRINGS rock5b qemu_virt)
 
 # Platform configurations
 
@@ -40,6 +64,20 @@ if(UKERNEL_PLATFORM STREQUAL "rock5b")
   #  -- Drivers --
   set(UKERNEL_UART_DRIVER  "DW_APB" CACHE INTERNAL "UART driver" FORCE)
   set(UKERNEL_UART_BASE "0xfeb50000UL" CACHE INTERNAL "UART base" FORCE)
+  set(UKERNEL_GICD_BASE "0xfe600000UL" CACHE INTERNAL "GICD base" FORCE)
+  set(UKERNEL_GICR_BASE "0xfe680000UL" CACHE INTERNAL "GICR base" FORCE)
+  set(UKERNEL_GICR_SIZE "0x100000" CACHE INTERNAL "GICR size" FORCE)
+# Platform == QEMU virt (GICv3, see docs/qemu_virt.md)
+elseif(UKERNEL_PLATFORM STREQUAL "qemu_virt")
+  set(UKERNEL_BASE "0x40080000UL" CACHE STRING "uKernel base")
+  set(UKERNEL_STACK_SIZE "0x4000" CACHE STRING
+    "Stack size (16-byte aligned)") # 16 KB.
+  #  -- Drivers --
+  set(UKERNEL_UART_DRIVER  "PL011" CACHE INTERNAL "UART driver" FORCE)
+  set(UKERNEL_UART_BASE "0x09000000UL" CACHE INTERNAL "UART base" FORCE)
+  set(UKERNEL_GICD_BASE "0x08000000UL" CACHE INTERNAL "GICD base" FORCE)
+  set(UKERNEL_GICR_BASE "0x080a0000UL" CACHE INTERNAL "GICR base" FORCE)
+  set(UKERNEL_GICR_SIZE "0xf60000" CACHE INTERNAL "GICR size" FORCE)
 else()
   message(FATAL_ERROR "Unknown UKERNEL_PLATFORM='${UKERNEL_PLATFORM}'")
 endif()
@@ -47,3 +85,6 @@ endif()
 # CPU configurations
 
 set(UKERNEL_CACHE_LINE "64" CACHE STRING "")
+
+set(UKERNEL_NR_CPUS "64" CACHE STRING
+  "Maximum number of CPUs (size of xino::smp::cpumask)")
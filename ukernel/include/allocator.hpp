@@ -35,6 +35,7 @@
 #include <mm.hpp>
 #include <mm_va_layout.hpp>
 #include <stdexcept>
+#include <sync.hpp> // spin_lock
 
 namespace xino {
 
@@ -90,10 +91,41 @@ namespace xino::allocator {
   return pages_to_order(size / xino::mm::va_layout::granule_size());
 }
 
+/**
+ * @brief Convert a size in bytes to the smallest order covering it.
+ *
+ * @param size Size in bytes.
+ * @return The smallest order whose block size is at least @p size.
+ */
+[[nodiscard]] constexpr unsigned size_to_order_up(std::size_t size) noexcept {
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+  const std::size_t pages{(size + gs - 1) / gs};
+
+  unsigned order{pages_to_order(pages)};
+  if (order_to_pages(order) < pages)
+    order++;
+
+  return order;
+}
+
 /* Binary tree buddy allocator.  */
 
-template <unsigned Order> class buddy {
+/**
+ * @brief Binary tree buddy allocator over a page-aligned address interval.
+ *
+ * @tparam Order Maximum order; the allocator represents at most `2^Order`
+ *         pages.
+ * @tparam Addr Address type managed by the allocator. Physical page pools use
+ *         the default `xino::mm::phys_addr`; the same allocator also manages
+ *         virtual address windows (e.g. `xino::mm::virt_addr` for devmap),
+ *         where blocks being naturally aligned to their size is what allows
+ *         block mappings.
+ */
+template <unsigned Order, typename Addr = xino::mm::phys_addr> class buddy {
 public:
+  /** @brief Address type managed by the allocator. */
+  using addr_t = Addr;
+
   /**
    * @brief Initialize the buddy allocator over a physical memory interval.
    *
@@ -116,8 +148,12 @@ public:
    *  - Clears internal bitmaps (`free_bits[]`/`split_bits[]`).
    *  - Calls the internal initializer to build the initial free structure.
    *
+   * With @p populate false, the pool starts fully allocated and free memory
+   * is added later with @ref add_range (e.g. a zone spanning holes).
+   *
    * @param pa Physical start address of the candidate pool.
    * @param size Size (in bytes) of the candidate pool.
+   * @param populate Whether the whole pool starts free (default).
    *
    * @retval `xino::error_nr::ok` Success.
    * @retval `xino::error_nr::overflow` Address overflow.
@@ -130,11 +166,11 @@ public:
    * boot_buddy.init(pool_base, pool_size);
    * @endcode
    */
-  [[nodiscard]] xino::error_t init(xino::mm::phys_addr pa,
-                                   std::size_t size) noexcept {
+  [[nodiscard]] xino::error_t init(addr_t pa, std::size_t size,
+                                   bool populate = true) noexcept {
     // Reset state to "not initialized".
-    base_pa = xino::mm::phys_addr{0};
-    end_pa = xino::mm::phys_addr{0};
+    base_pa = addr_t{};
+    end_pa = addr_t{};
     pool_pages = 0;
     max_ord = 0;
 
@@ -144,7 +180,7 @@ public:
       split_bits[i] = 0;
     }
 
-    return buddy_init(pa, size);
+    return buddy_init(pa, size, populate);
   }
 
   [[nodiscard]] bool is_ok() const noexcept {
@@ -162,9 +198,9 @@ public:
    * @throws `std::runtime_error` if the underlying buddy allocator failed.
    *         The exception message is `buddy_alloc_pages`.
    */
-  [[nodiscard]] xino::mm::phys_addr alloc_pages(unsigned order) {
-    const xino::mm::phys_addr pa{buddy_alloc_pages(order)};
-    if (pa != xino::mm::phys_addr{0})
+  [[nodiscard]] addr_t alloc_pages(unsigned order) {
+    const addr_t pa{buddy_alloc_pages(order)};
+    if (pa != addr_t{})
       return pa;
 
     throw std::runtime_error{"buddy_alloc_pages"};
@@ -176,18 +212,77 @@ public:
    * @param nothrow Tag selecting the non-throwing overload.
    * @param order Allocation order (base-2 exponent).
    * @return Physical base address of the allocated page block on success;
-   *         otherwise `xino::mm::phys_addr{0}` (see @ref buddy_alloc_pages).
+   *         otherwise `addr_t{}` (see @ref buddy_alloc_pages).
    */
-  [[nodiscard]] xino::mm::phys_addr alloc_pages(const xino::nothrow_t &,
-                                                unsigned order) noexcept {
+  [[nodiscard]] addr_t alloc_pages(const xino::nothrow_t &,
+                                   unsigned order) noexcept {
     return buddy_alloc_pages(order);
   }
 
-  void free_pages(xino::mm::phys_addr pa, unsigned order) noexcept {
+  void free_pages(addr_t pa, unsigned order) noexcept {
     buddy_free_pages(pa, order);
   }
   ///@}
 
+  /**
+   * @brief Release `[pa, pa + size)` into the allocator.
+   *
+   * The range is shrunk to whole pages and clipped to the pool, then freed as
+   * the largest naturally aligned blocks that fit, so populating a large range
+   * costs one free per block rather than per page.
+   *
+   * @pre No page of the range is free already.
+   */
+  void add_range(addr_t pa, std::size_t size) noexcept {
+    using av_t = typename addr_t::value_type;
+
+    if (!is_ok() || pa + size < pa)
+      return;
+
+    addr_t it{pa.align_up(page_size)};
+    addr_t end{(pa + size).align_down(page_size)};
+    // Clip to `[base_pa, end_pa)`.
+    if (it < base_pa)
+      it = base_pa;
+    if (end > end_pa)
+      end = end_pa;
+
+    while (it < end) {
+      const std::size_t page_idx{static_cast<std::size_t>(
+          (static_cast<av_t>(it) - static_cast<av_t>(base_pa)) / page_size)};
+      const std::size_t left{static_cast<std::size_t>(
+          (static_cast<av_t>(end) - static_cast<av_t>(it)) / page_size)};
+
+      // Largest block aligned at `page_idx` that fits.
+      unsigned o{0};
+      while (o < max_ord && (page_idx & (order_to_pages(o + 1) - 1)) == 0 &&
+             order_to_pages(o + 1) <= left)
+        o++;
+
+      buddy_free_pages(it, o);
+      it += order_to_pages(o) * page_size;
+    }
+  }
+
+  /**
+   * @brief Call `f(pa, order)` for every free block.
+   *
+   * @tparam F Callable with signature `void(addr_t, unsigned)`.
+   */
+  template <typename F> void for_each_free(F &&f) const {
+    for (std::size_t w{0}; w < word_count; w++) {
+      for (std::uint64_t v{free_bits[w]}; v != 0; v &= v - 1) {
+        const std::size_t node{(w * word_bits) + ctz64(v)};
+        // `level = floor(log2(node))`.
+        const unsigned level{
+            static_cast<unsigned>(63 - __builtin_clzll(node))};
+        const unsigned order{Order - level};
+
+        f(base_pa + (node_to_page_index(node, order) * page_size), order);
+      }
+    }
+  }
+
 private:
   /**
    * @brief Initialize the buddy allocator pool over a physical address range.
@@ -203,23 +298,24 @@ private:
    *
    * @param pa Starting physical address of the candidate pool.
    * @param size Size in bytes of the candidate pool.
+   * @param populate Whether to free every page of the pool.
    *
    * @retval `xino::error_nr::ok` Success.
    * @retval `xino::error_nr::overflow` Address overflow.
    * @retval `xino::error_nr::invalid` The aligned region is empty or the pool
    *         contains more pages than the allocator can represent.
    */
-  [[nodiscard]] xino::error_t buddy_init(xino::mm::phys_addr pa,
-                                         std::size_t size) {
-    using av_t = xino::mm::phys_addr::value_type;
+  [[nodiscard]] xino::error_t buddy_init(addr_t pa, std::size_t size,
+                                         bool populate) {
+    using av_t = typename addr_t::value_type;
 
     // Check for overflow.
     if (pa + size < pa)
       return xino::error_nr::overflow;
 
     // Construct `[base, end)` as a page aligned range.
-    xino::mm::phys_addr base{pa.align_up(page_size)};
-    xino::mm::phys_addr end{(pa + size).align_down(page_size)};
+    addr_t base{pa.align_up(page_size)};
+    addr_t end{(pa + size).align_down(page_size)};
     // Check if at least single page available.
     if (end <= base)
       return xino::error_nr::invalid;
@@ -240,10 +336,12 @@ private:
     pool_pages = pages;
     max_ord = odr < Order ? odr : Order;
 
+    if (!populate)
+      return xino::error_nr::ok;
+
     // Free each page. The coalescing logic merges them into blocks, building
     // the initial free structure.
-    for (xino::mm::phys_addr it :
-         xino::mm::phys_addr_range(base, end, page_size))
+    for (addr_t it : xino::mm::address_range<addr_t>(base, end, page_size))
       buddy_free_pages(it, 0);
 
     return xino::error_nr::ok;
@@ -253,13 +351,13 @@ private:
    * @brief Allocate a contiguous block of pages from the buddy allocator.
    *
    * @param order Buddy order of the block.
-   * @return Physical address, or `xino::mm::phys_addr{0}` if the allocator is
-   *         not initialized, @p order exceeds `max_ord`, or no suitable free
-   *         block exists.
+   * @return Block base address, or `addr_t{}` if the allocator is not
+   *         initialized, @p order exceeds `max_ord`, or no suitable free block
+   *         exists.
    */
-  [[nodiscard]] xino::mm::phys_addr buddy_alloc_pages(unsigned order) {
+  [[nodiscard]] addr_t buddy_alloc_pages(unsigned order) {
     if (!is_ok() || order > max_ord)
-      return xino::mm::phys_addr{0};
+      return addr_t{};
 
     // Find smallest order >= requested order with any free node.
     unsigned o = order;
@@ -272,7 +370,7 @@ private:
 
     // No free block found.
     if (node == 0)
-      return xino::mm::phys_addr{0};
+      return addr_t{};
 
     // Consume that free node and split down.
     clear_bit(free_bits, node);
@@ -296,8 +394,8 @@ private:
    * @param pa Physical start address of the block to free.
    * @param order Buddy order of the block.
    */
-  void buddy_free_pages(xino::mm::phys_addr pa, unsigned order) {
-    using av_t = xino::mm::phys_addr::value_type;
+  void buddy_free_pages(addr_t pa, unsigned order) {
+    using av_t = typename addr_t::value_type;
 
     if (!is_ok() || order > max_ord)
       return;
@@ -362,10 +460,10 @@ private:
   static constexpr std::size_t page_size{xino::mm::va_layout::granule_size()};
 
   // Pool state.
-  xino::mm::phys_addr base_pa; // Start physical address (inclusive).
-  xino::mm::phys_addr end_pa;  // End physical address (exclusive)
-  std::size_t pool_pages;      // Number of pages in the pool.
-  unsigned max_ord;            // Max order supported (maybe < `Order`).
+  addr_t base_pa;         // Start address (inclusive).
+  addr_t end_pa;          // End address (exclusive)
+  std::size_t pool_pages; // Number of pages in the pool.
+  unsigned max_ord;       // Max order supported (maybe < `Order`).
 
   // Binary tree state.
   std::uint64_t free_bits[word_count];
@@ -539,6 +637,85 @@ using boot_allocator_t = xino::allocator::buddy<boot_allocator_max_order>;
 
 extern boot_allocator_t boot_allocator;
 
+/* Main page allocator. */
+
+/** @brief Order of a zone; a zone spans 1GB of physical address space. */
+constexpr unsigned zone_max_order{size_to_order(std::size_t{1} << 30)};
+
+/** @brief Buddy allocator of a single zone. */
+using zone_allocator_t = xino::allocator::buddy<zone_max_order>;
+
+/**
+ * @class page_allocator_t
+ * @brief Physical page allocator used once RAM is known.
+ *
+ * Until @ref handoff, requests are served by @ref boot_allocator. The handoff
+ * builds one zone per 1GB aligned window of RAM (a `zone_allocator_t` stored
+ * in memblock-allocated memory) and populates the zones from memblock's free
+ * ranges and the free blocks of the boot heap. Boot-heap pages still in use
+ * are adopted: they are covered by a zone but not free, so freeing them later
+ * returns them to the main allocator.
+ *
+ * Users that must keep working across the handoff (page tables, vmalloc,
+ * `alloc_page()`) allocate through this object rather than @ref boot_allocator.
+ */
+class page_allocator_t {
+public:
+  /**
+   * @brief Switch from the boot heap to zones covering memblock's memory.
+   *
+   * Also initializes the memmap over all RAM banks. Must run on the boot CPU,
+   * after RAM banks and reservations are registered in memblock.
+   *
+   * @retval `xino::error_nr::ok` Success.
+   * @retval `xino::error_nr::invalid` No memory registered in memblock.
+   * @retval `xino::error_nr::nomem` Failed to allocate the memmap or a zone.
+   */
+  [[nodiscard]] xino::error_t handoff() noexcept;
+
+  /**
+   * @brief Allocate `2^order` physically contiguous pages.
+   *
+   * @return Physical base address, or `xino::mm::phys_addr{}` on failure.
+   *         handoff() reserves page 0, so a successful allocation is never at
+   *         `PA{0}`, even when RAM starts at 0.
+   */
+  [[nodiscard]] xino::mm::phys_addr alloc_pages(const xino::nothrow_t &,
+                                                unsigned order) noexcept;
+
+  /**
+   * @brief Free pages returned by @ref alloc_pages().
+   *
+   * Pages outside every zone are not freed; the call is reported on
+   * `stderr`.
+   */
+  void free_pages(xino::mm::phys_addr pa, unsigned order) noexcept;
+
+private:
+  /** @brief Maximum number of zones (i.e. GBs of physical address space). */
+  static constexpr std::size_t max_zones{64};
+
+  /** @brief Size in bytes of the window covered by a zone. */
+  static constexpr std::size_t zone_size{order_to_pages(zone_max_order) *
+                                         xino::mm::va_layout::granule_size()};
+
+  struct zone {
+    xino::mm::phys_addr base; // Window base, `zone_size` aligned.
+    xino::mm::phys_addr pa;   // Physical address of the `zone_allocator_t`.
+  };
+
+  [[nodiscard]] zone_allocator_t *find_zone(xino::mm::phys_addr pa) noexcept;
+
+  void add_free(xino::mm::phys_addr pa, std::size_t size) noexcept;
+
+  bool main_ready{false};
+  zone zones[max_zones]{};
+  std::size_t nr_zones{0};
+  xino::sync::spin_lock lock{"page_allocator"};
+};
+
+extern page_allocator_t page_allocator;
+
 } // namespace xino::allocator
 
 #endif // __ALLOCATOR_HPP__
\ No newline at end of file
@@ -0,0 +1,63 @@
+/**
+ * @file bench.hpp
+ * @brief In-kernel micro-benchmarks (built with `UKERNEL_BENCH`).
+ *
+ * Every participating CPU calls the same benchmark entry with the same number
+ * of CPUs; the CPUs meet at a barrier before each phase, and CPU0 prints the
+ * results on stdout.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __BENCH_HPP__
+#define __BENCH_HPP__
+
+namespace xino::bench {
+
+/**
+ * @brief Lock contention benchmark: `spin_lock` vs `queued_spin_lock`.
+ *
+ * For a fixed time, each CPU repeatedly acquires the lock, updates shared
+ * data, releases it and waits a little. Reports per-CPU acquisitions (the
+ * fairness) and the average and worst acquisition latency, from `CNTVCT_EL0`.
+ *
+ * @param ncpu Number of CPUs calling lock_bench() (at least 1).
+ */
+void lock_bench(unsigned ncpu) noexcept;
+
+/**
+ * @brief Read-side scalability benchmark: `rw_spin_lock` vs RCU.
+ *
+ * For a fixed time, every CPU reads a shared object, and CPU0 also updates
+ * it every `update_every` reads (in place under the write lock, or by
+ * publishing a copy and freeing the old one with `call_rcu()`). Each CPU
+ * reports a quiescent state every `qs_every` reads. Reports per-CPU and
+ * total reads.
+ *
+ * @param ncpu Number of CPUs calling rcu_bench() (at least 1).
+ */
+void rcu_bench(unsigned ncpu) noexcept;
+
+/**
+ * @brief Cross-CPU function call benchmark.
+ *
+ * Unlike the other benchmarks, only one CPU calls ipi_bench(); the other
+ * online CPUs serve the calls with IRQs unmasked. Reports the round-trip
+ * latency of a synchronous call to each CPU, and the cost of asynchronous
+ * broadcasts with the number of calls and SGIs each CPU took (calls that
+ * find a target's queue non-empty do not send an SGI).
+ */
+void ipi_bench() noexcept;
+
+/**
+ * @brief Run all the benchmarks on the online CPUs.
+ *
+ * The secondaries run lock_bench() and rcu_bench() from a cross-CPU function
+ * call, while CPU0 runs them from the caller and then runs ipi_bench().
+ */
+void run_all() noexcept;
+
+} // namespace xino::bench
+
+#endif // __BENCH_HPP__
@@ -0,0 +1,39 @@
+/**
+ * @file cache.hpp
+ * @brief Cache-line placement of shared globals.
+ *
+ * Globals written often and globals read on every hot path must not share a
+ * cache line, otherwise every write invalidates the line in all other cores
+ * (false sharing). Two data sections group such globals (see linker.ldspp):
+ *
+ *  - `__read_mostly`: written during boot or rarely (layout parameters,
+ *    device bases, configuration); packed together in `.data..read_mostly`,
+ *    whose bounds are cache-line aligned.
+ *  - `__cacheline_aligned`: written frequently (locks, allocator state); each
+ *    object starts its own cache line in `.data..cacheline_aligned`.
+ *
+ * @par Example
+ * @code
+ * __read_mostly constinit bool use_mapping{};
+ * __cacheline_aligned constinit xino::sync::spin_lock lock{};
+ * @endcode
+ *
+ * @note Objects in these sections are in `.data`, not `.bss`; keep large
+ *       zero-initialized objects out of them.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __CACHE_HPP__
+#define __CACHE_HPP__
+
+#include <config.h> // UKERNEL_CACHE_LINE
+
+#define __read_mostly [[gnu::section(".data..read_mostly")]]
+
+#define __cacheline_aligned                                                    \
+  [[gnu::section(".data..cacheline_aligned"),                                  \
+    gnu::aligned(UKERNEL_CACHE_LINE)]]
+
+#endif // __CACHE_HPP__
@@ -0,0 +1,93 @@
+/**
+ * @file cache_maint.hpp
+ * @brief Data and instruction cache maintenance.
+ *
+ * The line sizes are discovered at runtime from `CTR_EL0` (`DminLine`,
+ * `IminLine` and `CWG`), and the cache hierarchy from `CLIDR_EL1` and
+ * `CCSIDR_EL1`. On a system with different CPUs, cache_init() keeps the
+ * values safe for all of them (the smallest line sizes). `UKERNEL_CACHE_LINE`
+ * is still the placement alignment of cache.hpp; cache_init() warns if a CPU
+ * writes back larger granules.
+ *
+ * Range operations work by VA, on every line overlapping the range, and end
+ * with a `DSB`, so the maintenance is complete when they return:
+ *
+ *  - clean_dcache_range(): write dirty lines back to the PoC, e.g. before a
+ *    device reads the buffer or a CPU with its MMU off reads it.
+ *  - inval_dcache_range(): discard lines, e.g. after a device wrote the
+ *    buffer. Partial lines at the edges are cleaned first, so data outside
+ *    the range is not lost.
+ *  - clean_inval_dcache_range(): both.
+ *  - sync_icache_range(): make instructions written with stores visible to
+ *    instruction fetch. `CTR_EL0.IDC` and `CTR_EL0.DIC` skip the D-cache
+ *    clean and the I-cache invalidation when the hardware does not need them.
+ *
+ * Clean operations on ranges larger than the caches would issue more
+ * operations than there are lines; while a single CPU runs, they fall back to
+ * clean_dcache_all() or clean_inval_dcache_all(), which walk the caches by
+ * set/way. Set/way operations only act on the caches of the executing CPU,
+ * so they are not used once the secondary CPUs are known (`nr_cpu_ids()`).
+ *
+ * @par Example
+ * @code
+ * // Publish a boot record to a CPU that starts with its MMU off.
+ * xino::cache::clean_dcache_range(xino::mm::virt_addr{&rec}, sizeof(rec));
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __CACHE_MAINT_HPP__
+#define __CACHE_MAINT_HPP__
+
+#include <cstddef>
+#include <mm.hpp> // virt_addr
+
+namespace xino::cache {
+
+/**
+ * @brief Discover this CPU's caches and fold them into the system view.
+ *
+ * Every CPU calls it once, before using the range operations (before that,
+ * they use the smallest architectural line, 16 bytes). Calls must be
+ * serialized.
+ */
+void cache_init() noexcept;
+
+/** @brief Smallest D-cache line size of all CPUs, in bytes. */
+[[nodiscard]] std::size_t dcache_line_size() noexcept;
+
+/** @brief Smallest I-cache line size of all CPUs, in bytes. */
+[[nodiscard]] std::size_t icache_line_size() noexcept;
+
+/**
+ * @brief Largest cache writeback granule of all CPUs, in bytes.
+ *
+ * Buffers that are invalidated (e.g. DMA from a device) must not share a
+ * granule with other data.
+ */
+[[nodiscard]] std::size_t cache_writeback_granule() noexcept;
+
+/** @brief Clean [@p va, @p va + @p size) to the PoC. */
+void clean_dcache_range(xino::mm::virt_addr va, std::size_t size) noexcept;
+
+/** @brief Clean and invalidate [@p va, @p va + @p size) to the PoC. */
+void clean_inval_dcache_range(xino::mm::virt_addr va,
+                              std::size_t size) noexcept;
+
+/** @brief Invalidate [@p va, @p va + @p size) to the PoC. */
+void inval_dcache_range(xino::mm::virt_addr va, std::size_t size) noexcept;
+
+/** @brief Make instructions in [@p va, @p va + @p size) fetchable. */
+void sync_icache_range(xino::mm::virt_addr va, std::size_t size) noexcept;
+
+/** @brief Clean this CPU's data and unified caches, up to the LoC. */
+void clean_dcache_all() noexcept;
+
+/** @brief Clean and invalidate this CPU's data and unified caches. */
+void clean_inval_dcache_all() noexcept;
+
+} // namespace xino::cache
+
+#endif // __CACHE_MAINT_HPP__
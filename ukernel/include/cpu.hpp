@@ -2,6 +2,7 @@
 #ifndef __CPU_HPP__
 #define __CPU_HPP__
 
+#include <cache.hpp>
 #include <mm.hpp>
 #include <regs.hpp>
 
@@ -27,6 +28,23 @@ using daif = R::DAIF;
 using daifset = R::DAIFSet;
 using daifclr = R::DAIFClr;
 using tpidr_el2 = R::TPIDR_EL2;
+using cntvct_el0 = R::CNTVCT_EL0;
+using cntfrq_el0 = R::CNTFRQ_EL0;
+using mpidr_el1 = R::MPIDR_EL1;
+using vbar_el2 = R::VBAR_EL2;
+using esr_el2 = R::ESR_EL2;
+using elr_el2 = R::ELR_EL2;
+using far_el2 = R::FAR_EL2;
+using icc_sre_el2 = R::ICC_SRE_EL2;
+using icc_pmr_el1 = R::ICC_PMR_EL1;
+using icc_igrpen1_el1 = R::ICC_IGRPEN1_EL1;
+using icc_iar1_el1 = R::ICC_IAR1_EL1;
+using icc_eoir1_el1 = R::ICC_EOIR1_EL1;
+using icc_sgi1r_el1 = R::ICC_SGI1R_EL1;
+using ctr_el0 = R::CTR_EL0;
+using clidr_el1 = R::CLIDR_EL1;
+using csselr_el1 = R::CSSELR_EL1;
+using ccsidr_el1 = R::CCSIDR_EL1;
 ///@}
 
 struct cpu_state {
@@ -41,7 +59,7 @@ struct cpu_state {
 };
 
 // Shared CPU states.
-inline struct cpu_state state;
+__read_mostly inline struct cpu_state state;
 
 /**
  * @brief Wait for event.
@@ -55,6 +73,16 @@ inline struct cpu_state state;
   __asm__ __volatile__("wfe" ::: "memory");
 }
 
+/**
+ * @brief Wait for interrupt.
+ *
+ * `WFI` returns when an interrupt is pending, even if PSTATE masks it, so
+ * an idle loop can check for work with IRQs masked without missing one.
+ */
+[[gnu::always_inline]] inline void wfi() noexcept {
+  __asm__ __volatile__("wfi" ::: "memory");
+}
+
 /** @brief Set "event register" for all cores. */
 [[gnu::always_inline]] inline void sev() noexcept {
   __asm__ __volatile__("sev" ::: "memory");
@@ -135,6 +163,59 @@ tlbi_ipas2e1is(xino::mm::ipa_addr ipa, std::uint8_t ttl_hint = 0) noexcept {
   __asm__ __volatile__("tlbi ipas2e1is, %0" ::"r"(arg) : "memory");
 }
 
+/**
+ * @name Cache maintenance by VA or by set/way.
+ *
+ * See C5.3 (`DC`) and C5.4 (`IC`). The by-VA operations act on the line
+ * containing @p va, in all the caches of the shareability domain; the
+ * set/way operations act on one line of this PE's caches only. See
+ * cache_maint.hpp for the range operations built on them.
+ */
+///@{
+
+/** @brief `DC CVAC`: clean to the Point of Coherency. */
+[[gnu::always_inline]] inline void dc_cvac(std::uintptr_t va) noexcept {
+  __asm__ __volatile__("dc cvac, %0" ::"r"(va) : "memory");
+}
+
+/** @brief `DC CIVAC`: clean and invalidate to the Point of Coherency. */
+[[gnu::always_inline]] inline void dc_civac(std::uintptr_t va) noexcept {
+  __asm__ __volatile__("dc civac, %0" ::"r"(va) : "memory");
+}
+
+/** @brief `DC IVAC`: invalidate to the Point of Coherency (drops data). */
+[[gnu::always_inline]] inline void dc_ivac(std::uintptr_t va) noexcept {
+  __asm__ __volatile__("dc ivac, %0" ::"r"(va) : "memory");
+}
+
+/** @brief `DC CVAU`: clean to the Point of Unification. */
+[[gnu::always_inline]] inline void dc_cvau(std::uintptr_t va) noexcept {
+  __asm__ __volatile__("dc cvau, %0" ::"r"(va) : "memory");
+}
+
+/** @brief `IC IVAU`: invalidate instruction cache to the PoU. */
+[[gnu::always_inline]] inline void ic_ivau(std::uintptr_t va) noexcept {
+  __asm__ __volatile__("ic ivau, %0" ::"r"(va) : "memory");
+}
+
+/** @brief `IC IALLUIS`: invalidate all instruction caches to the PoU. */
+[[gnu::always_inline]] inline void ic_ialluis() noexcept {
+  __asm__ __volatile__("ic ialluis" ::: "memory");
+}
+
+/** @brief `DC CSW`: clean by set/way. */
+[[gnu::always_inline]] inline void dc_csw(std::uint64_t sw) noexcept {
+  __asm__ __volatile__("dc csw, %0" ::"r"(sw) : "memory");
+}
+
+/** @brief `DC CISW`: clean and invalidate by set/way. */
+[[gnu::always_inline]] inline void dc_cisw(std::uint64_t sw) noexcept {
+  __asm__ __volatile__("dc cisw, %0" ::"r"(sw) : "memory");
+}
+
+///@}
+
+/** @brief Flush the console (`xino::plat::uart::console_sync()`) and halt. */
 [[noreturn]] void panic();
 
 } // namespace xino::cpu
@@ -0,0 +1,100 @@
+/**
+ * @file cpumask.hpp
+ * @brief Fixed-size bitmap of logical CPU indices.
+ *
+ * `xino::smp::cpumask` holds one bit per logical CPU (the per-CPU area index,
+ * see percpu.hpp), up to `UKERNEL_NR_CPUS`. The plain operations are not
+ * atomic; `set_atomic()`/`clear_atomic()` update a shared mask, such as the
+ * mask of online CPUs, with a single LSE atomic.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __CPUMASK_HPP__
+#define __CPUMASK_HPP__
+
+#include <config.h> // for UKERNEL_NR_CPUS
+#include <cstdint>
+
+namespace xino::smp {
+
+/** @brief Maximum number of CPUs. */
+constexpr unsigned nr_cpus_max{UKERNEL_NR_CPUS};
+
+class cpumask {
+public:
+  constexpr cpumask() noexcept = default;
+
+  void set(unsigned cpu) noexcept { bits[word(cpu)] |= bit(cpu); }
+  void clear(unsigned cpu) noexcept { bits[word(cpu)] &= ~bit(cpu); }
+
+  [[nodiscard]] bool test(unsigned cpu) const noexcept {
+    return (__atomic_load_n(&bits[word(cpu)], __ATOMIC_RELAXED) & bit(cpu)) !=
+           0;
+  }
+
+  /** @brief Atomically set @p cpu (release). */
+  void set_atomic(unsigned cpu) noexcept {
+    __atomic_fetch_or(&bits[word(cpu)], bit(cpu), __ATOMIC_RELEASE);
+  }
+
+  /** @brief Atomically clear @p cpu (release). */
+  void clear_atomic(unsigned cpu) noexcept {
+    __atomic_fetch_and(&bits[word(cpu)], ~bit(cpu), __ATOMIC_RELEASE);
+  }
+
+  /** @brief Set every CPU below @p n. */
+  void set_all(unsigned n) noexcept {
+    for (unsigned cpu{0}; cpu < n && cpu < nr_cpus_max; cpu++)
+      set(cpu);
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    for (const std::uint64_t w : bits)
+      if (w != 0)
+        return false;
+
+    return true;
+  }
+
+  [[nodiscard]] unsigned weight() const noexcept {
+    unsigned n{0};
+    for (const std::uint64_t w : bits)
+      n += __builtin_popcountll(w);
+
+    return n;
+  }
+
+  /** @brief `*this &= other`; @p other may be a shared mask. */
+  cpumask &operator&=(const cpumask &other) noexcept {
+    for (unsigned i{0}; i < nr_words; i++)
+      bits[i] &= __atomic_load_n(&other.bits[i], __ATOMIC_ACQUIRE);
+
+    return *this;
+  }
+
+  /** @brief Call `f(cpu)` for every CPU in the mask, in increasing order. */
+  template <typename F> void for_each(F &&f) const {
+    for (unsigned i{0}; i < nr_words; i++)
+      for (std::uint64_t w{bits[i]}; w != 0; w &= w - 1)
+        f(i * 64 + static_cast<unsigned>(__builtin_ctzll(w)));
+  }
+
+private:
+  static constexpr unsigned nr_words{(nr_cpus_max + 63) / 64};
+
+  [[nodiscard]] static constexpr unsigned word(unsigned cpu) noexcept {
+    return cpu / 64;
+  }
+
+  [[nodiscard]] static constexpr std::uint64_t bit(unsigned cpu) noexcept {
+    return std::uint64_t{1} << (cpu % 64);
+  }
+
+  std::uint64_t bits[nr_words]{};
+};
+
+} // namespace xino::smp
+
+#endif // __CPUMASK_HPP__
@@ -0,0 +1,200 @@
+/**
+ * @file dma.hpp
+ * @brief DMA mapping API: streaming mappings, scatter-gather and a coherent
+ *        pool.
+ *
+ * There is no IOMMU: a bus address is the physical address of the memory.
+ *
+ * **Streaming mappings** hand an existing buffer to a device for one transfer.
+ * map_single() returns the bus address and does the minimal cache maintenance
+ * for the @ref direction, unmap_single() gives the buffer back to the CPU:
+ *
+ *  | direction       | map / sync_for_device | unmap / sync_for_cpu |
+ *  |-----------------|-----------------------|----------------------|
+ *  | `to_device`     | clean                 | -                    |
+ *  | `from_device`   | invalidate            | invalidate           |
+ *  | `bidirectional` | clean and invalidate  | invalidate           |
+ *
+ * The second invalidation drops lines the CPU may have fetched speculatively
+ * while the device was writing. Devices marked @ref device::coherent snoop
+ * the CPU caches and need no maintenance at all.
+ *
+ * A buffer is **bounced** through the pool when the device can not reach it
+ * directly: it is above @ref device::dma_mask, or it is not physically
+ * contiguous (e.g. a vmalloc() buffer spanning scattered pages). Bouncing
+ * copies the data, so large transfers should use scatter-gather lists
+ * instead: sg_init_buffer() splits a buffer into its physically contiguous
+ * chunks, and map_sg() maps each chunk in place.
+ *
+ * **Coherent memory** from alloc_coherent() is shared with a device for a
+ * long time (e.g. descriptor rings). It comes from a pool of
+ * `UKERNEL_DMA_POOL_SIZE` bytes, allocated once by dma_init() and mapped
+ * Normal Non-cacheable in the devmap window, so no maintenance is ever
+ * needed. When the uKernel mapping is not established
+ * (`xino::runtime::use_mapping` is false), the pool is used through the
+ * identity mapping; it is coherent only if the data cache is disabled
+ * (`SCTLR_EL2.C` is 0), otherwise alloc_coherent() fails and bounce buffers
+ * are maintained like streaming buffers.
+ *
+ * @par Example
+ * @code
+ * const xino::dma::device dev{};
+ *
+ * xino::mm::bus_addr rx{
+ *     xino::dma::map_single(dev, buf, len, xino::dma::direction::from_device)};
+ * if (rx == xino::mm::bus_addr{})
+ *   return xino::error_nr::nomem;
+ *
+ * // ... program the device with `rx` and wait for it ...
+ *
+ * xino::dma::unmap_single(dev, rx, len, xino::dma::direction::from_device);
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __DMA_HPP__
+#define __DMA_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <errno.hpp>
+#include <mm.hpp> // bus_addr
+
+namespace xino::dma {
+
+/** @brief Direction of a streaming transfer. */
+enum class direction : std::uint8_t {
+  bidirectional, /**< Device reads and writes the buffer. */
+  to_device,     /**< Device reads the buffer. */
+  from_device,   /**< Device writes the buffer. */
+};
+
+/** @brief DMA capabilities of a device. */
+struct device {
+  /** @brief Highest bus address the device can reach. */
+  std::uint64_t dma_mask{~std::uint64_t{0}};
+  /** @brief The device snoops the CPU caches (no cache maintenance). */
+  bool coherent{false};
+};
+
+/**
+ * @struct scatterlist
+ * @brief One segment of a scatter-gather transfer.
+ *
+ * `buf` and `length` describe the CPU buffer; map_sg() fills `dma_address`.
+ */
+struct scatterlist {
+  void *buf;
+  std::size_t length;
+  xino::mm::bus_addr dma_address;
+};
+
+/**
+ * @brief Allocate and map the DMA pool.
+ *
+ * Must be called once, after @ref xino::mm::ioremap_init() and before any
+ * other function of this header. On failure, the other functions still
+ * work, but alloc_coherent() returns `nullptr` and mappings that need a
+ * bounce buffer fail.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::nomem` Failed to allocate or map the pool.
+ */
+[[nodiscard]] xino::error_t dma_init() noexcept;
+
+/** @name Streaming mappings. */
+///@{
+/**
+ * @brief Map [@p buf, @p buf + @p size) for a transfer in direction @p dir.
+ *
+ * @return Bus address of the buffer (or of its bounce buffer), or
+ *         `xino::mm::bus_addr{}` if @p size is zero, the buffer is not kernel
+ *         memory, or it needs a bounce buffer and the pool is missing or
+ *         exhausted.
+ */
+[[nodiscard]] xino::mm::bus_addr map_single(const device &dev, void *buf,
+                                            std::size_t size,
+                                            direction dir) noexcept;
+
+/**
+ * @brief Release a mapping returned by @ref map_single().
+ *
+ * @p size and @p dir must be the ones passed to @ref map_single(). For a
+ * bounced mapping, the data the device wrote is copied back to the buffer.
+ */
+void unmap_single(const device &dev, xino::mm::bus_addr addr, std::size_t size,
+                  direction dir) noexcept;
+
+/** @brief Make the device's writes visible to the CPU, keeping the mapping. */
+void sync_single_for_cpu(const device &dev, xino::mm::bus_addr addr,
+                         std::size_t size, direction dir) noexcept;
+
+/** @brief Give the buffer back to the device after the CPU accessed it. */
+void sync_single_for_device(const device &dev, xino::mm::bus_addr addr,
+                            std::size_t size, direction dir) noexcept;
+///@}
+
+/** @name Scatter-gather mappings. */
+///@{
+/**
+ * @brief Describe [@p buf, @p buf + @p size) as physically contiguous chunks.
+ *
+ * Adjacent pages that are also physically adjacent share a segment, so a
+ * buffer from the direct map takes one segment and a vmalloc() buffer takes
+ * one per contiguous run of pages.
+ *
+ * @return Number of segments written to @p sg, or 0 if @p nents is too small
+ *         or the buffer is not mapped.
+ */
+[[nodiscard]] std::size_t sg_init_buffer(scatterlist *sg, std::size_t nents,
+                                         void *buf, std::size_t size) noexcept;
+
+/**
+ * @brief Map @p nents segments for a transfer in direction @p dir.
+ *
+ * @return @p nents on success, or 0 if any segment failed to map (no segment
+ *         is left mapped).
+ */
+[[nodiscard]] std::size_t map_sg(const device &dev, scatterlist *sg,
+                                 std::size_t nents, direction dir) noexcept;
+
+/** @brief Release a mapping returned by @ref map_sg(). */
+void unmap_sg(const device &dev, scatterlist *sg, std::size_t nents,
+              direction dir) noexcept;
+
+/** @brief @ref sync_single_for_cpu() for every segment. */
+void sync_sg_for_cpu(const device &dev, scatterlist *sg, std::size_t nents,
+                     direction dir) noexcept;
+
+/** @brief @ref sync_single_for_device() for every segment. */
+void sync_sg_for_device(const device &dev, scatterlist *sg, std::size_t nents,
+                        direction dir) noexcept;
+///@}
+
+/** @name Coherent memory. */
+///@{
+/**
+ * @brief Allocate coherent memory from the DMA pool.
+ *
+ * @param size Size in bytes; rounded up to a power-of-two number of pages.
+ * @param[out] handle Receives the bus address of the memory.
+ * @return Page-aligned pointer to zeroed memory, or `nullptr` if @p size is
+ *         zero, the pool is exhausted or it is not coherent.
+ */
+[[nodiscard]] void *alloc_coherent(std::size_t size,
+                                   xino::mm::bus_addr &handle) noexcept;
+
+/**
+ * @brief Free memory returned by @ref alloc_coherent().
+ *
+ * @p size must be the one passed to @ref alloc_coherent(); `nullptr` is
+ * ignored.
+ */
+void free_coherent(void *addr, std::size_t size) noexcept;
+///@}
+
+} // namespace xino::dma
+
+#endif // __DMA_HPP__
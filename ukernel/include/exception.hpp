@@ -0,0 +1,49 @@
+/**
+ * @file exception.hpp
+ * @brief EL2 exception vectors and handlers.
+ *
+ * `__vectors` (see vectors.S) is installed in VBAR_EL2 by exception_init().
+ * Each vector saves the interrupted context in an `exception_frame` on the
+ * current stack and calls:
+ *   - `ukernel_exception_sync()` for synchronous exceptions taken from EL2;
+ *     these are fatal: the syndrome is printed and the CPU panics.
+ *   - `ukernel_exception_irq()` for IRQs taken from EL2; they are handled by
+ *     the GIC driver (see plat_gic.hpp).
+ *   - `ukernel_exception_unexpected()` for everything else (FIQ, SError and
+ *     exceptions from lower ELs; there are no guests yet).
+ *
+ * The uKernel is built with `-mgeneral-regs-only`, so the frame holds only
+ * the general-purpose registers.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __EXCEPTION_HPP__
+#define __EXCEPTION_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xino::exception {
+
+/** @brief Context saved on exception entry; layout shared with vectors.S. */
+struct exception_frame {
+  std::uint64_t x[31]; // x0-x30.
+  std::uint64_t elr;
+  std::uint64_t spsr;
+  std::uint64_t pad; // Keep SP 16-byte aligned.
+};
+
+static_assert(sizeof(exception_frame) == 272);
+static_assert(offsetof(exception_frame, elr) == 248);
+
+/** @brief Vector kinds; see vectors.S. */
+enum class vector_kind : std::uint64_t { sync, irq, fiq, serror };
+
+/** @brief Install the EL2 exception vectors on this CPU. */
+void exception_init() noexcept;
+
+} // namespace xino::exception
+
+#endif // __EXCEPTION_HPP__
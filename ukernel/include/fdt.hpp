@@ -0,0 +1,236 @@
+/**
+ * @file fdt.hpp
+ * @brief Zero-copy, allocation-free flattened device tree (FDT) reader.
+ *
+ * The reader works in place on the DTB handed over by the bootloader. Nodes
+ * are handles holding the offset of their `FDT_BEGIN_NODE` token in the
+ * structure block, and properties are views into the blob; nothing is copied
+ * or allocated, so the reader is usable before any allocator exists.
+ *
+ * @ref init validates the header and indexes the nodes queried during boot
+ * (`/`, `/cpus`, `/chosen`, `/aliases` and the `/memory` banks), so these
+ * lookups do not walk the structure block again.
+ *
+ * All accesses are bounds-checked against the header; a malformed blob ends
+ * the walk (invalid node or property) instead of reading past the blob.
+ *
+ * @note `reg` values are returned in the parent bus address space; `ranges`
+ *       translation is not applied (buses on the supported platforms are
+ *       identity-mapped).
+ *
+ * See https://github.com/devicetree-org/devicetree-specification.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __FDT_HPP__
+#define __FDT_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <errno.hpp>
+#include <mm.hpp> // phys_addr
+#include <string_view>
+
+namespace xino::fdt {
+
+/** @brief Load a big-endian 32-bit value (@p p is 4-byte aligned). */
+[[nodiscard]] inline std::uint32_t be32(const void *p) noexcept {
+  return __builtin_bswap32(*static_cast<const std::uint32_t *>(p));
+}
+
+/** @brief Node handle; offset of the node in the structure block. */
+struct node {
+  std::int32_t off{-1};
+
+  [[nodiscard]] constexpr bool valid() const noexcept { return off >= 0; }
+
+  constexpr bool operator==(const node &) const noexcept = default;
+};
+
+/** @brief Property view into the blob. */
+struct property {
+  const char *name{nullptr};
+  const std::uint8_t *data{nullptr};
+  std::uint32_t len{0};
+
+  [[nodiscard]] constexpr bool valid() const noexcept {
+    return name != nullptr;
+  }
+
+  /** @brief Number of 32-bit cells in the value. */
+  [[nodiscard]] constexpr std::size_t nr_cells() const noexcept {
+    return len / sizeof(std::uint32_t);
+  }
+
+  /** @brief Cell @p i; @pre `i < nr_cells()`. */
+  [[nodiscard]] std::uint32_t u32(std::size_t i) const noexcept {
+    return be32(data + i * sizeof(std::uint32_t));
+  }
+
+  /**
+   * @brief Read a value of @p n cells (at most two) starting at cell @p pos.
+   * @pre `pos + n <= nr_cells()`.
+   */
+  [[nodiscard]] std::uint64_t cells(std::size_t pos,
+                                    unsigned n) const noexcept {
+    std::uint64_t v{0};
+    for (unsigned i{0}; i < n; i++)
+      v = (v << 32) | u32(pos + i);
+
+    return v;
+  }
+
+  /** @brief Value as a string, or `nullptr` if not NUL-terminated. */
+  [[nodiscard]] const char *str() const noexcept {
+    if (len == 0 || data[len - 1] != '\0')
+      return nullptr;
+
+    return reinterpret_cast<const char *>(data);
+  }
+};
+
+/** @brief Interrupt specifier (see @ref interrupt). */
+struct irq_spec {
+  static constexpr unsigned max_cells{4};
+
+  node controller{};
+  unsigned nr_cells{0};
+  std::uint32_t cells[max_cells]{};
+};
+
+/**
+ * @brief Validate and index the DTB at @p pa.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` No valid DTB (bad alignment, magic,
+ *         version or layout).
+ */
+[[nodiscard]] xino::error_t init(xino::mm::phys_addr pa) noexcept;
+
+/** @brief Check if a DTB has been found by @ref init. */
+[[nodiscard]] bool present() noexcept;
+
+/** @brief Physical base and total size of the DTB. */
+[[nodiscard]] xino::mm::phys_addr blob_pa() noexcept;
+[[nodiscard]] std::size_t blob_size() noexcept;
+
+/** @name Tree walk. */
+///@{
+[[nodiscard]] node root() noexcept;
+/** @brief Next node after @p n in document order (root if @p n is invalid). */
+[[nodiscard]] node next_node(node n) noexcept;
+[[nodiscard]] node first_child(node n) noexcept;
+[[nodiscard]] node next_sibling(node n) noexcept;
+/** @brief Parent of @p n (walks the structure block). */
+[[nodiscard]] node parent(node n) noexcept;
+/** @brief Full node name (`name@unit`); empty for the root. */
+[[nodiscard]] const char *name(node n) noexcept;
+///@}
+
+/** @name Lookup. */
+///@{
+/**
+ * @brief Find a node by absolute path or alias (e.g. `serial2`).
+ *
+ * Path components without a unit address match any unit address.
+ */
+[[nodiscard]] node find_node(std::string_view path) noexcept;
+[[nodiscard]] node find_phandle(std::uint32_t phandle) noexcept;
+/** @brief Next node after @p from compatible with @p compat. */
+[[nodiscard]] node find_compatible(const char *compat,
+                                   node from = {}) noexcept;
+[[nodiscard]] property get_property(node n, const char *prop) noexcept;
+[[nodiscard]] bool is_compatible(node n, const char *compat) noexcept;
+///@}
+
+/** @name Standard properties. */
+///@{
+/** @brief `#address-cells` of @p n (default 2). */
+[[nodiscard]] unsigned address_cells(node n) noexcept;
+/** @brief `#size-cells` of @p n (default 1). */
+[[nodiscard]] unsigned size_cells(node n) noexcept;
+
+/**
+ * @brief Entry @p idx of the `reg` property of @p n.
+ *
+ * @return `false` if there is no such entry or cells are wider than 64 bits.
+ */
+[[nodiscard]] bool reg(node n, std::size_t idx, xino::mm::phys_addr &base,
+                       std::size_t &size) noexcept;
+
+/**
+ * @brief Entry @p idx of the `interrupts` property of @p n.
+ *
+ * The controller is found through `interrupt-parent` on @p n or its
+ * ancestors, and its `#interrupt-cells` gives the specifier width.
+ */
+[[nodiscard]] bool interrupt(node n, std::size_t idx, irq_spec &spec) noexcept;
+///@}
+
+/** @name Boot queries (indexed by @ref init). */
+///@{
+[[nodiscard]] node cpus_node() noexcept;
+[[nodiscard]] node chosen_node() noexcept;
+
+/** @brief Number of `/cpus` children with `device_type = "cpu"`. */
+[[nodiscard]] unsigned nr_cpus() noexcept;
+
+/** @brief Number of RAM banks described by the `/memory` nodes. */
+[[nodiscard]] std::size_t nr_memory_banks() noexcept;
+[[nodiscard]] bool memory_bank(std::size_t idx, xino::mm::phys_addr &base,
+                               std::size_t &size) noexcept;
+
+/** @brief Node referenced by `/chosen/stdout-path` (options stripped). */
+[[nodiscard]] node stdout_node() noexcept;
+
+/**
+ * @brief Entry @p idx of the memory reservation block (`/memreserve/`).
+ *
+ * @return `false` past the last entry.
+ */
+[[nodiscard]] bool mem_rsv(std::size_t idx, xino::mm::phys_addr &base,
+                           std::size_t &size) noexcept;
+
+/**
+ * @brief Populate memblock: add the RAM banks, and reserve the DTB, the
+ *        `/memreserve/` entries and the `/reserved-memory` regions.
+ */
+[[nodiscard]] xino::error_t memblock_setup() noexcept;
+///@}
+
+/** @brief Call `f(node)` for every node in document order. */
+template <typename F> void for_each_node(F &&f) {
+  for (node n{root()}; n.valid(); n = next_node(n))
+    f(n);
+}
+
+/** @brief Call `f(node)` for every child of @p n. */
+template <typename F> void for_each_child(node n, F &&f) {
+  for (node c{first_child(n)}; c.valid(); c = next_sibling(c))
+    f(c);
+}
+
+/** @brief Call `f(node, mpidr)` for every CPU node under `/cpus`. */
+template <typename F> void for_each_cpu_node(F &&f) {
+  const node cpus{cpus_node()};
+  const unsigned ac{address_cells(cpus)};
+
+  for_each_child(cpus, [&](node c) {
+    const property type{get_property(c, "device_type")};
+    const char *s{type.str()};
+    if (s == nullptr || std::string_view{s} != "cpu")
+      return;
+
+    const property r{get_property(c, "reg")};
+    if (ac > 2 || r.nr_cells() < ac)
+      return;
+
+    f(c, r.cells(0, ac));
+  });
+}
+
+} // namespace xino::fdt
+
+#endif // __FDT_HPP__
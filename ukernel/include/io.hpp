@@ -18,7 +18,10 @@
  * - **Sized helpers**: `xino::io::read{b,w,l,q}`, `xino::io::write{b,w,l,q}`,
  *   `xino::io::read_relaxed{b,w,l,q}`, and `xino::io::write_relaxed{b,w,l,q}`
  *
- * @note This assumes MMIO mappings are Device-nGnRE/nGnRnE.
+ * @note This assumes MMIO mappings are Device-nGnRE/nGnRnE, where accesses
+ *       to a device arrive in program order. On Device-GRE or Normal-NC
+ *       mappings (see `xino::mm::prot`), relaxed accesses may be merged or
+ *       reordered; use ordered accesses where the order matters.
  *
  * @author Amirreza Zarrabi
  * @date 2025
@@ -0,0 +1,141 @@
+/**
+ * @file klog.hpp
+ * @brief Kernel log: per-CPU lock-free record rings, flushed asynchronously.
+ *
+ * log() formats a message into a fixed-size record of this CPU's ring and
+ * returns; it never takes a lock or touches the UART. Each record carries a
+ * `CNTVCT_EL0` timestamp, the CPU and a @ref level.
+ *
+ * Every CPU owns one ring of `UKERNEL_KLOG_RECORDS` records, written only by
+ * that CPU (a `xino::sync::overwrite_ring`). A record is committed by
+ * storing its sequence number last, and the ring overwrites its oldest
+ * records when the consumer falls behind; the consumer counts them as
+ * dropped. klog_init() allocates the rings of the CPUs that boot; until
+ * then, the boot CPU logs into a static ring.
+ *
+ * A single consumer, flush(), merges the rings by timestamp and writes the
+ * records to the console (`xino::plat::uart::console_write()`). It runs:
+ *   - on another online CPU (or this one, once IRQs are unmasked), kicked by
+ *     an SGI after a record is committed;
+ *   - on idle CPUs, before `WFI`.
+ *
+ * The rings are kept after flushing: dump() prints the retained history of
+ * every CPU, for callers or a debugger (main() calls it with
+ * `UKERNEL_KLOG_DUMP`), and crash_dump() prints what is not flushed yet from
+ * a fault handler, without locks. A debugger finds the rings through the
+ * `xino_klog` descriptor.
+ *
+ * @par Example
+ * @code
+ * xino::klog::log(xino::klog::level::info, "gic: %u SPIs\n", nr_spis);
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __KLOG_HPP__
+#define __KLOG_HPP__
+
+#include <config.h> // for UKERNEL_KLOG_RECORDS
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+
+namespace xino::klog {
+
+enum class level : std::uint8_t {
+  emerg, /**< System is unusable. */
+  err,   /**< Error conditions. */
+  warn,  /**< Warning conditions. */
+  info,  /**< Informational. */
+  debug, /**< Debug messages. */
+};
+
+/**
+ * @struct record
+ * @brief One log message (128 bytes).
+ *
+ * `seq` is `pos + 1` once the record at ring position `pos` is committed,
+ * and `0` while it is being written.
+ */
+struct record {
+  std::uint64_t seq;
+  std::uint64_t ts; // CNTVCT_EL0.
+  std::uint16_t cpu;
+  std::uint8_t level;
+  std::uint8_t len;
+  char text[108]; // Not NUL-terminated; the trailing '\n' is dropped.
+};
+
+static_assert(sizeof(record) == 128);
+
+static constexpr std::size_t nr_records{UKERNEL_KLOG_RECORDS};
+static_assert(nr_records != 0 && (nr_records & (nr_records - 1)) == 0,
+              "UKERNEL_KLOG_RECORDS must be a power of two");
+
+/**
+ * @brief Allocate a ring per CPU and install the flush SGI (boot CPU, once).
+ *
+ * Call after `xino::percpu::percpu_init()`, `xino::plat::gic::init()` and
+ * `xino::smp::smp_init()`, before secondaries boot. Records logged before
+ * are kept, and flushed once a CPU goes idle or by the first kick. If the
+ * rings can not be allocated, only the boot CPU logs.
+ */
+void klog_init() noexcept;
+
+/** @brief Enable the flush SGI on this CPU; after `smp_cpu_online()`. */
+void klog_cpu_online() noexcept;
+
+/** @brief Log a message at level @p lvl (any context). */
+[[gnu::format(printf, 2, 3)]] void log(level lvl, const char *fmt,
+                                        ...) noexcept;
+void vlog(level lvl, const char *fmt, std::va_list ap) noexcept;
+
+/**
+ * @brief Write the records not yet flushed to the console (any CPU).
+ *
+ * Does nothing if another CPU is flushing; it takes the new records too.
+ */
+void flush() noexcept;
+
+/** @brief Print the retained records of every CPU, merged by time. */
+void dump() noexcept;
+
+/**
+ * @brief Print the records not yet flushed, without locks.
+ *
+ * For fault handlers, after `xino::plat::uart::console_sync()`. The flush
+ * in progress on another CPU (if any) may print some of them again.
+ */
+void crash_dump() noexcept;
+
+} // namespace xino::klog
+
+extern "C" {
+
+/**
+ * @brief Where a debugger or crash tool finds the rings.
+ *
+ * `rings` points to `nr_cpus` rings of `ring_size` bytes each (one ring
+ * until klog_init()); a ring is its producer position (`uint64_t` at offset
+ * 0) followed by `nr_records` records of `record_size` bytes at
+ * `records_offset`. Timestamps tick at
+ * `CNTFRQ_EL0`, recorded in `freq`.
+ */
+struct xino_klog_desc {
+  std::uint64_t magic; // "XINOKLOG".
+  std::uint32_t version;
+  std::uint32_t nr_cpus;
+  std::uint32_t nr_records;
+  std::uint32_t record_size;
+  std::uint32_t ring_size;
+  std::uint32_t records_offset;
+  std::uint64_t freq;
+  const void *rings;
+};
+
+extern xino_klog_desc xino_klog;
+}
+
+#endif // __KLOG_HPP__
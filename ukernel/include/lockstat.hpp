@@ -0,0 +1,94 @@
+/**
+ * @file lockstat.hpp
+ * @brief Lock contention statistics (built with `UKERNEL_LOCKSTAT`).
+ *
+ * With `UKERNEL_LOCKSTAT`, every `xino::sync::spin_lock` embeds a
+ * `lock_stats` record and counts, using `CNTVCT_EL0`:
+ *  - acquisitions, and contended acquisitions (the first `try_lock()` failed);
+ *  - total and worst spin time of the contended acquisitions;
+ *  - total and worst hold time.
+ *
+ * A lock registers itself on its first acquisition. lockstat_dump() prints
+ * the registered locks, merged by name (the lock class), most contended
+ * first. Name locks with `spin_lock{"name"}`; unnamed locks are listed by
+ * address. A lock whose storage is freed (one embedded in an allocated
+ * object) must be dropped with `spin_lock::destroy()` first; its statistics
+ * go with it.
+ *
+ * Without `UKERNEL_LOCKSTAT`, `spin_lock` is unchanged and the name is
+ * dropped.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __LOCKSTAT_HPP__
+#define __LOCKSTAT_HPP__
+
+#include <cpu.hpp>
+#include <cstdint>
+
+namespace xino::sync {
+
+/** @brief Per-lock statistics; updated with the lock held. */
+struct lock_stats {
+  const char *name;
+  lock_stats *next; // Registered locks.
+  bool registered;
+
+  std::uint64_t acquisitions;
+  std::uint64_t contended;
+  std::uint64_t spin_total; // Ticks, contended acquisitions only.
+  std::uint64_t spin_max;
+  std::uint64_t hold_total; // Ticks.
+  std::uint64_t hold_max;
+  std::uint64_t acquired_at;
+
+  constexpr explicit lock_stats(const char *lock_name) noexcept
+      : name{lock_name}, next{nullptr}, registered{false}, acquisitions{0},
+        contended{0}, spin_total{0}, spin_max{0}, hold_total{0},
+        hold_max{0}, acquired_at{0} {}
+
+  /** @brief Record an acquisition that started at @p t0. */
+  void acquired(std::uint64_t t0, bool was_contended) noexcept;
+
+  /** @brief Record a release. */
+  void released() noexcept {
+    const std::uint64_t hold{xino::cpu::cntvct_el0::read() - acquired_at};
+
+    hold_total += hold;
+    if (hold > hold_max)
+      hold_max = hold;
+  }
+};
+
+/** @brief Add @p s to the registered locks (once per lock). */
+void lockstat_register(lock_stats *s) noexcept;
+
+/** @brief Remove @p s from the registered locks, if registered. */
+void lockstat_unregister(lock_stats *s) noexcept;
+
+inline void lock_stats::acquired(std::uint64_t t0,
+                                 bool was_contended) noexcept {
+  const std::uint64_t t1{xino::cpu::cntvct_el0::read()};
+
+  if (!registered)
+    lockstat_register(this);
+
+  acquisitions++;
+  if (was_contended) {
+    contended++;
+    spin_total += t1 - t0;
+    if (t1 - t0 > spin_max)
+      spin_max = t1 - t0;
+  }
+
+  acquired_at = t1;
+}
+
+/** @brief Print the statistics of the registered locks on stdout. */
+void lockstat_dump() noexcept;
+
+} // namespace xino::sync
+
+#endif // __LOCKSTAT_HPP__
@@ -404,6 +404,19 @@ using ipa_addr_range = address_range<ipa_addr>;
  *
  * The page-table builder converts `xino::mm::prot` into architecture-
  * specific descriptor bits (e.g., AArch64 PTE fields).
+ *
+ * The memory type is one of the `MEMTYPE` flags, or Normal Write-Back if none
+ * is set. From the most to the least strict:
+ *  - `DEVICE`: Device-nGnRnE; every access is non-posted, e.g. registers
+ *    whose write must reach the device before the next access.
+ *  - `DEVICE_nGnRE`: Device-nGnRE; writes may be acknowledged early (posted).
+ *    The usual type for MMIO.
+ *  - `DEVICE_GRE`: Device-GRE; accesses may also be gathered and reordered.
+ *  - `NOCACHE`: Normal Non-cacheable; write-combining, e.g. framebuffers and
+ *    DMA memory shared with non-coherent devices.
+ *  - `WRITETHROUGH`: Normal Write-Through cacheable.
+ *
+ * If several are set, the strictest one is used.
  */
 class prot {
 public:
@@ -413,15 +426,22 @@ public:
   /** @name Bit flags. */
   ///@{
   static constexpr mask_t NONE{0x0};
-  static constexpr mask_t READ{0x1};         /**< Readable. */
-  static constexpr mask_t WRITE{0x2};        /**< Writable. */
-  static constexpr mask_t EXECUTE{0x4};      /**< Executable. */
-  static constexpr mask_t KERNEL{0x8};       /**< Kernel page.*/
-  static constexpr mask_t DEVICE{0x10};      /**< Device. */
-  static constexpr mask_t SHARED{0x20};      /**< Inner-Sharable page. */
-  static constexpr mask_t RW{READ | WRITE};  /**< Readable and writable. */
-  static constexpr mask_t RWE{RW | EXECUTE}; /**< RW, and executable. */
-  static constexpr mask_t ALL_BITS{RWE | KERNEL | DEVICE | SHARED};
+  static constexpr mask_t READ{0x1};           /**< Readable. */
+  static constexpr mask_t WRITE{0x2};          /**< Writable. */
+  static constexpr mask_t EXECUTE{0x4};        /**< Executable. */
+  static constexpr mask_t KERNEL{0x8};         /**< Kernel page.*/
+  static constexpr mask_t DEVICE{0x10};        /**< Device-nGnRnE. */
+  static constexpr mask_t SHARED{0x20};        /**< Inner-Sharable page. */
+  static constexpr mask_t NOCACHE{0x40};       /**< Normal Non-cacheable. */
+  static constexpr mask_t DEVICE_nGnRE{0x80};  /**< Device-nGnRE. */
+  static constexpr mask_t DEVICE_GRE{0x100};   /**< Device-GRE. */
+  static constexpr mask_t WRITETHROUGH{0x200}; /**< Normal Write-Through. */
+  static constexpr mask_t RW{READ | WRITE};    /**< Readable and writable. */
+  static constexpr mask_t RWE{RW | EXECUTE};   /**< RW, and executable. */
+  /** Memory type; none set is Normal Write-Back. */
+  static constexpr mask_t MEMTYPE{DEVICE | DEVICE_nGnRE | DEVICE_GRE |
+                                  NOCACHE | WRITETHROUGH};
+  static constexpr mask_t ALL_BITS{RWE | KERNEL | SHARED | MEMTYPE};
   ///@}
 
   /** @brief Construct with no flags set (i.e. NONE). */
@@ -465,11 +485,57 @@ public:
   }
   ///@}
 
+  // Same set of flags.
+  [[nodiscard]] constexpr bool
+  operator==(const prot &) const noexcept = default;
+
 private:
   /** @brief Stored protection bits. */
   mask_t flags;
 };
 
+/* PAGE DESCRIPTOR. */
+
+/**
+ * @struct page
+ * @brief Metadata of a single physical page (see mm_memmap.hpp).
+ *
+ * One descriptor exists per page frame (PFN) in the memmap. A block of
+ * `2^order` pages is described folio-like: the first (head) descriptor holds
+ * the block state, and each tail descriptor only records its distance to the
+ * head.
+ */
+struct page {
+  /** @name Flags. */
+  ///@{
+  static constexpr std::uint32_t PG_RESERVED{0x1}; /**< Not managed. */
+  static constexpr std::uint32_t PG_FREE{0x2};     /**< Free in an allocator. */
+  static constexpr std::uint32_t PG_HEAD{0x4};     /**< Head of a block. */
+  static constexpr std::uint32_t PG_TAIL{0x8};     /**< Tail of a block. */
+  static constexpr std::uint32_t PG_DIRTY{0x10};   /**< Written since clean. */
+  static constexpr std::uint32_t PG_LOCKED{0x20};  /**< Locked for I/O. */
+  ///@}
+
+  /** @name Migrate types. */
+  ///@{
+  static constexpr std::uint8_t MT_UNMOVABLE{0};
+  static constexpr std::uint8_t MT_MOVABLE{1};
+  static constexpr std::uint8_t MT_RECLAIMABLE{2};
+  ///@}
+
+  std::uint32_t flags; /**< `PG_*` flags. */
+  union {
+    std::uint32_t refcount; /**< Head or single page: reference count. */
+    std::uint32_t head_off; /**< Tail page: distance (in pages) to the head. */
+  };
+  std::uint32_t mapcount;   /**< Number of page-table mappings. */
+  std::uint16_t owner;      /**< Owner (e.g. VM id); 0 is the uKernel. */
+  std::uint8_t order;       /**< Head or single page: block order. */
+  std::uint8_t migratetype; /**< `MT_*` migrate type. */
+};
+
+static_assert(sizeof(page) == 16, "Keep page descriptors compact");
+
 } // namespace xino::mm
 
 #endif // __MM_HPP__
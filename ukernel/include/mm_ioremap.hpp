@@ -0,0 +1,99 @@
+/**
+ * @file mm_ioremap.hpp
+ * @brief Device MMIO mappings in the devmap window.
+ *
+ * `ioremap()` maps a physical device region into the device mapping window
+ * `[devmap_va, devmap_end]` (see mm_va_layout.hpp) of the uKernel page table.
+ *
+ * VA ranges are carved out of the window by a buddy allocator over
+ * `xino::mm::virt_addr`, so each range is naturally aligned to its size:
+ *  - Regions of at least a block size (2MB for 4KB granule, 32MB for 16KB
+ *    granule) get a VA congruent to their PA modulo the block size, so
+ *    `page_table::map_range()` installs block descriptors wherever the region
+ *    covers a whole block.
+ *  - Smaller regions are mapped with pages.
+ *
+ * Mappings are reference-counted: a request fully contained in an existing
+ * mapping with the same protections reuses it instead of consuming another
+ * VA range, page-table pages and TLB entries. `iounmap()` drops a reference
+ * and tears the mapping down with the last one.
+ *
+ * When the uKernel mapping is not established (`xino::runtime::use_mapping` is
+ * false), `ioremap()` returns the identity VA and `iounmap()` is a no-op.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __MM_IOREMAP_HPP__
+#define __MM_IOREMAP_HPP__
+
+#include <cstddef>
+#include <errno.hpp>
+#include <mm.hpp> // phys_addr, virt_addr, and prot
+
+namespace xino::mm {
+
+/** @brief Default protections for device MMIO mappings (Device-nGnRnE). */
+constexpr xino::mm::prot prot_device{xino::mm::prot::RW |
+                                     xino::mm::prot::KERNEL |
+                                     xino::mm::prot::DEVICE};
+
+/**
+ * @brief Device MMIO mappings with posted writes (Device-nGnRE).
+ *
+ * A write may complete before it reaches the device; accesses to the device
+ * still arrive in program order. Safe for registers that are polled or read
+ * back before depending on the write (e.g. UART, GIC).
+ */
+constexpr xino::mm::prot prot_device_posted{xino::mm::prot::RW |
+                                            xino::mm::prot::KERNEL |
+                                            xino::mm::prot::DEVICE_nGnRE};
+
+/**
+ * @brief Write-combining mappings (Normal Non-cacheable).
+ *
+ * Writes may be merged and reordered; for memory-like regions such as
+ * framebuffers, not for registers.
+ */
+constexpr xino::mm::prot prot_writecombine{
+    xino::mm::prot::RW | xino::mm::prot::KERNEL | xino::mm::prot::SHARED |
+    xino::mm::prot::NOCACHE};
+
+/**
+ * @brief Initialize the devmap VA allocator.
+ *
+ * Must be called once, after @ref xino::mm::paging::kernel_page_table_init()
+ * and before the first @ref ioremap().
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` The devmap window can not be managed.
+ */
+[[nodiscard]] xino::error_t ioremap_init() noexcept;
+
+/**
+ * @brief Map a physical device region into the devmap window.
+ *
+ * @param pa Physical start address of the region (need not be page aligned).
+ * @param size Size of the region in bytes.
+ * @param p Protection/attribute flags (defaults to @ref prot_device).
+ *
+ * @return VA corresponding to @p pa, or `xino::mm::virt_addr{}` if @p size is
+ *         zero, the address computation overflows, or the devmap window or the
+ *         page-table allocator is exhausted.
+ */
+[[nodiscard]] xino::mm::virt_addr
+ioremap(xino::mm::phys_addr pa, std::size_t size,
+        xino::mm::prot p = prot_device) noexcept;
+
+/**
+ * @brief Release a mapping returned by @ref ioremap().
+ *
+ * @param va Any VA within the mapping (typically the value returned by
+ *           @ref ioremap()). Addresses outside the devmap window are ignored.
+ */
+void iounmap(xino::mm::virt_addr va) noexcept;
+
+} // namespace xino::mm
+
+#endif // __MM_IOREMAP_HPP__
@@ -0,0 +1,159 @@
+/**
+ * @file mm_memblock.hpp
+ * @brief Early physical memory map (memblock).
+ *
+ * memblock records the physical memory layout during boot, before the main
+ * page allocator exists:
+ *  - `memory`: usable RAM banks (e.g. from the device tree).
+ *  - `reserved`: ranges that must not be handed out (the uKernel image and
+ *    boot heap, the device tree, initrd, firmware reservations, and early
+ *    allocations done via @ref alloc).
+ *
+ * Both are kept as sorted arrays of disjoint, merged regions, so overlap
+ * queries are a binary search (`O(log n)`), and free memory ("memory minus
+ * reserved") is enumerated in a single merge pass by @ref for_each_free.
+ *
+ * Like the boot allocator, the region maps are constant-initialized and need
+ * no runtime construction. They are not synchronized; memblock is only used
+ * by the boot CPU.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __MM_MEMBLOCK_HPP__
+#define __MM_MEMBLOCK_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <errno.hpp>
+#include <mm.hpp> // phys_addr
+
+namespace xino::mm::memblock {
+
+/** @brief Physical region `[base, base + size)`. */
+struct region {
+  xino::mm::phys_addr base{};
+  std::size_t size{0};
+
+  [[nodiscard]] constexpr xino::mm::phys_addr end() const noexcept {
+    return base + size;
+  }
+};
+
+/**
+ * @class region_map
+ * @brief Fixed-capacity, sorted set of disjoint and merged regions.
+ */
+class region_map {
+public:
+  /** @brief Maximum number of disjoint regions. */
+  static constexpr std::size_t max_regions{128};
+
+  /**
+   * @brief Add `[base, base + size)`, merging with overlapping or adjacent
+   *        regions.
+   *
+   * @retval `xino::error_nr::ok` Success (or `size == 0`).
+   * @retval `xino::error_nr::overflow` Address overflow.
+   * @retval `xino::error_nr::nomem` No free slot for a new region.
+   */
+  [[nodiscard]] xino::error_t add(xino::mm::phys_addr base,
+                                  std::size_t size) noexcept;
+
+  /**
+   * @brief Remove `[base, base + size)`; regions may be trimmed or split.
+   *
+   * @retval `xino::error_nr::ok` Success (or `size == 0`).
+   * @retval `xino::error_nr::overflow` Address overflow.
+   * @retval `xino::error_nr::nomem` No free slot to split a region.
+   */
+  [[nodiscard]] xino::error_t remove(xino::mm::phys_addr base,
+                                     std::size_t size) noexcept;
+
+  /** @brief Check if any region overlaps `[base, base + size)`. */
+  [[nodiscard]] bool overlaps(xino::mm::phys_addr base,
+                              std::size_t size) const noexcept;
+
+  /** @brief Index of the first region ending after @p pa, or @ref count. */
+  [[nodiscard]] std::size_t first_ending_after(
+      xino::mm::phys_addr pa) const noexcept;
+
+  [[nodiscard]] std::size_t count() const noexcept { return cnt; }
+
+  [[nodiscard]] const region &operator[](std::size_t i) const noexcept {
+    return regions[i];
+  }
+
+private:
+  region regions[max_regions]{};
+  std::size_t cnt{0};
+};
+
+// Defined in mm_memblock.cpp.
+extern region_map memory;
+extern region_map reserved;
+
+/** @brief Register a usable RAM bank. */
+[[nodiscard]] xino::error_t add_memory(xino::mm::phys_addr base,
+                                       std::size_t size) noexcept;
+
+/** @brief Mark `[base, base + size)` as reserved. */
+[[nodiscard]] xino::error_t reserve(xino::mm::phys_addr base,
+                                    std::size_t size) noexcept;
+
+/** @brief Drop a reservation (e.g. an early allocation no longer needed). */
+[[nodiscard]] xino::error_t unreserve(xino::mm::phys_addr base,
+                                      std::size_t size) noexcept;
+
+/** @brief Check if any part of `[base, base + size)` is reserved. */
+[[nodiscard]] inline bool is_reserved(xino::mm::phys_addr base,
+                                      std::size_t size) noexcept {
+  return reserved.overlaps(base, size);
+}
+
+/** @brief Reserve the uKernel image (including the boot heap). */
+void reserve_image() noexcept;
+
+/**
+ * @brief Allocate and reserve physical memory.
+ *
+ * @param size Size in bytes.
+ * @param align Alignment in bytes (power-of-two).
+ * @param top_down Search from the top of memory if `true` (default), from
+ *        the bottom otherwise.
+ *
+ * @return Physical base address of the allocated range, or
+ *         `xino::mm::phys_addr{}` if no free range fits.
+ */
+[[nodiscard]] xino::mm::phys_addr alloc(std::size_t size, std::size_t align,
+                                        bool top_down = true) noexcept;
+
+/**
+ * @brief Call `f(base, size)` for every free range (memory minus reserved),
+ *        in ascending address order.
+ *
+ * @tparam F Callable with signature `void(xino::mm::phys_addr, std::size_t)`.
+ */
+template <typename F> void for_each_free(F &&f) {
+  for (std::size_t m{0}; m < memory.count(); m++) {
+    xino::mm::phys_addr cur{memory[m].base};
+    const xino::mm::phys_addr end{memory[m].end()};
+
+    // Walk the reserved regions overlapping the memory region.
+    for (std::size_t r{reserved.first_ending_after(cur)};
+         cur < end && r < reserved.count() && reserved[r].base < end; r++) {
+      if (cur < reserved[r].base)
+        f(cur, static_cast<std::size_t>(reserved[r].base - cur));
+
+      cur = reserved[r].end();
+    }
+
+    if (cur < end)
+      f(cur, static_cast<std::size_t>(end - cur));
+  }
+}
+
+} // namespace xino::mm::memblock
+
+#endif // __MM_MEMBLOCK_HPP__
@@ -0,0 +1,97 @@
+/**
+ * @file mm_memmap.hpp
+ * @brief Physical page metadata array (memmap).
+ *
+ * The memmap is a flat array of `xino::mm::page` descriptors, one per page
+ * frame in `[memmap_start_pfn, memmap_end_pfn)`, covering all RAM banks (holes
+ * between banks are described by `PG_RESERVED` descriptors). It lives in
+ * physical memory and is accessed through the direct map, so
+ * `xino::mm::va_layout::pa_to_page()` and `page_to_pa()` are a shift and an
+ * add.
+ *
+ * Blocks of `2^order` pages are described folio-like: @ref prep_compound
+ * marks the first descriptor `PG_HEAD` and the others `PG_TAIL`, each tail
+ * recording its distance to the head. Reference counts live in the head.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __MM_MEMMAP_HPP__
+#define __MM_MEMMAP_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <errno.hpp>
+#include <mm.hpp> // phys_addr and page
+#include <mm_va_layout.hpp>
+
+namespace xino::mm {
+
+/** @brief Size in bytes of the memmap describing @p nr_pages page frames. */
+[[nodiscard]] constexpr std::size_t memmap_size(std::size_t nr_pages) noexcept {
+  return nr_pages * sizeof(xino::mm::page);
+}
+
+/**
+ * @brief Initialize the memmap.
+ *
+ * All descriptors are initialized as `PG_RESERVED` with a zero reference
+ * count; allocators clear `PG_RESERVED` when they take ownership of a page.
+ *
+ * @param start_pfn First PFN described (inclusive).
+ * @param end_pfn Last PFN described (exclusive).
+ * @param storage Physical base of at least `memmap_size(end_pfn - start_pfn)`
+ *        bytes of memory reserved for the memmap.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` The PFN range is empty or @p storage is
+ *         not aligned for `xino::mm::page`.
+ */
+[[nodiscard]] xino::error_t memmap_init(std::size_t start_pfn,
+                                        std::size_t end_pfn,
+                                        xino::mm::phys_addr storage) noexcept;
+
+/**
+ * @brief Describe `2^order` pages starting at @p head as a single block.
+ *
+ * @pre The block lies within the memmap.
+ */
+void prep_compound(xino::mm::page *head, unsigned order) noexcept;
+
+/** @brief Return the head descriptor of the block containing @p pg. */
+[[nodiscard]] inline xino::mm::page *
+compound_head(xino::mm::page *pg) noexcept {
+  if (pg->flags & xino::mm::page::PG_TAIL)
+    return pg - pg->head_off;
+
+  return pg;
+}
+
+/** @brief Number of pages in the block headed by @p head. */
+[[nodiscard]] inline std::size_t
+compound_nr(const xino::mm::page *head) noexcept {
+  return std::size_t{1} << head->order;
+}
+
+/** @name Reference counting (on the block head). */
+///@{
+inline void get_page(xino::mm::page *pg) noexcept {
+  __atomic_add_fetch(&compound_head(pg)->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/** @return `true` if this dropped the last reference. */
+[[nodiscard]] inline bool put_page(xino::mm::page *pg) noexcept {
+  return __atomic_sub_fetch(&compound_head(pg)->refcount, 1,
+                            __ATOMIC_ACQ_REL) == 0;
+}
+
+[[nodiscard]] inline std::uint32_t
+page_count(xino::mm::page *pg) noexcept {
+  return __atomic_load_n(&compound_head(pg)->refcount, __ATOMIC_RELAXED);
+}
+///@}
+
+} // namespace xino::mm
+
+#endif // __MM_MEMMAP_HPP__
@@ -3,12 +3,14 @@
 #define __MM_PAGING_HPP__
 
 #include <allocator.hpp>
+#include <barrier.hpp>
 #include <cstddef>
 #include <cstdint>
 #include <errno.hpp>
 #include <mm.hpp> // phys_addr, virt_addr, ipa_addr, and prot
 #include <mm_va_layout.hpp>
 #include <runtime.hpp> // use_mapping
+#include <sync.hpp>    // spin_lock
 #include <type_traits>
 
 /**
@@ -233,8 +235,12 @@ constexpr pte_t PTE_ATTRINDX(std::uint64_t idx) {
 
 // Attr index conventions (must match MAIR_EL2 programmed by cpu_setup).
 // See xino::mm::paging::make_mair_el2().
-constexpr std::uint64_t MAIR_IDX_NORMAL{0}; // Normal, WBWA
-constexpr std::uint64_t MAIR_IDX_DEVICE{1}; // Device, nGnRnE
+constexpr std::uint64_t MAIR_IDX_NORMAL{0};       // Normal, WBWA
+constexpr std::uint64_t MAIR_IDX_DEVICE{1};       // Device, nGnRnE
+constexpr std::uint64_t MAIR_IDX_NORMAL_NC{2};    // Normal, Non-cacheable
+constexpr std::uint64_t MAIR_IDX_NORMAL_WT{3};    // Normal, WT, RA
+constexpr std::uint64_t MAIR_IDX_DEVICE_nGnRE{4}; // Device, nGnRE
+constexpr std::uint64_t MAIR_IDX_DEVICE_GRE{5};   // Device, GRE
 
 // D8.4.1.2.1 Stage 1 data accesses using Direct permissions (Table D8-63).
 constexpr pte_t PTE_AP_MASK{pte_t{0b11} << PTE_AP_SHIFT};
@@ -272,6 +278,10 @@ constexpr pte_t PTE_S2_MEMATTR(std::uint64_t attr) {
 }
 
 constexpr std::uint64_t S2_MEMATTR_DEVICE_nGnRnE{0x0}; // Device, nGnRnE
+constexpr std::uint64_t S2_MEMATTR_DEVICE_nGnRE{0x1};  // Device, nGnRE
+constexpr std::uint64_t S2_MEMATTR_DEVICE_GRE{0x3};    // Device, GRE
+constexpr std::uint64_t S2_MEMATTR_NORMAL_NC{0x5};     // Normal, outer+inner NC
+constexpr std::uint64_t S2_MEMATTR_NORMAL_WT{0xA};     // Normal, outer+inner WT
 constexpr std::uint64_t S2_MEMATTR_NORMAL_WB{0xF};     // Normal, outer+inner WB
 
 // D8.4.2.1.1 Stage 2 data accesses using Direct permissions (Table D8-76).
@@ -288,6 +298,34 @@ constexpr pte_t PTE_S2_SH_INNER_SHAREABLE{pte_t{3} << PTE_S2_SH_SHIFT};
 // D8.5.1 The Access flag.
 constexpr pte_t PTE_S2_AF{pte_t{1} << PTE_S2_AF_SHIFT};
 
+/* MEMORY TYPES. */
+
+/** @brief Memory type of a mapping, see `xino::mm::prot`. */
+enum class memtype : std::uint8_t {
+  normal,        // Normal, Write-Back.
+  normal_wt,     // Normal, Write-Through.
+  normal_nc,     // Normal, Non-cacheable.
+  device_gre,    // Device-GRE.
+  device_ngnre,  // Device-nGnRE.
+  device_ngnrne, // Device-nGnRnE.
+};
+
+/** @brief Memory type selected by @p p (the strictest if several). */
+[[nodiscard]] constexpr memtype prot_memtype(xino::mm::prot p) noexcept {
+  if (p & prot::DEVICE)
+    return memtype::device_ngnrne;
+  if (p & prot::DEVICE_nGnRE)
+    return memtype::device_ngnre;
+  if (p & prot::DEVICE_GRE)
+    return memtype::device_gre;
+  if (p & prot::NOCACHE)
+    return memtype::normal_nc;
+  if (p & prot::WRITETHROUGH)
+    return memtype::normal_wt;
+
+  return memtype::normal;
+}
+
 /* PTE ENCODERS. */
 
 inline pte_t pte_phys_field_mask() {
@@ -312,7 +350,7 @@ inline pte_t pte_attr_field_mask() {
  *
  * The concrete encoder is supplied via CRTP (`Derived`) and must provide:
  * @code
- * static pte_t encode_attrs(xino::mm::prot p, bool device) noexcept;
+ * static pte_t encode_attrs(xino::mm::prot p) noexcept;
  * @endcode
  *
  * @tparam Derived CRTP-derived encoder type.
@@ -349,9 +387,9 @@ template <typename Derived> struct pte_encoder_base {
   }
 
   // Make a page leaf descriptor.
-  [[nodiscard]] static pte_t make_leaf_page(xino::mm::phys_addr pa, prot p,
-                                            bool device) noexcept {
-    return make_leaf_page_attr(pa, Derived::encode_attrs(p, device));
+  [[nodiscard]] static pte_t make_leaf_page(xino::mm::phys_addr pa,
+                                            prot p) noexcept {
+    return make_leaf_page_attr(pa, Derived::encode_attrs(p));
   }
 
   /**
@@ -367,9 +405,9 @@ template <typename Derived> struct pte_encoder_base {
   }
 
   // Make a block leaf descriptor.
-  [[nodiscard]] static pte_t make_leaf_block(xino::mm::phys_addr pa, prot p,
-                                             bool device) noexcept {
-    return make_leaf_block_attr(pa, Derived::encode_attrs(p, device));
+  [[nodiscard]] static pte_t make_leaf_block(xino::mm::phys_addr pa,
+                                             prot p) noexcept {
+    return make_leaf_block_attr(pa, Derived::encode_attrs(p));
   }
 };
 
@@ -381,12 +419,30 @@ template <stage Stage> struct pte_encoder;
 template <>
 struct pte_encoder<stage::ST_1>
     : public pte_encoder_base<pte_encoder<stage::ST_1>> {
+  /** @brief MAIR_EL2 attribute index of memory type @p t. */
+  [[nodiscard]] static constexpr std::uint64_t attr_index(memtype t) noexcept {
+    switch (t) {
+    case memtype::normal_wt:
+      return MAIR_IDX_NORMAL_WT;
+    case memtype::normal_nc:
+      return MAIR_IDX_NORMAL_NC;
+    case memtype::device_gre:
+      return MAIR_IDX_DEVICE_GRE;
+    case memtype::device_ngnre:
+      return MAIR_IDX_DEVICE_nGnRE;
+    case memtype::device_ngnrne:
+      return MAIR_IDX_DEVICE;
+    default:
+      return MAIR_IDX_NORMAL;
+    }
+  }
+
   /** @brief Helper to compute stage-1 attribute bits. */
-  [[nodiscard]] static pte_t encode_attrs(xino::mm::prot p,
-                                          bool device) noexcept {
+  [[nodiscard]] static pte_t encode_attrs(xino::mm::prot p) noexcept {
     pte_t pte{PTE_TYPE_FAULT};
 
-    pte |= PTE_ATTRINDX(device ? MAIR_IDX_DEVICE : MAIR_IDX_NORMAL);
+    pte |= PTE_ATTRINDX(attr_index(prot_memtype(p)));
+
     pte |= PTE_AF;
     pte |= p & xino::mm::prot::SHARED ? PTE_SH_INNER_SHAREABLE
                                       : PTE_SH_NON_SHAREABLE;
@@ -410,13 +466,30 @@ struct pte_encoder<stage::ST_1>
 template <>
 struct pte_encoder<stage::ST_2>
     : public pte_encoder_base<pte_encoder<stage::ST_2>> {
+  /** @brief Stage-2 `MemAttr` of memory type @p t. */
+  [[nodiscard]] static constexpr std::uint64_t mem_attr(memtype t) noexcept {
+    switch (t) {
+    case memtype::normal_wt:
+      return S2_MEMATTR_NORMAL_WT;
+    case memtype::normal_nc:
+      return S2_MEMATTR_NORMAL_NC;
+    case memtype::device_gre:
+      return S2_MEMATTR_DEVICE_GRE;
+    case memtype::device_ngnre:
+      return S2_MEMATTR_DEVICE_nGnRE;
+    case memtype::device_ngnrne:
+      return S2_MEMATTR_DEVICE_nGnRnE;
+    default:
+      return S2_MEMATTR_NORMAL_WB;
+    }
+  }
+
   /** @brief Helper to compute stage-2 attribute bits. */
-  [[nodiscard]] static pte_t encode_attrs(xino::mm::prot p,
-                                          bool device) noexcept {
+  [[nodiscard]] static pte_t encode_attrs(xino::mm::prot p) noexcept {
     pte_t pte{PTE_TYPE_FAULT};
 
-    pte |= PTE_S2_MEMATTR(device ? S2_MEMATTR_DEVICE_nGnRnE
-                                 : S2_MEMATTR_NORMAL_WB);
+    pte |= PTE_S2_MEMATTR(mem_attr(prot_memtype(p)));
+
     pte |= PTE_AF;
 
     const bool rd{static_cast<bool>(p & xino::mm::prot::READ)};
@@ -515,12 +588,13 @@ public:
    * the root translation table suitable for programming TTBR (stage-1) or VTTBR
    * (stage-2).
    *
-   * @param a Allocator used to allocate and free page-table pages.
+   * @param a Allocator used to allocate and free page-table pages. The page
+   *          table keeps a reference to @p a; it must outlive the page table.
    *
    * @retval `xino::error_nr::ok` Root table allocated and initialized.
    * @retval `xino::error_nr::nomem` Allocation failed (root remains invalid).
    */
-  [[nodiscard]] xino::error_t init(Allocator a) noexcept {
+  [[nodiscard]] xino::error_t init(Allocator &a) noexcept {
     // Check for double initlailize.
     if (allocator || root_pa != xino::mm::phys_addr{0})
       return xino::error_nr::invalid;
@@ -674,9 +748,11 @@ public:
    * rounded up to the granule and this routine unmaps
    * `[a.addr, a.addr + round_up(size, granule_size))`.
    *
-   * Unmapping is performed at page granularity; larger block mappings are split
-   * as needed. Unmapping an already-unmapped region is treated as a no-op for
-   * the corresponding pages.
+   * Each step unmaps the largest translation that @p a is aligned to and the
+   * remaining size covers, so whole blocks (and whole subtrees) are removed
+   * without splitting; larger block mappings that are only partially covered
+   * are split as needed. Unmapping an already-unmapped region is treated as a
+   * no-op for the corresponding pages.
    *
    * @param a Start address (VA + ASID for stage-1, IPA for stage-2).
    * @param size Size in bytes. A size of 0 is a no-op.
@@ -702,11 +778,11 @@ public:
     if (a.addr + size < a.addr)
       return xino::error_nr::overflow;
 
-    // Pick page granule to enforce unmap; it is the safest.
-    const unsigned leaf = levels() - 1;
-    const std::size_t chunk = level_size(leaf);
-
     while (size) {
+      // Pick the largest level fully covered by the remaining range.
+      const unsigned leaf = choose_unmap_level(a, size);
+      const std::size_t chunk = level_size(leaf);
+
       if (auto ret = unmap_one(a, leaf); ret != xino::error_nr::ok)
         return ret;
 
@@ -717,6 +793,49 @@ public:
     return xino::error_nr::ok;
   }
 
+  /**
+   * @brief Look up the translation of a single address.
+   *
+   * Walks the page table for @p a and reports the leaf (block or page) that
+   * translates it.
+   *
+   * @param a Address to translate (VA + ASID for stage-1, IPA for stage-2).
+   * @param[out] pa Receives the physical address @p a translates to.
+   * @param[out] size Receives the mapping size of the leaf, i.e.
+   *             `level_size(level)` of the level the leaf was found at.
+   *
+   * @retval `xino::error_nr::ok` @p a is mapped; @p pa and @p size are valid.
+   * @retval `xino::error_nr::invalid` @p a is not mapped.
+   */
+  [[nodiscard]] xino::error_t lookup(const addr_t &a, xino::mm::phys_addr &pa,
+                                     std::size_t &size) noexcept {
+    using av_t = typename addr_t::addr_type::value_type;
+
+    pte_t *t{root_va()};
+
+    for (unsigned level{0}; level < levels(); level++) {
+      const pte_t entry{t[table_index_at_level(a, level)]};
+
+      if (!entry_is_valid(entry))
+        return xino::error_nr::invalid;
+
+      if (entry_is_table(level, entry)) {
+        // DESCEND:
+        t = pa_to_pte(pte_encoder<Stage>::pte_to_phys(entry));
+        continue;
+      }
+
+      // It is a page or block.
+      size = level_size(level);
+      pa = pte_encoder<Stage>::pte_to_phys(entry) +
+           (static_cast<av_t>(a.addr) & (size - 1));
+
+      return xino::error_nr::ok;
+    }
+
+    return xino::error_nr::invalid;
+  }
+
 private:
   /** @brief Page-table entry update kind. */
   enum class kind : std::uint8_t {
@@ -847,6 +966,25 @@ private:
     return lvls - 1;
   }
 
+  /**
+   * @brief Choose the level at which to unmap the next chunk.
+   *
+   * Same as @ref choose_leaf_level, but only the input address @p a
+   * constrains the alignment.
+   */
+  [[nodiscard]] static unsigned choose_unmap_level(const addr_t &a,
+                                                   std::size_t size) noexcept {
+    const unsigned lvls{levels()};
+
+    for (unsigned level{0}; level < lvls; level++) {
+      if (size >= level_size(level) && a.addr.is_align(level_size(level)))
+        return level;
+    }
+
+    // Select lowest granule.
+    return lvls - 1;
+  }
+
   [[nodiscard]] static unsigned
   table_index_at_level(const addr_t &a, unsigned at_level) noexcept {
     using av_t = typename addr_t::addr_type::value_type;
@@ -885,11 +1023,9 @@ private:
 
   [[nodiscard]] static pte_t
   entry_at_level(xino::mm::phys_addr pa, xino::mm::prot p, unsigned at_level) {
-    const bool device{static_cast<bool>(p & xino::mm::prot::DEVICE)};
-
     return (at_level + 1) < levels()
-               ? pte_encoder<Stage>::make_leaf_block(pa, p, device)
-               : pte_encoder<Stage>::make_leaf_page(pa, p, device);
+               ? pte_encoder<Stage>::make_leaf_block(pa, p)
+               : pte_encoder<Stage>::make_leaf_page(pa, p);
   }
 
   static void invalidate_range(const addr_t &a, std::size_t size) noexcept {
@@ -1383,10 +1519,44 @@ private:
     }
   }
 
-  Allocator *allocator;
-  xino::mm::phys_addr root_pa;
+  Allocator *allocator{nullptr};
+  xino::mm::phys_addr root_pa{};
 };
 
+/* uKernel stage-1 page table (TTBR1_EL2). */
+
+/** @brief Page table type of the uKernel address space. */
+using kernel_page_table_t =
+    page_table<stage::ST_1, xino::allocator::page_allocator_t>;
+
+// `kernel_page_table` is initialized at boot, see mm_paging.cpp.
+extern kernel_page_table_t kernel_page_table;
+// Serializes updates to `kernel_page_table` (ioremap, vmalloc, ...).
+extern xino::sync::spin_lock kernel_page_table_lock;
+
+/**
+ * @brief Block mapping size used by the uKernel page table.
+ *
+ * This is the leaf size one level above the page level (2MB for 4KB granule,
+ * 32MB for 16KB granule).
+ */
+constexpr std::size_t kernel_block_size() noexcept {
+  const unsigned va_bits{xino::mm::va_layout::va_bits};
+  return level_size_for_bits(va_bits, levels_for_bits(va_bits) - 2);
+}
+
+/** @brief Allocate the root of @ref kernel_page_table (panics on failure). */
+void kernel_page_table_init() noexcept;
+
+/**
+ * @brief Check this CPU's translation features (panics if unsupported) and
+ *        fold them into `xino::cpu::state`.
+ *
+ * Every CPU calls it once; `xino::cpu::state` ends up with the intersection
+ * (e.g. the smallest PA range) of all CPUs. Calls must be serialized.
+ */
+void init_paging() noexcept;
+
 } // namespace xino::mm::paging
 
 #endif // __MM_PAGING_HPP__
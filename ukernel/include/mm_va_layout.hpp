@@ -19,6 +19,12 @@
  * **Device mapping window**: `[devmap_va, devmap_end]`
  *  - Size: `UKERNEL_DEVMAP_SLOT_SIZE`
  *  - Intended for temporary or permanent device MMIO mappings.
+ *  - Allocated by `xino::mm::ioremap()`, see mm_ioremap.hpp.
+ *
+ * **vmalloc window**: `[vmalloc_va, vmalloc_end]`
+ *  - Size: `UKERNEL_VMALLOC_SLOT_SIZE`
+ *  - Virtually contiguous kernel buffers backed by scattered pages.
+ *  - Allocated by `xino::mm::vmalloc()`, see mm_vmalloc.hpp.
  *
  * **Direct map window**: `[page_offset, page_end]`
  *  - Provides a linear mapping of physical memory (PA{0}) when the MMU is on.
@@ -36,6 +42,7 @@
 #include <cstdint>
 #include <mm.hpp> // phys_addr, virt_addr
 #include <optional>
+#include <runtime.hpp> // use_mapping
 #include <type_traits>
 
 namespace xino::mm::va_layout {
@@ -79,10 +86,18 @@ constexpr xino::mm::virt_addr devmap_end{ukimage_va - 1};
 constexpr xino::mm::virt_addr devmap_va{devmap_end - devmap_slot_size + 1};
 ///@}
 
+/** @name vmalloc window `[vmalloc_va, vmalloc_end]`. */
+///@{
+// Size (in bytes) reserved for the vmalloc window.
+constexpr std::uintptr_t vmalloc_slot_size{UKERNEL_VMALLOC_SLOT_SIZE};
+constexpr xino::mm::virt_addr vmalloc_end{devmap_va - 1};
+constexpr xino::mm::virt_addr vmalloc_va{vmalloc_end - vmalloc_slot_size + 1};
+///@}
+
 /** @name Direct map window `[page_offset, page_end]`. */
 ///@{
 constexpr xino::mm::virt_addr page_offset{ukernel_va_start};
-constexpr xino::mm::virt_addr page_end{devmap_va - 1};
+constexpr xino::mm::virt_addr page_end{vmalloc_va - 1};
 ///@}
 
 // `ukimage_va_base` and `ukimage_pa_base` are initialized at boot.
@@ -103,6 +118,11 @@ extern std::size_t ukimage_size;
   return devmap_va <= va && va <= devmap_end;
 }
 
+// Call only if MMU is on.
+[[nodiscard]] constexpr bool is_vmalloc(xino::mm::virt_addr va) noexcept {
+  return vmalloc_va <= va && va <= vmalloc_end;
+}
+
 // Call only if MMU is on.
 [[nodiscard]] constexpr bool is_direct_map(xino::mm::virt_addr va) noexcept {
   return page_offset <= va && va <= page_end;
@@ -176,10 +196,68 @@ virt_to_phys(xino::mm::virt_addr va, bool mmu_on = true) noexcept {
            (static_cast<av_t>(va) - static_cast<av_t>(ukimage_va_base));
   }
 
-  // Devmap or unknown address.
+  // Devmap, vmalloc or unknown address.
   return std::nullopt;
 }
 
+/** @name Page frame numbers (PFN). */
+///@{
+[[nodiscard]] constexpr std::size_t
+pa_to_pfn(xino::mm::phys_addr pa) noexcept {
+  using av_t = xino::mm::phys_addr::value_type;
+
+  return static_cast<std::size_t>(static_cast<av_t>(pa) >> granule_shift());
+}
+
+[[nodiscard]] constexpr xino::mm::phys_addr
+pfn_to_pa(std::size_t pfn) noexcept {
+  using av_t = xino::mm::phys_addr::value_type;
+
+  return xino::mm::phys_addr{static_cast<av_t>(pfn) << granule_shift()};
+}
+///@}
+
+/** @name Page descriptors (memmap). */
+///@{
+// Physical base of the memmap and the PFNs `[memmap_start_pfn, memmap_end_pfn)`
+// it describes. Initialized by `xino::mm::memmap_init()`, see mm_memmap.cpp.
+extern xino::mm::phys_addr memmap_pa;
+extern std::size_t memmap_start_pfn;
+extern std::size_t memmap_end_pfn;
+
+// Check if @p pfn has a page descriptor.
+[[nodiscard]] inline bool pfn_valid(std::size_t pfn) noexcept {
+  return memmap_start_pfn <= pfn && pfn < memmap_end_pfn;
+}
+
+// Usable VA of the first page descriptor (via the direct map).
+[[nodiscard]] inline xino::mm::page *memmap_base() noexcept {
+  return phys_to_virt(memmap_pa, xino::runtime::use_mapping)
+      .ptr<xino::mm::page>();
+}
+
+/**
+ * @brief Return the page descriptor of the page containing @p pa.
+ *
+ * @pre `pfn_valid(pa_to_pfn(pa))`.
+ */
+[[nodiscard]] inline xino::mm::page *
+pa_to_page(xino::mm::phys_addr pa) noexcept {
+  return memmap_base() + (pa_to_pfn(pa) - memmap_start_pfn);
+}
+
+/**
+ * @brief Return the physical address of the page described by @p pg.
+ *
+ * @pre @p pg is a descriptor in the memmap.
+ */
+[[nodiscard]] inline xino::mm::phys_addr
+page_to_pa(const xino::mm::page *pg) noexcept {
+  return pfn_to_pa(memmap_start_pfn +
+                   static_cast<std::size_t>(pg - memmap_base()));
+}
+///@}
+
 } // namespace xino::mm::va_layout
 
 #endif // __MM_VA_LAYOUT_HPP__
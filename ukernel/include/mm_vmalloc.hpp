@@ -0,0 +1,64 @@
+/**
+ * @file mm_vmalloc.hpp
+ * @brief Virtually contiguous kernel allocations in the vmalloc window.
+ *
+ * `vmalloc()` returns a buffer that is contiguous in the vmalloc window
+ * `[vmalloc_va, vmalloc_end]` (see mm_va_layout.hpp) but backed by physical
+ * memory that need not be contiguous:
+ *  - Where the VA is block aligned and at least a block remains, a physically
+ *    contiguous block (2MB for 4KB granule) is tried first and mapped with a
+ *    single block descriptor.
+ *  - Otherwise, or if no such block is free, order-0 pages are used.
+ *
+ * Large buffers therefore keep working on a fragmented system, and no physical
+ * memory is wasted rounding the size up to a power of two.
+ *
+ * VA ranges are carved out of the window by a buddy allocator over
+ * `xino::mm::virt_addr`. Each range is one page larger than the rounded size,
+ * so an unmapped guard page always follows a buffer.
+ *
+ * When the uKernel mapping is not established (`xino::runtime::use_mapping` is
+ * false), `vmalloc()` falls back to a physically contiguous allocation.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __MM_VMALLOC_HPP__
+#define __MM_VMALLOC_HPP__
+
+#include <cstddef>
+#include <errno.hpp>
+
+namespace xino::mm {
+
+/**
+ * @brief Initialize the vmalloc VA allocator.
+ *
+ * Must be called once, after @ref xino::mm::paging::kernel_page_table_init()
+ * and before the first @ref vmalloc().
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` The vmalloc window can not be managed.
+ */
+[[nodiscard]] xino::error_t vmalloc_init() noexcept;
+
+/**
+ * @brief Allocate a virtually contiguous kernel buffer.
+ *
+ * @param size Size in bytes; rounded up to the granule size.
+ * @return Page-aligned pointer to the buffer, or `nullptr` if @p size is zero
+ *         or memory (VA or physical) is exhausted.
+ */
+[[nodiscard]] void *vmalloc(std::size_t size) noexcept;
+
+/**
+ * @brief Free a buffer returned by @ref vmalloc().
+ *
+ * @param addr Pointer returned by @ref vmalloc(); `nullptr` is ignored.
+ */
+void vfree(void *addr) noexcept;
+
+} // namespace xino::mm
+
+#endif // __MM_VMALLOC_HPP__
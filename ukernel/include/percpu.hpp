@@ -39,7 +39,15 @@
  * extern xino::percpu::var<std::uint64_t> vmexit_count;
  *
  * void on_vmexit() {
- *   xino::percpu::this_cpu(vmexit_count)++;
+ *   xino::percpu::this_cpu_inc(vmexit_count); // IRQ-safe, single LSE atomic.
+ * }
+ *
+ * // Total over all CPUs.
+ * std::uint64_t vmexits() {
+ *   std::uint64_t sum{0};
+ *   xino::percpu::for_each_cpu(vmexit_count,
+ *                              [&](unsigned, std::uint64_t v) { sum += v; });
+ *   return sum;
  * }
  * @endcode
  *
@@ -49,7 +57,7 @@
  * constinit xino::percpu::hot<std::uint64_t> fast_counter{0};
  *
  * void tick() {
- *   xino::percpu::this_cpu(fast_counter)++;
+ *   xino::percpu::this_cpu_inc(fast_counter);
  * }
  * @endcode
  *
@@ -63,6 +71,29 @@
  * 3. During secondary CPU bring-up:
  *    call `percpu_cpu_online(cpu_idx)` on each CPU to set its TPIDR_EL2 base.
  *
+ * ## Dynamic per-CPU memory
+ *
+ * Per-CPU objects created at runtime are allocated with `alloc_percpu()`.
+ * Each CPU area is the static template followed by `UKERNEL_PERCPU_DYN_SIZE`
+ * bytes for dynamic allocations (the first chunk). Further chunks are
+ * allocated on demand, with the same layout as the CPU areas, so a dynamic
+ * allocation sits at the same offset from every CPU base. The returned
+ * pointer lives in the template address space, like a static per-CPU
+ * symbol, and is translated with the same accessors:
+ *
+ * @code
+ * auto *hits{xino::percpu::alloc_percpu<xino::percpu::hot<std::uint64_t>>()};
+ *
+ * xino::percpu::this_cpu_inc(*hits);
+ * xino::percpu::free_percpu(hits);
+ * @endcode
+ *
+ * A single allocation is at most one CPU area (`unit` bytes) and aligned to
+ * at most `UKERNEL_CACHE_LINE`; memory is zeroed on every CPU.
+ *
+ * CPU areas (and chunks) are rounded to whole pages, so two CPUs never share
+ * a cache line (or a page) of per-CPU data.
+ *
  * ## Design note
  *
  * Some C++ kernels build per-CPU state by allocating a per-CPU area and then
@@ -152,6 +183,219 @@ template <typename T>
   return this_cpu_addr(xino::mm::virt_addr{&sym}).ref<const hot<T>>().value;
 }
 
+/** @brief Translate a per-cpu symbol address to the copy of CPU @p cpu_idx. */
+[[nodiscard]] xino::mm::virt_addr per_cpu_addr(xino::mm::virt_addr sym,
+                                               unsigned cpu_idx) noexcept;
+
+/** @brief CPU @p cpu_idx's copy of a per-CPU variable. */
+template <typename T>
+[[nodiscard]] inline T &per_cpu(var<T> &sym, unsigned cpu_idx) noexcept {
+  return per_cpu_addr(xino::mm::virt_addr{&sym}, cpu_idx).ref<var<T>>().value;
+}
+
+template <typename T>
+[[nodiscard]] inline T &per_cpu(hot<T> &sym, unsigned cpu_idx) noexcept {
+  return per_cpu_addr(xino::mm::virt_addr{&sym}, cpu_idx).ref<hot<T>>().value;
+}
+
+// Defined in percpu.cpp.
+extern var<unsigned> cpu_number;
+
+/** @brief Logical index of the calling CPU (its CPU area). */
+[[nodiscard]] inline unsigned this_cpu_id() noexcept {
+  return this_cpu(cpu_number);
+}
+
+/**
+ * @brief Whether `percpu_bootstrap_init()` has run.
+ *
+ * Before that, TPIDR_EL2 is not set and neither `this_cpu()` nor
+ * `this_cpu_id()` may be used; code that can run that early (e.g. panic())
+ * checks this first.
+ */
+[[nodiscard]] bool ready() noexcept;
+
+/**
+ * @brief Number of CPU areas.
+ *
+ * This is `1` before `percpu_init()`, when the boot CPU runs on the template.
+ */
+[[nodiscard]] unsigned nr_cpu_ids() noexcept;
+
+/** @brief Call `f(cpu_idx)` for every CPU area. */
+template <typename F> void for_each_cpu(F &&f) {
+  const unsigned n{nr_cpu_ids()};
+  for (unsigned cpu{0}; cpu < n; cpu++)
+    f(cpu);
+}
+
+/** @brief Call `f(cpu_idx, value)` with every CPU's copy of @p sym. */
+template <typename T, typename F> void for_each_cpu(var<T> &sym, F &&f) {
+  for_each_cpu([&](unsigned cpu) { f(cpu, per_cpu(sym, cpu)); });
+}
+
+template <typename T, typename F> void for_each_cpu(hot<T> &sym, F &&f) {
+  for_each_cpu([&](unsigned cpu) { f(cpu, per_cpu(sym, cpu)); });
+}
+
+/** @brief This CPU's copy of a (static or dynamic) per-CPU object. */
+template <typename T> [[nodiscard]] inline T *this_cpu_ptr(T *sym) noexcept {
+  return this_cpu_addr(xino::mm::virt_addr{sym}).ptr<T>();
+}
+
+/** @brief CPU @p cpu_idx's copy of a (static or dynamic) per-CPU object. */
+template <typename T>
+[[nodiscard]] inline T *per_cpu_ptr(T *sym, unsigned cpu_idx) noexcept {
+  return per_cpu_addr(xino::mm::virt_addr{sym}, cpu_idx).ptr<T>();
+}
+
+/**
+ * @name IRQ-safe this_cpu operations.
+ *
+ * Each operation reads TPIDR_EL2 and updates this CPU's copy with a single
+ * atomic instruction; with `-march=armv8.1-a` the `__atomic` builtins below
+ * compile to LSE `STADD`/`LDADD`/`SWP`/`CAS`. An IRQ taken on this CPU
+ * between the two steps updates the same copy (tasks do not migrate), and
+ * the update itself cannot be split, so no `irq_save()`/`irq_restore()` pair
+ * is needed.
+ *
+ * Remote CPUs may read the copies (e.g. with `per_cpu()`) concurrently; the
+ * operations are relaxed and give no ordering with other memory accesses.
+ *
+ * @p sym is a per-CPU pointer (`&sym.value` of a static variable, or from
+ * `alloc_percpu()`), or a `var<T>`/`hot<T>` variable.
+ */
+///@{
+template <typename T>
+concept this_cpu_scalar = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+template <typename> inline constexpr bool is_wrapper_v{false};
+template <typename T> inline constexpr bool is_wrapper_v<var<T>>{true};
+template <typename T> inline constexpr bool is_wrapper_v<hot<T>>{true};
+
+/** @brief `var<T>` or `hot<T>` with a `this_cpu_scalar` payload. */
+template <typename W>
+concept this_cpu_wrapper =
+    is_wrapper_v<W> && this_cpu_scalar<decltype(W::value)>;
+
+template <this_cpu_scalar T>
+[[nodiscard]] inline T this_cpu_read(const T *sym) noexcept {
+  return __atomic_load_n(this_cpu_ptr(sym), __ATOMIC_RELAXED);
+}
+
+template <this_cpu_scalar T>
+inline void this_cpu_write(T *sym, std::type_identity_t<T> v) noexcept {
+  __atomic_store_n(this_cpu_ptr(sym), v, __ATOMIC_RELAXED);
+}
+
+/** @brief Add @p v (`STADD`). */
+template <this_cpu_scalar T>
+inline void this_cpu_add(T *sym, std::type_identity_t<T> v) noexcept {
+  (void)__atomic_fetch_add(this_cpu_ptr(sym), v, __ATOMIC_RELAXED);
+}
+
+/** @brief Add @p v and return the new value (`LDADD`). */
+template <this_cpu_scalar T>
+[[nodiscard]] inline T this_cpu_add_return(T *sym,
+                                           std::type_identity_t<T> v) noexcept {
+  return __atomic_add_fetch(this_cpu_ptr(sym), v, __ATOMIC_RELAXED);
+}
+
+template <this_cpu_scalar T> inline void this_cpu_inc(T *sym) noexcept {
+  this_cpu_add(sym, T{1});
+}
+
+template <this_cpu_scalar T> inline void this_cpu_dec(T *sym) noexcept {
+  this_cpu_add(sym, static_cast<T>(-1));
+}
+
+/** @brief Store @p v and return the previous value (`SWP`). */
+template <this_cpu_scalar T>
+[[nodiscard]] inline T this_cpu_xchg(T *sym,
+                                     std::type_identity_t<T> v) noexcept {
+  return __atomic_exchange_n(this_cpu_ptr(sym), v, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Store @p desired if the value is @p expected (`CAS`).
+ *
+ * @return The previous value; the store happened if it equals @p expected.
+ */
+template <this_cpu_scalar T>
+[[nodiscard]] inline T
+this_cpu_cmpxchg(T *sym, std::type_identity_t<T> expected,
+                 std::type_identity_t<T> desired) noexcept {
+  (void)__atomic_compare_exchange_n(this_cpu_ptr(sym), &expected, desired,
+                                    false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  return expected;
+}
+
+template <this_cpu_wrapper W>
+[[nodiscard]] inline auto this_cpu_read(const W &sym) noexcept {
+  return this_cpu_read(&sym.value);
+}
+
+template <this_cpu_wrapper W>
+inline void this_cpu_write(W &sym, decltype(W::value) v) noexcept {
+  this_cpu_write(&sym.value, v);
+}
+
+template <this_cpu_wrapper W>
+inline void this_cpu_add(W &sym, decltype(W::value) v) noexcept {
+  this_cpu_add(&sym.value, v);
+}
+
+template <this_cpu_wrapper W>
+[[nodiscard]] inline auto this_cpu_add_return(W &sym,
+                                              decltype(W::value) v) noexcept {
+  return this_cpu_add_return(&sym.value, v);
+}
+
+template <this_cpu_wrapper W> inline void this_cpu_inc(W &sym) noexcept {
+  this_cpu_inc(&sym.value);
+}
+
+template <this_cpu_wrapper W> inline void this_cpu_dec(W &sym) noexcept {
+  this_cpu_dec(&sym.value);
+}
+
+template <this_cpu_wrapper W>
+[[nodiscard]] inline auto this_cpu_xchg(W &sym, decltype(W::value) v) noexcept {
+  return this_cpu_xchg(&sym.value, v);
+}
+
+template <this_cpu_wrapper W>
+[[nodiscard]] inline auto
+this_cpu_cmpxchg(W &sym, decltype(W::value) expected,
+                 decltype(W::value) desired) noexcept {
+  return this_cpu_cmpxchg(&sym.value, expected, desired);
+}
+///@}
+
+/* Dynamic allocation APIs. */
+
+/**
+ * @brief Allocate @p size bytes of zeroed per-CPU memory.
+ *
+ * @param size Size in bytes, at most the size of a CPU area.
+ * @param align Alignment in bytes (power-of-two, at most
+ *        `UKERNEL_CACHE_LINE`).
+ *
+ * @return Per-CPU pointer (see `this_cpu_ptr()` and `per_cpu_ptr()`), or
+ *         `nullptr` on failure or before `percpu_init()`.
+ */
+[[nodiscard]] void *alloc_percpu(std::size_t size, std::size_t align) noexcept;
+
+/** @brief Allocate a zeroed per-CPU `T` (e.g. `var<U>` or `hot<U>`). */
+template <typename T> [[nodiscard]] inline T *alloc_percpu() noexcept {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::is_trivially_destructible_v<T>);
+  return static_cast<T *>(alloc_percpu(sizeof(T), alignof(T)));
+}
+
+/** @brief Free memory returned by `alloc_percpu()`. */
+void free_percpu(void *ptr) noexcept;
+
 /* Initialization APIs. */
 
 void percpu_bootstrap_init() noexcept;
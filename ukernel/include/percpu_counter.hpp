@@ -0,0 +1,103 @@
+/**
+ * @file percpu_counter.hpp
+ * @brief Scalable counters with per-CPU deltas and batched folding.
+ *
+ * A `percpu_counter` keeps a shared total and a per-CPU delta. Updates only
+ * touch the local delta; when it reaches `batch` in magnitude, it is folded
+ * into the total under the counter lock. Hence:
+ *  - @ref percpu_counter::read is a plain load of the total; it is off by at
+ *    most `nr_cpu_ids() * batch`.
+ *  - @ref percpu_counter::sum adds every CPU's delta to the total; it is
+ *    exact if there are no concurrent updates.
+ *
+ * @par Example
+ * @code
+ * static constinit xino::percpu::percpu_counter faults{};
+ *
+ * // After percpu_init():
+ * if (faults.init() != xino::error_nr::ok)
+ *   xino::cpu::panic();
+ *
+ * faults.inc();                      // Hot path, local only.
+ * std::int64_t approx{faults.read()};
+ * std::int64_t exact{faults.sum()};
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __PERCPU_COUNTER_HPP__
+#define __PERCPU_COUNTER_HPP__
+
+#include <cstdint>
+#include <errno.hpp>
+#include <percpu.hpp>
+#include <sync.hpp>
+
+namespace xino::percpu {
+
+/**
+ * @class percpu_counter
+ * @brief Counter with per-CPU deltas folded into a shared total.
+ *
+ * The per-CPU deltas are allocated with `alloc_percpu()`, so @ref init must
+ * be called after `percpu_init()`.
+ */
+class percpu_counter {
+public:
+  /** @brief Default fold threshold. */
+  static constexpr std::int32_t default_batch{32};
+
+  constexpr percpu_counter() noexcept = default;
+
+  percpu_counter(const percpu_counter &) = delete;
+  percpu_counter &operator=(const percpu_counter &) = delete;
+
+  /**
+   * @brief Allocate the per-CPU deltas and set the total to @p value.
+   *
+   * @retval `xino::error_nr::ok` Success.
+   * @retval `xino::error_nr::invalid` @p batch_size is not positive.
+   * @retval `xino::error_nr::nomem` Per-CPU allocation failed.
+   */
+  [[nodiscard]] xino::error_t
+  init(std::int64_t value = 0,
+       std::int32_t batch_size = default_batch) noexcept;
+
+  /** @brief Release the per-CPU deltas. */
+  void destroy() noexcept;
+
+  /** @brief Add @p delta on this CPU, folding when the batch is reached. */
+  void add(std::int64_t delta) noexcept;
+
+  void inc() noexcept { add(1); }
+  void dec() noexcept { add(-1); }
+
+  /** @brief Approximate value (the folded total). */
+  [[nodiscard]] std::int64_t read() const noexcept {
+    return __atomic_load_n(&count, __ATOMIC_RELAXED);
+  }
+
+  /** @brief Approximate value, clamped at zero. */
+  [[nodiscard]] std::int64_t read_positive() const noexcept {
+    const std::int64_t v{read()};
+    return v < 0 ? 0 : v;
+  }
+
+  /** @brief Exact value: the total plus every CPU's delta. */
+  [[nodiscard]] std::int64_t sum() noexcept;
+
+  /** @brief Set the total to @p value and clear every CPU's delta. */
+  void set(std::int64_t value) noexcept;
+
+private:
+  std::int64_t count{0};
+  std::int32_t batch{default_batch};
+  var<std::int64_t> *deltas{nullptr};
+  xino::sync::spin_lock lock{"percpu_counter"};
+};
+
+} // namespace xino::percpu
+
+#endif // __PERCPU_COUNTER_HPP__
@@ -0,0 +1,79 @@
+/**
+ * @file plat_gic.hpp
+ * @brief GICv3 interrupt controller driver.
+ *
+ * The driver programs the distributor (GICD) once, and the redistributor
+ * (GICR) and the system-register CPU interface (`ICC_*`) on every CPU. All
+ * interrupts are Non-secure Group 1, with a single priority, and are taken
+ * at EL2 (`HCR_EL2.{IMO,FMO}`); SPIs are routed to the boot CPU.
+ *
+ * The GIC is found in the DTB (`arm,gic-v3`: `reg` 0 is the distributor and
+ * `reg` 1 the redistributor region); without a DTB the platform
+ * configuration is used (`UKERNEL_GICD_BASE`, `UKERNEL_GICR_BASE` and
+ * `UKERNEL_GICR_SIZE`).
+ *
+ * Handlers run from the IRQ vector with IRQs masked, see exception.hpp.
+ *
+ * See https://developer.arm.com/documentation/ihi0069 (GICv3/v4).
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __PLAT_GIC_HPP__
+#define __PLAT_GIC_HPP__
+
+#include <cpumask.hpp>
+#include <errno.hpp>
+
+namespace xino::plat::gic {
+
+/** @brief Interrupt handler; @p intid is the acknowledged interrupt. */
+using irq_handler_t = void (*)(unsigned intid, void *arg);
+
+constexpr unsigned nr_sgis{16};    /**< SGIs: INTID 0-15. */
+constexpr unsigned first_spi{32};  /**< PPIs: 16-31, SPIs: 32-1019. */
+constexpr unsigned max_intid{1020}; /**< INTIDs 1020-1023 are special. */
+
+/**
+ * @brief Initialize the distributor (boot CPU, once).
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` No GICv3 found, or it can not be mapped.
+ */
+[[nodiscard]] xino::error_t init() noexcept;
+
+/**
+ * @brief Initialize this CPU's redistributor and CPU interface.
+ *
+ * Call on every CPU, after init() and `percpu_cpu_online()`.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` No redistributor for this CPU.
+ */
+[[nodiscard]] xino::error_t cpu_init() noexcept;
+
+/** @brief Install @p fn for @p intid (before enabling it). */
+void set_handler(unsigned intid, irq_handler_t fn, void *arg) noexcept;
+
+/** @brief Enable @p intid (SGIs and PPIs: on this CPU only). */
+void enable(unsigned intid) noexcept;
+
+/** @brief Disable @p intid (SGIs and PPIs: on this CPU only). */
+void disable(unsigned intid) noexcept;
+
+/**
+ * @brief Send SGI @p sgi to every CPU in @p targets.
+ *
+ * CPUs that share Aff3.Aff2.Aff1 and the same 16-CPU range of Aff0 are
+ * reached with a single `ICC_SGI1R_EL1` write. Stores before the call are
+ * visible to the targets when they take the SGI.
+ */
+void send_sgi(unsigned sgi, const xino::smp::cpumask &targets) noexcept;
+
+/** @brief Acknowledge and dispatch pending interrupts (IRQ vector). */
+void handle_irq() noexcept;
+
+} // namespace xino::plat::gic
+
+#endif // __PLAT_GIC_HPP__
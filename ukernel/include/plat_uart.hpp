@@ -7,11 +7,34 @@
  *
  *   - `init(base, fifo=false)` - bring-up; selects the device MMIO base.
  *   - `putc(char)` - blocking TX of a single character (CRLF on '\n').
+ *   - `write(buf, count)` - blocking TX of a string (CRLF on '\n') in FIFO
+ *     bursts: wait once for the FIFO to drain, then fill it with relaxed
+ *     writes after a single barrier.
  *   - `set_base(base)` - change the active MMIO base at runtime.
+ *   - `compatible` - device tree `compatible` string of the device.
+ *   - `tx_ready()` / `tx_put(char)` - non-blocking raw TX (no CRLF).
+ *   - `tx_irq(on)` / `tx_irq_ack()` - (un)mask and acknowledge the TX
+ *     interrupt.
  *
  * A convenience alias `xino::plat::uart::driver` is selected at build time
  * via `<config.h>` (e.g., `using driver = PL011;`).
  *
+ * On top of the driver, the console has two TX paths:
+ *   - **Polled**: console_write() calls `driver::write()` and spins on the
+ *     FIFO. Used from early boot until tx_async_init(), and again after
+ *     console_sync() (panic and fatal exceptions).
+ *   - **Asynchronous**: console_write() copies the text (already CRLF
+ *     translated) into a lock-free multi-producer ring and returns. The
+ *     ring is drained into the FIFO by whoever gets the TX lock first: the
+ *     writer itself (as much as fits without waiting), the TX interrupt
+ *     handler, or an idle CPU (tx_kick() from `cpu_idle()`). A writer only
+ *     waits for the UART when the ring is full.
+ *
+ * `stdout` and `stderr` are buffered per CPU: each stdio call formats into
+ * this CPU's 256-byte buffer, and the buffer reaches console_write() in one
+ * piece when `stdout` sees a newline or fills up, and at the end of every
+ * `stderr` call. console_sync() also writes this CPU's partial `stdout` line.
+ *
  * @author Amirreza Zarrabi
  * @date 2025
  */
@@ -19,8 +42,11 @@
 #ifndef __PLAT_UART_HPP__
 #define __PLAT_UART_HPP__
 
+#include <cache.hpp>
 #include <config.h> // for UKERNEL_UART_DRIVER and UKERNEL_UART_BASE.
+#include <cstddef>
 #include <cstdint>
+#include <errno.hpp>
 #include <io.hpp> // for writel() and readl_relaxed().
 #include <mm.hpp> // for virt_addr.
 
@@ -40,7 +66,7 @@ namespace xino::plat::uart {
 class PL011 {
 private:
   /** @brief Active MMIO base; zero means "not initialized". */
-  inline static xino::mm::virt_addr uart_base{};
+  __read_mostly inline static xino::mm::virt_addr uart_base{};
 
   [[nodiscard]] static xino::mm::virt_addr reg(std::uintptr_t off) noexcept {
     return uart_base + off;
@@ -56,11 +82,24 @@ private:
 
   // Bitfields.
   static constexpr std::uint32_t UARTFR_TXFF{1U << 5};   /**< TX FIFO full. */
+  static constexpr std::uint32_t UARTFR_TXFE{1U << 7};   /**< TX FIFO empty. */
+  static constexpr std::uint32_t UARTIMSC_TXIM{1U << 5}; /**< TX IRQ mask. */
+  static constexpr std::uint32_t UARTICR_TXIC{1U << 5};  /**< TX IRQ clear. */
   static constexpr std::uint32_t UARTCR_UARTEN{1U << 0}; /**< UART enable. */
   static constexpr std::uint32_t UARTCR_TXE{1U << 8};    /**< TX enable. */
   static constexpr std::uint32_t UARTLCR_H_WLEN_8{3U << 5}; /**< 8-bit. */
   static constexpr std::uint32_t UARTLCR_H_FEN{1U << 4};    /**< FIFO enable. */
 
+  // Peripheral identification; bits [7:4] of UARTPeriphID2 are the revision.
+  static constexpr std::uintptr_t UARTPeriphID2{0xfe8};
+  static constexpr unsigned UARTPeriphID2_REV_SHIFT{4};
+
+  /** @brief TX FIFO entries: 32 from r1p5 (revision 3), 16 before. */
+  __read_mostly inline static std::size_t fifo_depth{16};
+
+  /** @brief FIFOs were enabled by init(). */
+  __read_mostly inline static bool fifo_enabled{};
+
   /** @brief Busy-wait until TX FIFO has space. */
   static void wait_tx_space_at() noexcept {
     while (xino::io::readl_relaxed(reg(UARTFR)) & UARTFR_TXFF) {
@@ -68,16 +107,48 @@ private:
     }
   }
 
+  /** @brief Busy-wait until TX FIFO (or holding register) is empty. */
+  static void wait_tx_empty_at() noexcept {
+    while (!(xino::io::readl_relaxed(reg(UARTFR)) & UARTFR_TXFE)) {
+      /* Spin. */
+    }
+  }
+
 public:
   PL011() = delete;
 
+  static constexpr const char *compatible{"arm,pl011"};
+
   static void init(const xino::mm::virt_addr &new_base,
                    bool fifo = false) noexcept;
   static void putc(char c) noexcept;
+  static void write(const char *buf, std::size_t count) noexcept;
   /** @brief Change the base without reprogramming (for pure VA remap). */
   static void set_base(const xino::mm::virt_addr &new_base) noexcept {
     uart_base = new_base;
   }
+
+  /** @brief Whether the TX FIFO can take one more character. */
+  [[nodiscard]] static bool tx_ready() noexcept {
+    return !(xino::io::readl_relaxed(reg(UARTFR)) & UARTFR_TXFF);
+  }
+
+  /** @brief Write @p c to the TX FIFO; call only if tx_ready(). */
+  static void tx_put(char c) noexcept {
+    xino::io::writel(static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)),
+                     reg(UARTDR));
+  }
+
+  /**
+   * @brief Unmask (@p on) or mask the TX interrupt.
+   *
+   * The PL011 raises it when the FIFO level drops through the trigger level,
+   * so unmask it only while the FIFO is full.
+   */
+  static void tx_irq(bool on) noexcept;
+  static void tx_irq_ack() noexcept {
+    xino::io::writel(UARTICR_TXIC, reg(UARTICR));
+  }
 };
 
 /**
@@ -89,7 +160,7 @@ public:
 class DW_APB {
 private:
   /** @brief Active MMIO base; zero means "not initialized". */
-  inline static xino::mm::virt_addr uart_base{};
+  __read_mostly inline static xino::mm::virt_addr uart_base{};
 
   [[nodiscard]] static xino::mm::virt_addr reg(std::uintptr_t off) noexcept {
     return uart_base + off;
@@ -102,6 +173,10 @@ private:
   static constexpr std::uintptr_t LCR{0x000c}; /**< Line Control. */
   static constexpr std::uintptr_t MCR{0x0010}; /**< Modem Control. */
   static constexpr std::uintptr_t LSR{0x0014}; /**< Line Status. */
+  static constexpr std::uintptr_t USR{0x007c}; /**< UART Status. */
+
+  /** @brief IIR shares the FCR offset; reading it acks a THRE interrupt. */
+  static constexpr std::uintptr_t IIR{FCR};
 
   // Bitfields.
   static constexpr std::uint32_t LCR_WLEN8{3U};       /**< 8-bit. */
@@ -111,8 +186,22 @@ private:
   static constexpr std::uint32_t LSR_THRE{
       1U << 5}; /**< Transmit Holding Register Empty. */
   static constexpr std::uint32_t LSR_TEMT{1U << 6}; /**< Transmitter empty. */
+  static constexpr std::uint32_t USR_TFNF{1U << 1}; /**< TX FIFO not full. */
+  static constexpr std::uint32_t IER_ETBEI{
+      1U << 1}; /**< Enable Transmit Holding Register Empty Interrupt. */
 
-  static void wait_tx_space_at() noexcept {
+  /** @brief FIFOs were enabled by init(). */
+  __read_mostly inline static bool fifo_enabled{};
+
+  static constexpr std::size_t fifo_depth{64}; /**< TX FIFO entries. */
+
+  /**
+   * @brief Busy-wait until TX FIFO (or holding register) is empty.
+   *
+   * `THRE` reports an empty FIFO, as programmable THRE mode is not used;
+   * there is no "FIFO not full" bit, so putc() waits for empty as well.
+   */
+  static void wait_tx_empty_at() noexcept {
     while (!(xino::io::readl_relaxed(reg(LSR)) & LSR_THRE)) {
       /* Spin. */
     }
@@ -121,19 +210,87 @@ private:
 public:
   DW_APB() = delete;
 
+  static constexpr const char *compatible{"snps,dw-apb-uart"};
+
   static void init(const xino::mm::virt_addr &new_base,
                    bool fifo = false) noexcept;
   static void putc(char c) noexcept;
+  static void write(const char *buf, std::size_t count) noexcept;
   /** @brief Change the base without reprogramming (for pure VA remap). */
   static void set_base(const xino::mm::virt_addr &new_base) noexcept {
     uart_base = new_base;
   }
+
+  /** @brief Whether the TX FIFO (or holding register) can take a character. */
+  [[nodiscard]] static bool tx_ready() noexcept {
+    return fifo_enabled ? (xino::io::readl_relaxed(reg(USR)) & USR_TFNF)
+                        : (xino::io::readl_relaxed(reg(LSR)) & LSR_THRE);
+  }
+
+  /** @brief Write @p c to the TX FIFO; call only if tx_ready(). */
+  static void tx_put(char c) noexcept {
+    xino::io::writel(static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)),
+                     reg(THR));
+  }
+
+  /**
+   * @brief Unmask (@p on) or mask the THRE interrupt.
+   *
+   * The interrupt is raised while the FIFO is empty, so it fires right away
+   * if unmasked with nothing queued.
+   */
+  static void tx_irq(bool on) noexcept {
+    xino::io::writel(on ? IER_ETBEI : 0x0, reg(IER));
+  }
+  static void tx_irq_ack() noexcept {
+    (void)xino::io::readl_relaxed(reg(IIR));
+  }
 };
 
 /* class xxx_uart { ... }; */
 
 /* Build time selected UART backend alias. */
 using driver = UKERNEL_UART_DRIVER;
+
+/**
+ * @brief Switch the console to the asynchronous TX path.
+ *
+ * The TX interrupt is the first entry of the `interrupts` property of the
+ * DTB `stdout-path` node. Call on the boot CPU after `uart_remap()` and
+ * `xino::plat::gic::init()`.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` No usable TX interrupt; the console
+ *         stays polled.
+ */
+[[nodiscard]] xino::error_t tx_async_init() noexcept;
+
+/**
+ * @brief Write @p count characters to the console ('\n' becomes CRLF).
+ *
+ * Safe from any context; in asynchronous mode, it returns once the text is
+ * queued. The text is queued a batch of chunks (about 180 characters) at a
+ * time, so a longer write may interleave with other CPUs' output.
+ */
+void console_write(const char *buf, std::size_t count) noexcept;
+
+/**
+ * @brief Drain the queued text without waiting for the UART (any CPU).
+ *
+ * Does nothing if another CPU is draining already.
+ */
+void tx_kick() noexcept;
+
+/**
+ * @brief Flush the queued text and switch back to the polled TX path.
+ *
+ * For panic and fatal exception paths (`xino::cpu::panic()` calls it): no
+ * interrupt is needed, and if the TX lock is held (e.g. the CPU faulted
+ * while draining), it is taken over after a short timeout. Before
+ * tx_async_init(), nothing is queued and only this CPU's `stdout` buffer
+ * is written.
+ */
+void console_sync() noexcept;
 } // namespace xino::plat::uart
 
 #endif // __PLAT_UART_HPP__
@@ -0,0 +1,55 @@
+/**
+ * @file psci.hpp
+ * @brief Power State Coordination Interface (PSCI) client.
+ *
+ * PSCI calls are made to the firmware (EL3) with `SMC`, following the SMC
+ * Calling Convention. The DTB `/psci` node must use `method = "smc"`: the
+ * uKernel runs at EL2, where `HVC` would trap to the uKernel itself.
+ *
+ * PSCI 0.2 and later use the standard function IDs; PSCI 0.1 (`arm,psci`)
+ * takes the `CPU_ON` function ID from the `cpu_on` property.
+ *
+ * See https://developer.arm.com/documentation/den0022 (PSCI) and
+ * https://developer.arm.com/documentation/den0028 (SMCCC).
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __PSCI_HPP__
+#define __PSCI_HPP__
+
+#include <cstdint>
+#include <errno.hpp>
+#include <mm.hpp> // phys_addr
+
+namespace xino::psci {
+
+/**
+ * @brief Find the PSCI firmware interface in the DTB.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::invalid` No (usable) `/psci` node.
+ */
+[[nodiscard]] xino::error_t init() noexcept;
+
+/** @brief PSCI version (major in bits [31:16]), or 0 before init(). */
+[[nodiscard]] std::uint32_t version() noexcept;
+
+/**
+ * @brief Power up the CPU with affinity @p mpidr.
+ *
+ * The CPU starts at physical address @p entry, at EL2, with the MMU off and
+ * `x0` = @p context_id. The call returns as soon as the firmware accepted
+ * the request, so several CPUs can be started in parallel.
+ *
+ * @retval `xino::error_nr::ok` The CPU is being powered up.
+ * @retval `xino::error_nr::invalid` No PSCI, or the firmware refused.
+ */
+[[nodiscard]] xino::error_t cpu_on(std::uint64_t mpidr,
+                                   xino::mm::phys_addr entry,
+                                   std::uint64_t context_id) noexcept;
+
+} // namespace xino::psci
+
+#endif // __PSCI_HPP__
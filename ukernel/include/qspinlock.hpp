@@ -0,0 +1,127 @@
+/**
+ * @file qspinlock.hpp
+ * @brief Queued (MCS) spin lock in 32 bits.
+ *
+ * `queued_spin_lock` is a fair alternative to `spin_lock` for contended
+ * locks. Waiters queue in FIFO order on per-CPU MCS nodes, and each waiter
+ * spins on its own node instead of the lock word, so a release only touches
+ * the cache line of the next waiter.
+ *
+ * Lock word layout:
+ * @code
+ *  31              18 17 16 15        8 7          0
+ * +------------------+-----+-----------+------------+
+ * |  tail CPU + 1    | idx |  (unused) |   locked   |
+ * +------------------+-----+-----------+------------+
+ * @endcode
+ *  - `locked`: the owner holds the lock.
+ *  - `tail`: last queued waiter, as CPU index + 1 and node index (0 if the
+ *    queue is empty).
+ *
+ * The uncontended path is a single CAS (`0 -> locked`), like `spin_lock`.
+ * A contended acquire appends a node with one atomic on the tail. The queue
+ * head waits for the owner to release, then takes the lock and hands headship
+ * to the next node.
+ *
+ * Every CPU has `max_nesting` nodes, one per context that may spin at the
+ * same time (thread, IRQ, FIQ, SError). Deeper nesting falls back to
+ * spinning on the lock word.
+ *
+ * Waiting uses `SEVL`/`WFE` and releases use `SEV`, as in `spin_lock`.
+ *
+ * @note Per-CPU nodes are reached through `xino::percpu`; the lock can be
+ *       used before `percpu_init()` by the boot CPU alone.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __QSPINLOCK_HPP__
+#define __QSPINLOCK_HPP__
+
+#include <cpu.hpp>
+#include <cstdint>
+#include <sync.hpp>
+
+namespace xino::sync {
+
+/**
+ * @class queued_spin_lock
+ * @brief Fair, queued spin lock with the `spin_lock` interface.
+ */
+class queued_spin_lock {
+public:
+  /** @brief Per-CPU nodes (contexts that may spin concurrently on a CPU). */
+  static constexpr unsigned max_nesting{4};
+
+  static constexpr std::uint32_t locked_mask{0xffU};
+  static constexpr unsigned tail_idx_shift{16};
+  static constexpr std::uint32_t tail_idx_mask{0x3U << tail_idx_shift};
+  static constexpr unsigned tail_cpu_shift{18};
+  static constexpr std::uint32_t tail_cpu_mask{0x3fffU << tail_cpu_shift};
+  static constexpr std::uint32_t tail_mask{tail_idx_mask | tail_cpu_mask};
+
+  /** @brief Largest number of CPUs the tail can encode. */
+  static constexpr unsigned max_cpus{(tail_cpu_mask >> tail_cpu_shift)};
+
+  constexpr queued_spin_lock() noexcept : val{0} {}
+
+  queued_spin_lock(const queued_spin_lock &) = delete;
+  queued_spin_lock &operator=(const queued_spin_lock &) = delete;
+
+  /** @brief Acquire the lock (spins until successful). */
+  void lock() noexcept {
+    std::uint32_t expected{0};
+    if (__atomic_compare_exchange_n(&val, &expected, 1, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      return;
+
+    lock_slowpath();
+  }
+
+  /**
+   * @brief Try to acquire the lock once.
+   *
+   * @return true on success, false if held or contended.
+   */
+  [[nodiscard]] bool try_lock() noexcept {
+    std::uint32_t expected{0};
+    return __atomic_compare_exchange_n(&val, &expected, 1, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+  }
+
+  /** @brief Release the lock. */
+  void unlock() noexcept {
+    // Clear the locked byte only; the tail may change concurrently (LDCLRL).
+    (void)__atomic_fetch_and(&val, ~locked_mask, __ATOMIC_RELEASE);
+    xino::cpu::sev();
+  }
+
+  /** @brief Acquire the lock with IRQs and FIQs masked. */
+  [[nodiscard]] irq_flags_t lock_irqsave() noexcept {
+    irq_flags_t f = irq_save();
+    lock();
+    return f;
+  }
+
+  /** @brief Release the lock and restore IRQ flags from lock_irqsave(). */
+  void unlock_irqrestore(irq_flags_t f) noexcept {
+    unlock();
+    irq_restore(f);
+  }
+
+  [[nodiscard]] bool is_locked() const noexcept {
+    return (__atomic_load_n(&val, __ATOMIC_RELAXED) & locked_mask) != 0;
+  }
+
+private:
+  void lock_slowpath() noexcept;
+
+  alignas(4) std::uint32_t val;
+};
+
+static_assert(sizeof(queued_spin_lock) == sizeof(std::uint32_t));
+
+} // namespace xino::sync
+
+#endif // __QSPINLOCK_HPP__
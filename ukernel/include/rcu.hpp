@@ -0,0 +1,136 @@
+/**
+ * @file rcu.hpp
+ * @brief Quiescent-state-based RCU (QSBR) for read-mostly data.
+ *
+ * Readers take no lock and write no shared memory: rcu_read_lock() and
+ * rcu_read_unlock() are compiler barriers. Updaters publish a new version
+ * with rcu_assign_pointer() and free the old version only after a **grace
+ * period**, when every CPU has passed a quiescent state (a point where it
+ * holds no RCU reference).
+ *
+ * The uKernel does not preempt, so a CPU is quiescent whenever it is between
+ * read-side critical sections. CPUs report it by calling
+ * rcu_quiescent_state() on the natural boundaries of their loop: context
+ * switch, guest exit, or before waiting for work. An idle or offline CPU is
+ * in an **extended** quiescent state (rcu_idle_enter() to rcu_idle_exit())
+ * and never holds up a grace period.
+ *
+ * Grace periods are numbered: `gp_requested` counts the requested grace
+ * periods and `gp_completed` the completed ones. Each CPU records in its
+ * per-CPU data the last `gp_requested` it observed in a quiescent state; a
+ * grace period completes when every CPU has recorded it (or is idle).
+ *
+ * Deferred frees (call_rcu()) are batched per CPU: callbacks queued between
+ * two quiescent states of a CPU wait for a single grace period.
+ *
+ * @par Example
+ * @code
+ * struct config {
+ *   xino::rcu::rcu_head rcu;
+ *   std::uint64_t value;
+ * };
+ *
+ * constinit config *cfg{};
+ *
+ * // Reader.
+ * xino::rcu::rcu_read_lock();
+ * const config *c{xino::rcu::rcu_dereference(cfg)};
+ * use(c->value);
+ * xino::rcu::rcu_read_unlock();
+ *
+ * // Updater (serialized by the caller).
+ * config *old{cfg};
+ * xino::rcu::rcu_assign_pointer(cfg, updated);
+ * xino::rcu::call_rcu(&old->rcu, [](xino::rcu::rcu_head *h) {
+ *   delete reinterpret_cast<config *>(h);
+ * });
+ * @endcode
+ *
+ * @note Read-side critical sections must not block, or call
+ *       rcu_quiescent_state(), synchronize_rcu() or rcu_idle_enter().
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __RCU_HPP__
+#define __RCU_HPP__
+
+#include <barrier.hpp>
+
+namespace xino::rcu {
+
+/** @brief Callback node embedded in an object freed with call_rcu(). */
+struct rcu_head {
+  rcu_head *next;
+  void (*func)(rcu_head *);
+};
+
+/** @brief Enter a read-side critical section (compiler barrier only). */
+[[gnu::always_inline]] inline void rcu_read_lock() noexcept {
+  xino::barrier::barrier();
+}
+
+/** @brief Leave a read-side critical section (compiler barrier only). */
+[[gnu::always_inline]] inline void rcu_read_unlock() noexcept {
+  xino::barrier::barrier();
+}
+
+/** @brief Load an RCU-protected pointer inside a read-side section. */
+template <typename T>
+[[nodiscard, gnu::always_inline]] inline T *
+rcu_dereference(T *const &p) noexcept {
+  return __atomic_load_n(&p, __ATOMIC_CONSUME);
+}
+
+/** @brief Publish @p v; stores initializing `*v` are visible before it. */
+template <typename T>
+[[gnu::always_inline]] inline void rcu_assign_pointer(T *&p, T *v) noexcept {
+  __atomic_store_n(&p, v, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Report a quiescent state for this CPU.
+ *
+ * Also advances grace periods and invokes the callbacks of this CPU whose
+ * grace period has completed. Call it outside any read-side section, with
+ * IRQs unmasked or masked.
+ */
+void rcu_quiescent_state() noexcept;
+
+/** @brief Enter an extended quiescent state (idle or offline CPU). */
+void rcu_idle_enter() noexcept;
+
+/** @brief Leave the extended quiescent state entered by rcu_idle_enter(). */
+void rcu_idle_exit() noexcept;
+
+/**
+ * @brief Start taking part in grace periods.
+ *
+ * CPUs start offline (in an extended quiescent state). Call after
+ * `percpu_init()`, on the CPU itself.
+ */
+inline void rcu_cpu_online() noexcept { rcu_idle_exit(); }
+
+/** @brief Stop taking part in grace periods. */
+inline void rcu_cpu_offline() noexcept { rcu_idle_enter(); }
+
+/**
+ * @brief Invoke `func(head)` after a grace period.
+ *
+ * The callback runs from rcu_quiescent_state() on this CPU. It is IRQ-safe
+ * and never waits.
+ */
+void call_rcu(rcu_head *head, void (*func)(rcu_head *)) noexcept;
+
+/**
+ * @brief Wait for a full grace period.
+ *
+ * Returns once every read-side section that was running on entry has
+ * finished. Spins (`WFE`) until the other CPUs report quiescent states.
+ */
+void synchronize_rcu() noexcept;
+
+} // namespace xino::rcu
+
+#endif // __RCU_HPP__
@@ -0,0 +1,436 @@
+/**
+ * @file ring.hpp
+ * @brief Lock-free ring queues for handing work between CPUs.
+ *
+ * This header provides two bounded FIFO queues of trivially copyable
+ * elements:
+ *   - `xino::sync::spsc_ring`: one producer and one consumer.
+ *   - `xino::sync::mpsc_ring`: any number of producers and one consumer.
+ *
+ * Both take and return batches, and come with blocking variants that wait
+ * with `SEVL`/`WFE`, consistent with `spin_lock`. Every enqueue and dequeue
+ * sends `SEV`, so a waiter on the other side wakes up.
+ *
+ * `xino::sync::overwrite_ring` is not a queue: its single producer never
+ * waits and overwrites the oldest records, and readers copy records out
+ * without consuming them (e.g. per-CPU log and trace buffers).
+ *
+ * Indices run freely and are reduced modulo `N` (a power of two). The
+ * producer and consumer indices live on separate cache lines, and each side
+ * caches the other side's index, so a non-full and non-empty ring does not
+ * bounce cache lines between the two sides.
+ *
+ * Ordering uses acquire loads and release stores (`LDAR`/`STLR`), which are
+ * one-way barriers, instead of `smp_rmb()`/`smp_wmb()` fences. The
+ * multi-producer ring claims slots with `CAS`.
+ *
+ * @par Example
+ * @code
+ * struct request {
+ *   void (*fn)(void *);
+ *   void *arg;
+ * };
+ *
+ * constinit xino::sync::mpsc_ring<request, 64> requests{};
+ *
+ * // Any CPU.
+ * requests.push_wait({fn, arg});
+ *
+ * // Owner CPU.
+ * request r[8];
+ * const std::size_t n{requests.pop_n(r, 8)};
+ * for (std::size_t i{0}; i < n; i++)
+ *   r[i].fn(r[i].arg);
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __RING_HPP__
+#define __RING_HPP__
+
+#include <config.h> // for UKERNEL_CACHE_LINE
+#include <cpu.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace xino::sync {
+
+/**
+ * @class spsc_ring
+ * @brief Single-producer, single-consumer ring of @p N elements.
+ *
+ * @tparam T Element type (trivially copyable).
+ * @tparam N Capacity (a power of two).
+ */
+template <typename T, std::size_t N> class spsc_ring {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  constexpr spsc_ring() noexcept = default;
+
+  spsc_ring(const spsc_ring &) = delete;
+  spsc_ring &operator=(const spsc_ring &) = delete;
+
+  /**
+   * @brief Enqueue up to @p n elements (producer only).
+   *
+   * @return Number of elements enqueued (less than @p n if the ring fills).
+   */
+  std::size_t push_n(const T *v, std::size_t n) noexcept {
+    const std::size_t t{tail};
+
+    if (N - (t - cached_head) < n)
+      cached_head = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+    const std::size_t room{N - (t - cached_head)};
+    if (n > room)
+      n = room;
+
+    if (n == 0)
+      return 0;
+
+    for (std::size_t i{0}; i < n; i++)
+      slots[(t + i) & (N - 1)] = v[i];
+
+    __atomic_store_n(&tail, t + n, __ATOMIC_RELEASE);
+    xino::cpu::sev();
+
+    return n;
+  }
+
+  /**
+   * @brief Dequeue up to @p n elements (consumer only).
+   *
+   * @return Number of elements dequeued (less than @p n if the ring empties).
+   */
+  std::size_t pop_n(T *v, std::size_t n) noexcept {
+    const std::size_t h{head};
+
+    if (cached_tail - h < n)
+      cached_tail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+
+    const std::size_t avail{cached_tail - h};
+    if (n > avail)
+      n = avail;
+
+    if (n == 0)
+      return 0;
+
+    for (std::size_t i{0}; i < n; i++)
+      v[i] = slots[(h + i) & (N - 1)];
+
+    // Release: the slots are read before the producer may reuse them.
+    __atomic_store_n(&head, h + n, __ATOMIC_RELEASE);
+    xino::cpu::sev();
+
+    return n;
+  }
+
+  [[nodiscard]] bool push(const T &v) noexcept { return push_n(&v, 1) == 1; }
+  [[nodiscard]] bool pop(T &v) noexcept { return pop_n(&v, 1) == 1; }
+
+  /** @brief Enqueue @p v, waiting (`WFE`) while the ring is full. */
+  void push_wait(const T &v) noexcept {
+    xino::cpu::sevl();
+    while (!push(v))
+      xino::cpu::wfe();
+  }
+
+  /** @brief Dequeue into @p v, waiting (`WFE`) while the ring is empty. */
+  void pop_wait(T &v) noexcept {
+    xino::cpu::sevl();
+    while (!pop(v))
+      xino::cpu::wfe();
+  }
+
+  /** @brief Number of queued elements (a snapshot). */
+  [[nodiscard]] std::size_t size() const noexcept {
+    return __atomic_load_n(&tail, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+private:
+  // Consumer side.
+  alignas(UKERNEL_CACHE_LINE) std::size_t head{0};
+  std::size_t cached_tail{0};
+
+  // Producer side.
+  alignas(UKERNEL_CACHE_LINE) std::size_t tail{0};
+  std::size_t cached_head{0};
+
+  alignas(UKERNEL_CACHE_LINE) T slots[N]{};
+};
+
+/**
+ * @class mpsc_ring
+ * @brief Multi-producer, single-consumer ring of @p N elements.
+ *
+ * Every slot carries a sequence number: slot `i` is free for position `p`
+ * when its sequence is `p`, and holds the element of position `p` when it is
+ * `p + 1`. Producers claim positions by advancing `tail` with `CAS`, fill
+ * the slots and publish them by storing the sequence. The consumer frees a
+ * slot by setting its sequence to `p + N`.
+ *
+ * A producer that is interrupted between claiming and publishing delays the
+ * consumer (but not the other producers) at its slot.
+ *
+ * @tparam T Element type (trivially copyable).
+ * @tparam N Capacity (a power of two).
+ */
+template <typename T, std::size_t N> class mpsc_ring {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  constexpr mpsc_ring() noexcept {
+    for (std::size_t i{0}; i < N; i++)
+      slots[i].seq = i;
+  }
+
+  mpsc_ring(const mpsc_ring &) = delete;
+  mpsc_ring &operator=(const mpsc_ring &) = delete;
+
+  /**
+   * @brief Enqueue up to @p n elements (any CPU).
+   *
+   * The elements are contiguous in the ring, and so in FIFO order relative
+   * to other producers.
+   *
+   * @return Number of elements enqueued (less than @p n if the ring fills).
+   */
+  std::size_t push_n(const T *v, std::size_t n) noexcept {
+    if (n == 0)
+      return 0;
+
+    if (n > N)
+      n = N;
+
+    std::size_t pos{__atomic_load_n(&tail, __ATOMIC_RELAXED)};
+
+    for (;;) {
+      // The consumer frees slots in order, so the last slot being free means
+      // all of them are.
+      std::size_t k{n};
+      while (k != 0 && diff(seq_of(pos + k - 1), pos + k - 1) < 0)
+        k--;
+
+      if (k == 0) {
+        // Full, or another producer moved `tail`.
+        const std::size_t cur{__atomic_load_n(&tail, __ATOMIC_RELAXED)};
+        if (cur == pos)
+          return 0;
+
+        pos = cur;
+        continue;
+      }
+
+      if (diff(seq_of(pos + k - 1), pos + k - 1) > 0) {
+        // Stale `pos`: these slots were already claimed.
+        pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        continue;
+      }
+
+      if (__atomic_compare_exchange_n(&tail, &pos, pos + k, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        n = k;
+        break;
+      }
+    }
+
+    for (std::size_t i{0}; i < n; i++) {
+      slot &s{slots[(pos + i) & (N - 1)]};
+      s.value = v[i];
+      __atomic_store_n(&s.seq, pos + i + 1, __ATOMIC_RELEASE);
+    }
+
+    xino::cpu::sev();
+
+    return n;
+  }
+
+  /**
+   * @brief Dequeue up to @p n published elements (consumer only).
+   *
+   * @return Number of elements dequeued.
+   */
+  std::size_t pop_n(T *v, std::size_t n) noexcept {
+    const std::size_t h{head};
+    std::size_t i{0};
+
+    for (; i < n; i++) {
+      slot &s{slots[(h + i) & (N - 1)]};
+      if (__atomic_load_n(&s.seq, __ATOMIC_ACQUIRE) != h + i + 1)
+        break;
+
+      v[i] = s.value;
+      // Release: the value is read before a producer may reuse the slot.
+      __atomic_store_n(&s.seq, h + i + N, __ATOMIC_RELEASE);
+    }
+
+    if (i == 0)
+      return 0;
+
+    // Atomic: empty_hint() reads `head` from outside the consumer.
+    __atomic_store_n(&head, h + i, __ATOMIC_RELAXED);
+    xino::cpu::sev();
+
+    return i;
+  }
+
+  [[nodiscard]] bool push(const T &v) noexcept { return push_n(&v, 1) == 1; }
+  [[nodiscard]] bool pop(T &v) noexcept { return pop_n(&v, 1) == 1; }
+
+  /** @brief Enqueue @p v, waiting (`WFE`) while the ring is full. */
+  void push_wait(const T &v) noexcept {
+    xino::cpu::sevl();
+    while (!push(v))
+      xino::cpu::wfe();
+  }
+
+  /** @brief Dequeue into @p v, waiting (`WFE`) while the ring is empty. */
+  void pop_wait(T &v) noexcept {
+    xino::cpu::sevl();
+    while (!pop(v))
+      xino::cpu::wfe();
+  }
+
+  /** @brief Whether the next element is not yet published (consumer only). */
+  [[nodiscard]] bool empty() const noexcept {
+    return __atomic_load_n(&slots[head & (N - 1)].seq, __ATOMIC_ACQUIRE) !=
+           head + 1;
+  }
+
+  /**
+   * @brief Racy version of empty() (any context).
+   *
+   * The answer may be stale by the time it is returned; use it only where
+   * a wrong answer is handled, e.g. to skip taking the consumer's lock.
+   */
+  [[nodiscard]] bool empty_hint() const noexcept {
+    const std::size_t h{__atomic_load_n(&head, __ATOMIC_RELAXED)};
+    return __atomic_load_n(&slots[h & (N - 1)].seq, __ATOMIC_ACQUIRE) !=
+           h + 1;
+  }
+
+private:
+  struct slot {
+    std::size_t seq;
+    T value;
+  };
+
+  [[nodiscard]] std::size_t seq_of(std::size_t pos) const noexcept {
+    return __atomic_load_n(&slots[pos & (N - 1)].seq, __ATOMIC_ACQUIRE);
+  }
+
+  [[nodiscard]] static std::ptrdiff_t diff(std::size_t a,
+                                           std::size_t b) noexcept {
+    return static_cast<std::ptrdiff_t>(a - b);
+  }
+
+  // Consumer side.
+  alignas(UKERNEL_CACHE_LINE) std::size_t head{0};
+
+  // Producer side.
+  alignas(UKERNEL_CACHE_LINE) std::size_t tail{0};
+
+  alignas(UKERNEL_CACHE_LINE) slot slots[N]{};
+};
+
+/**
+ * @class overwrite_ring
+ * @brief Single-producer ring of @p N records that overwrites its oldest.
+ *
+ * The producer is the owner CPU, and IRQ handlers nest, so reserve() claims
+ * a position with an atomic increment. `T` has a `std::uint64_t seq`, which
+ * is `pos + 1` once the record at position `pos` is committed, and `0` while
+ * it is being written. Readers keep their own positions; read() fails for a
+ * record that is not committed, or that was overwritten while copying it.
+ *
+ * The producer position is at offset 0, for debuggers.
+ *
+ * @tparam T Record type (trivially copyable, with a `seq` member).
+ * @tparam N Capacity (a power of two).
+ */
+template <typename T, std::size_t N> class overwrite_ring {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::is_same_v<decltype(T::seq), std::uint64_t>);
+  static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  /**
+   * @brief Claim the next position and return its record (owner CPU).
+   *
+   * The record reads as uncommitted until commit().
+   */
+  [[nodiscard]] T &reserve(std::uint64_t &pos) noexcept {
+    // A single atomic increment, so a nested IRQ handler takes the next slot.
+    pos = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    T &rec{slots[pos & (N - 1)]};
+
+    __atomic_store_n(&rec.seq, 0, __ATOMIC_RELAXED);
+    // Release: readers see `seq` cleared before the new contents.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return rec;
+  }
+
+  /** @brief Publish @p rec, reserved at @p pos (owner CPU). */
+  void commit(T &rec, std::uint64_t pos) noexcept {
+    __atomic_store_n(&rec.seq, pos + 1, __ATOMIC_RELEASE);
+  }
+
+  /** @brief Position of the next record to be reserved. */
+  [[nodiscard]] std::uint64_t load_head() const noexcept {
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  }
+
+  /** @brief Oldest position still in the ring when the head is @p head. */
+  [[nodiscard]] static std::uint64_t first(std::uint64_t head) noexcept {
+    return head > N ? head - N : 0;
+  }
+
+  /** @brief Whether the record at @p pos is committed (a snapshot). */
+  [[nodiscard]] bool committed(std::uint64_t pos) const noexcept {
+    return __atomic_load_n(&slots[pos & (N - 1)].seq, __ATOMIC_ACQUIRE) ==
+           pos + 1;
+  }
+
+  /**
+   * @brief Copy the record at @p pos into @p out.
+   *
+   * @return Whether it is committed and was not overwritten while copying.
+   */
+  [[nodiscard]] bool read(std::uint64_t pos, T &out) const noexcept {
+    const T &rec{slots[pos & (N - 1)]};
+
+    if (__atomic_load_n(&rec.seq, __ATOMIC_ACQUIRE) != pos + 1)
+      return false;
+
+    std::memcpy(&out, &rec, sizeof(out));
+
+    // Acquire: the copy is done before `seq` is read again.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&rec.seq, __ATOMIC_RELAXED) == pos + 1;
+  }
+
+  /** @brief Offset of the records, for debuggers. */
+  [[nodiscard]] static constexpr std::size_t slots_offset() noexcept {
+    return offsetof(overwrite_ring, slots);
+  }
+
+private:
+  std::uint64_t head{0};
+
+  alignas(UKERNEL_CACHE_LINE) T slots[N]{};
+};
+
+} // namespace xino::sync
+
+#endif // __RING_HPP__
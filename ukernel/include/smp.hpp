@@ -0,0 +1,128 @@
+/**
+ * @file smp.hpp
+ * @brief CPU topology and cross-CPU function calls.
+ *
+ * Logical CPU indices are the per-CPU area indices (see percpu.hpp): the boot
+ * CPU is 0, and the other `/cpus` nodes of the DTB follow in document order.
+ * cpu_mpidr() maps an index to the CPU's `MPIDR_EL1` affinity.
+ *
+ * ## Cross-CPU function calls
+ *
+ * smp_call_function_many() runs `fn(arg)` on other CPUs, from their IRQ
+ * handler. Each CPU has a lock-free call queue (a singly-linked list pushed
+ * with `CAS`), and each sender owns one call descriptor per target CPU, so
+ * no allocation is needed. The sender queues its descriptor on every target
+ * and sends one SGI only to the targets whose queue was empty: a target with
+ * a non-empty queue has an SGI in flight, and its handler will find the new
+ * call too. Requests from several CPUs (or several requests from one CPU)
+ * to the same CPU thus coalesce into a single interrupt, and the SGIs of one
+ * request are batched per cluster (see `xino::plat::gic::send_sgi()`).
+ *
+ * The target handler takes the whole queue with one `SWP`, and runs the
+ * calls in the order they were queued.
+ *
+ * @par Example
+ * @code
+ * static void flush(void *) { xino::cpu::tlbi_alle2is(); }
+ *
+ * xino::smp::cpumask all{};
+ * all.set_all(xino::percpu::nr_cpu_ids());
+ * xino::smp::smp_call_function_many(all, flush, nullptr, true);
+ * @endcode
+ *
+ * @note Call with IRQs unmasked and not from an IRQ handler: a CPU waiting
+ *       for its descriptor (or for completion) must still serve the calls
+ *       other CPUs send to it.
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __SMP_HPP__
+#define __SMP_HPP__
+
+#include <cpumask.hpp>
+#include <cstdint>
+#include <errno.hpp>
+
+namespace xino::smp {
+
+using smp_call_func_t = void (*)(void *arg);
+
+/**
+ * @brief Initialize the CPU map and the call queues (boot CPU, once).
+ *
+ * Call after `percpu_init()` and `xino::plat::gic::init()`.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::nomem` The call descriptors can not be allocated.
+ */
+[[nodiscard]] xino::error_t smp_init() noexcept;
+
+/**
+ * @brief Mark this CPU online; it starts serving function calls.
+ *
+ * Call on every CPU, after `xino::plat::gic::cpu_init()`.
+ */
+void smp_cpu_online() noexcept;
+
+/**
+ * @brief Start the secondary CPUs with PSCI `CPU_ON` (boot CPU, once).
+ *
+ * All secondaries are started at once, and the boot CPU then waits (up to
+ * one second) for each of them to come online. A secondary adopts the boot
+ * CPU's EL2 translation regime (`HCR_EL2`, `MAIR_EL2`, `TCR_EL2`,
+ * `TTBR0_EL2` and `SCTLR_EL2`), runs on its own `UKERNEL_STACK_SIZE` stack,
+ * sets up its per-CPU area, exception vectors, cache and translation
+ * features (`cache_init()` and `init_paging()`), GIC and RCU state, and
+ * enters cpu_idle().
+ *
+ * Call after smp_cpu_online(), with IRQs unmasked. Without `UKERNEL_SMP`, or
+ * without PSCI, the uKernel stays on the boot CPU.
+ */
+void smp_boot_secondaries() noexcept;
+
+/**
+ * @brief Idle loop: serve interrupts (e.g. function calls) forever.
+ *
+ * The CPU waits in `WFI` in an RCU extended quiescent state, and reports a
+ * quiescent state after each wake-up. Before each wait, it flushes the
+ * kernel log (`xino::klog::flush()`) and moves queued console text into the
+ * UART FIFO (`xino::plat::uart::tx_kick()`).
+ */
+[[noreturn]] void cpu_idle() noexcept;
+
+/** @brief `MPIDR_EL1` affinity fields of CPU @p cpu. */
+[[nodiscard]] std::uint64_t cpu_mpidr(unsigned cpu) noexcept;
+
+/** @brief Logical index of the CPU with affinity @p mpidr, or `~0U`. */
+[[nodiscard]] unsigned cpu_index(std::uint64_t mpidr) noexcept;
+
+/** @brief Online CPUs (a snapshot). */
+[[nodiscard]] cpumask cpu_online_mask() noexcept;
+
+/** @brief Number of SGIs taken by CPU @p cpu for function calls. */
+[[nodiscard]] std::uint64_t nr_call_ipis(unsigned cpu) noexcept;
+
+/**
+ * @brief Run `fn(arg)` on every online CPU in @p mask, except the caller.
+ *
+ * @param wait Return only after `fn` has returned on every target. Without
+ *        @p wait, `fn` and `arg` are copied and the call returns once they
+ *        are queued (a previous call to the same target may be waited for).
+ */
+void smp_call_function_many(const cpumask &mask, smp_call_func_t fn,
+                            void *arg, bool wait) noexcept;
+
+/**
+ * @brief Run `fn(arg)` on CPU @p cpu.
+ *
+ * If @p cpu is the caller, `fn` runs immediately with IRQs masked. Does
+ * nothing if @p cpu is offline.
+ */
+void smp_call_function_single(unsigned cpu, smp_call_func_t fn, void *arg,
+                              bool wait) noexcept;
+
+} // namespace xino::smp
+
+#endif // __SMP_HPP__
@@ -6,6 +6,9 @@
  *   - Helpers to mask/unmask IRQ/FIQ using the DAIF register.
  *   - A simple spin lock (`xino::sync::spin_lock`) that uses CAS for
  *     acquisition and event primitives to reduce contention while waiting.
+ *   - A writer-preferring reader-writer spin lock (`xino::sync::rw_spin_lock`).
+ *   - Sequence counters (`xino::sync::seqcount`, `xino::sync::seqlock`) for
+ *     lockless, retrying readers of read-mostly data.
  *
  * @author Amirreza Zarrabi
  * @date 2025
@@ -14,10 +17,16 @@
 #ifndef __SYNC_HPP__
 #define __SYNC_HPP__
 
+#include <barrier.hpp>
+#include <config.h> // for UKERNEL_LOCKSTAT
 #include <cpu.hpp>
 #include <cstdint>
 #include <regs.hpp>
 
+#ifdef UKERNEL_LOCKSTAT
+#include <lockstat.hpp>
+#endif
+
 namespace xino::sync {
 
 using irq_flags_t = xino::cpu::daif::reg_type;
@@ -46,6 +55,9 @@ using irq_flags_t = xino::cpu::daif::reg_type;
  * - `state == 0` means unlocked, `state == 1` means locked.
  * - Acquire is done via CAS (0 -> 1) with `__ATOMIC_ACQUIRE`.
  * - Unlock is a store (0) with `__ATOMIC_RELEASE`, followed by `SEV`.
+ *
+ * With `UKERNEL_LOCKSTAT`, the lock also keeps contention statistics (see
+ * lockstat.hpp).
  */
 class spin_lock {
 public:
@@ -56,7 +68,15 @@ public:
    * duration can be **constant-initialized** (and thus usable with `constinit`)
    * without any runtime startup code.
    */
-  constexpr spin_lock() noexcept : state{0} {}
+  constexpr spin_lock() noexcept : spin_lock{nullptr} {}
+
+  /** @brief Construct an unlocked spin lock named @p name (for lockstat). */
+#ifdef UKERNEL_LOCKSTAT
+  constexpr explicit spin_lock(const char *name) noexcept
+      : stats{name}, state{0} {}
+#else
+  constexpr explicit spin_lock(const char *) noexcept : state{0} {}
+#endif
 
   // No copy (Also suppresses implicit move construction).
   spin_lock(const spin_lock &) = delete;
@@ -92,18 +112,20 @@ public:
    *  masked.
    */
   void lock() noexcept {
-    if (try_lock())
-      return;
+#ifdef UKERNEL_LOCKSTAT
+    const std::uint64_t t0{xino::cpu::cntvct_el0::read()};
+    const bool contended{!try_acquire()};
 
-    for (;;) {
-      xino::cpu::sevl();
+    if (contended)
+      spin();
 
-      while (__atomic_load_n(&state, __ATOMIC_RELAXED) != 0)
-        xino::cpu::wfe();
+    stats.acquired(t0, contended);
+#else
+    if (try_acquire())
+      return;
 
-      if (try_lock())
-        return;
-    }
+    spin();
+#endif
   }
 
   /**
@@ -112,13 +134,23 @@ public:
    * @return true on success, false if already held.
    */
   [[nodiscard]] bool try_lock() noexcept {
-    std::uint32_t expected = 0;
-    return __atomic_compare_exchange_n(&state, &expected, 1, false,
-                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+#ifdef UKERNEL_LOCKSTAT
+    const std::uint64_t t0{xino::cpu::cntvct_el0::read()};
+    if (!try_acquire())
+      return false;
+
+    stats.acquired(t0, false);
+    return true;
+#else
+    return try_acquire();
+#endif
   }
 
   /** @brief Release the lock. */
   void unlock() noexcept {
+#ifdef UKERNEL_LOCKSTAT
+    stats.released();
+#endif
     __atomic_store_n(&state, 0, __ATOMIC_RELEASE);
     xino::cpu::sev();
   }
@@ -147,10 +179,336 @@ public:
     irq_restore(f);
   }
 
+  /**
+   * @brief Forget the lock before its storage is freed.
+   *
+   * Only needed for locks embedded in allocated objects; the lock must be
+   * unlocked and no longer used. With `UKERNEL_LOCKSTAT`, this removes the
+   * lock from lockstat_dump().
+   */
+  void destroy() noexcept {
+#ifdef UKERNEL_LOCKSTAT
+    lockstat_unregister(&stats);
+#endif
+  }
+
 private:
+  [[nodiscard, gnu::always_inline]] bool try_acquire() noexcept {
+    std::uint32_t expected = 0;
+    return __atomic_compare_exchange_n(&state, &expected, 1, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+  }
+
+  // Wait until try_acquire() succeeds (see lock() for SEVL). Always inlined,
+  // so without UKERNEL_LOCKSTAT, lock() is still one inline wait loop.
+  [[gnu::always_inline]] void spin() noexcept {
+    for (;;) {
+      xino::cpu::sevl();
+
+      while (__atomic_load_n(&state, __ATOMIC_RELAXED) != 0)
+        xino::cpu::wfe();
+
+      if (try_acquire())
+        return;
+    }
+  }
+
+#ifdef UKERNEL_LOCKSTAT
+  lock_stats stats; // First, so that its address is the lock's.
+#endif
   alignas(4) std::uint32_t state;
 };
 
+/**
+ * @class rw_spin_lock
+ * @brief Writer-preferring reader-writer spin lock.
+ *
+ * Lock word layout:
+ *  - bits [15:0]: number of readers holding the lock.
+ *  - bits [30:16]: number of writers waiting for the lock.
+ *  - bit 31: a writer holds the lock.
+ *
+ * Readers enter with a single `LDADDA` when no writer holds or waits for the
+ * lock; otherwise they back out and wait. A waiting writer blocks new readers,
+ * so a steady stream of readers cannot starve writers.
+ *
+ * Waiting uses `SEVL`/`WFE`, as in `spin_lock`. Releases that may unblock a
+ * waiter send `SEV`.
+ *
+ * @note Readers may nest (e.g. an IRQ taking the read lock held by the
+ *       interrupted context) only if no writer can be waiting; use the
+ *       irqsave variants otherwise.
+ */
+class rw_spin_lock {
+public:
+  static constexpr std::uint32_t readers_mask{0xffffU};
+  static constexpr std::uint32_t waiter_one{1U << 16};
+  static constexpr std::uint32_t waiters_mask{0x7fffU << 16};
+  static constexpr std::uint32_t writer{1U << 31};
+
+  constexpr rw_spin_lock() noexcept : state{0} {}
+
+  rw_spin_lock(const rw_spin_lock &) = delete;
+  rw_spin_lock &operator=(const rw_spin_lock &) = delete;
+
+  /** @brief Acquire the lock shared (spins while a writer holds or waits). */
+  void read_lock() noexcept {
+    for (;;) {
+      const std::uint32_t v{__atomic_fetch_add(&state, 1, __ATOMIC_ACQUIRE)};
+
+      if ((v & (writer | waiters_mask)) == 0)
+        return;
+
+      // Back out; a waiting writer may be waiting for the readers to drain.
+      read_back_out();
+
+      xino::cpu::sevl();
+      while ((__atomic_load_n(&state, __ATOMIC_RELAXED) &
+              (writer | waiters_mask)) != 0)
+        xino::cpu::wfe();
+    }
+  }
+
+  /**
+   * @brief Try to acquire the lock shared once.
+   *
+   * @return true on success, false if a writer holds or waits for the lock.
+   */
+  [[nodiscard]] bool read_try_lock() noexcept {
+    std::uint32_t v{__atomic_load_n(&state, __ATOMIC_RELAXED)};
+
+    while ((v & (writer | waiters_mask)) == 0)
+      if (__atomic_compare_exchange_n(&state, &v, v + 1, true,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return true;
+
+    return false;
+  }
+
+  /** @brief Release a shared hold. */
+  void read_unlock() noexcept {
+    const std::uint32_t v{__atomic_fetch_sub(&state, 1, __ATOMIC_RELEASE)};
+
+    // Last reader out with a writer waiting.
+    if ((v & readers_mask) == 1 && (v & waiters_mask) != 0)
+      xino::cpu::sev();
+  }
+
+  /** @brief Acquire the lock exclusive (spins until all holders release). */
+  void write_lock() noexcept {
+    if (write_try_lock())
+      return;
+
+    // Announce the writer; new readers back out from now on.
+    std::uint32_t v{__atomic_add_fetch(&state, waiter_one, __ATOMIC_RELAXED)};
+
+    for (;;) {
+      if ((v & (writer | readers_mask)) == 0) {
+        if (__atomic_compare_exchange_n(&state, &v, (v - waiter_one) | writer,
+                                        false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED))
+          return;
+
+        continue;
+      }
+
+      xino::cpu::sevl();
+      while (((v = __atomic_load_n(&state, __ATOMIC_RELAXED)) &
+              (writer | readers_mask)) != 0)
+        xino::cpu::wfe();
+    }
+  }
+
+  /**
+   * @brief Try to acquire the lock exclusive once.
+   *
+   * @return true on success, false if held.
+   */
+  [[nodiscard]] bool write_try_lock() noexcept {
+    std::uint32_t v{__atomic_load_n(&state, __ATOMIC_RELAXED)};
+
+    while ((v & (writer | readers_mask)) == 0)
+      if (__atomic_compare_exchange_n(&state, &v, v | writer, true,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return true;
+
+    return false;
+  }
+
+  /** @brief Release an exclusive hold (`LDCLRL`). */
+  void write_unlock() noexcept {
+    (void)__atomic_fetch_and(&state, ~writer, __ATOMIC_RELEASE);
+    xino::cpu::sev();
+  }
+
+  /** @brief read_lock() with IRQs and FIQs masked. */
+  [[nodiscard]] irq_flags_t read_lock_irqsave() noexcept {
+    irq_flags_t f = irq_save();
+    read_lock();
+    return f;
+  }
+
+  /** @brief read_unlock() and restore IRQ flags from read_lock_irqsave(). */
+  void read_unlock_irqrestore(irq_flags_t f) noexcept {
+    read_unlock();
+    irq_restore(f);
+  }
+
+  /** @brief write_lock() with IRQs and FIQs masked. */
+  [[nodiscard]] irq_flags_t write_lock_irqsave() noexcept {
+    irq_flags_t f = irq_save();
+    write_lock();
+    return f;
+  }
+
+  /** @brief write_unlock() and restore IRQ flags from write_lock_irqsave(). */
+  void write_unlock_irqrestore(irq_flags_t f) noexcept {
+    write_unlock();
+    irq_restore(f);
+  }
+
+private:
+  // Drop a reader reference that did not enter the critical section.
+  void read_back_out() noexcept {
+    const std::uint32_t v{__atomic_fetch_sub(&state, 1, __ATOMIC_RELAXED)};
+
+    if ((v & readers_mask) == 1)
+      xino::cpu::sev();
+  }
+
+  alignas(4) std::uint32_t state;
+};
+
+/**
+ * @class seqcount
+ * @brief Sequence counter for lockless, retrying readers.
+ *
+ * The counter is odd while a write is in progress. A reader samples it with
+ * read_begin(), copies the data, and retries if read_retry() reports that a
+ * writer ran in between. Readers never write shared memory, so they do not
+ * bounce the cache line between cores.
+ *
+ * Writers must be serialized by the caller (see `seqlock`).
+ *
+ * @par Example
+ * @code
+ * std::uint32_t seq;
+ * do {
+ *   seq = sc.read_begin();
+ *   copy = shared; // May be torn; only used if the read did not race.
+ * } while (sc.read_retry(seq));
+ * @endcode
+ *
+ * @note Readers must only copy the protected data inside the loop, and must
+ *       not follow pointers read from it before read_retry() succeeds.
+ */
+class seqcount {
+public:
+  constexpr seqcount() noexcept : sequence{0} {}
+
+  seqcount(const seqcount &) = delete;
+  seqcount &operator=(const seqcount &) = delete;
+
+  /** @brief Start a read; waits (`WFE`) while a write is in progress. */
+  [[nodiscard]] std::uint32_t read_begin() const noexcept {
+    std::uint32_t s{__atomic_load_n(&sequence, __ATOMIC_ACQUIRE)};
+    if ((s & 1) == 0)
+      return s;
+
+    xino::cpu::sevl();
+    while (((s = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE)) & 1) != 0)
+      xino::cpu::wfe();
+
+    return s;
+  }
+
+  /** @brief Check whether the read started with @p start must be retried. */
+  [[nodiscard]] bool read_retry(std::uint32_t start) const noexcept {
+    xino::barrier::smp_rmb(); // Order the data loads before the re-check.
+    return __atomic_load_n(&sequence, __ATOMIC_RELAXED) != start;
+  }
+
+  /** @brief Start a write (the counter becomes odd). */
+  void write_begin() noexcept {
+    const std::uint32_t s{__atomic_load_n(&sequence, __ATOMIC_RELAXED)};
+    __atomic_store_n(&sequence, s + 1, __ATOMIC_RELAXED);
+    xino::barrier::smp_wmb(); // Order the counter before the data stores.
+  }
+
+  /** @brief End a write (the counter becomes even) and wake readers. */
+  void write_end() noexcept {
+    const std::uint32_t s{__atomic_load_n(&sequence, __ATOMIC_RELAXED)};
+    xino::barrier::smp_wmb(); // Order the data stores before the counter.
+    __atomic_store_n(&sequence, s + 1, __ATOMIC_RELAXED);
+    xino::cpu::sev();
+  }
+
+private:
+  alignas(4) std::uint32_t sequence;
+};
+
+/**
+ * @class seqlock
+ * @brief `seqcount` with a `spin_lock` serializing the writers.
+ *
+ * @par Example
+ * @code
+ * // Writer.
+ * auto flags = sl.write_lock_irqsave();
+ * shared = update;
+ * sl.write_unlock_irqrestore(flags);
+ *
+ * // Reader (lockless).
+ * std::uint32_t seq;
+ * do {
+ *   seq = sl.read_begin();
+ *   copy = shared;
+ * } while (sl.read_retry(seq));
+ * @endcode
+ */
+class seqlock {
+public:
+  constexpr seqlock() noexcept = default;
+
+  seqlock(const seqlock &) = delete;
+  seqlock &operator=(const seqlock &) = delete;
+
+  [[nodiscard]] std::uint32_t read_begin() const noexcept {
+    return count.read_begin();
+  }
+
+  [[nodiscard]] bool read_retry(std::uint32_t start) const noexcept {
+    return count.read_retry(start);
+  }
+
+  void write_lock() noexcept {
+    lock.lock();
+    count.write_begin();
+  }
+
+  void write_unlock() noexcept {
+    count.write_end();
+    lock.unlock();
+  }
+
+  /** @brief write_lock() with IRQs and FIQs masked. */
+  [[nodiscard]] irq_flags_t write_lock_irqsave() noexcept {
+    irq_flags_t f = irq_save();
+    write_lock();
+    return f;
+  }
+
+  /** @brief write_unlock() and restore IRQ flags from write_lock_irqsave(). */
+  void write_unlock_irqrestore(irq_flags_t f) noexcept {
+    write_unlock();
+    irq_restore(f);
+  }
+
+private:
+  spin_lock lock{};
+  seqcount count{};
+};
+
 } // namespace xino::sync
 
 #endif // __SYNC_HPP__
@@ -0,0 +1,158 @@
+/**
+ * @file trace.hpp
+ * @brief Binary trace buffer with deferred formatting (built with
+ *        `UKERNEL_TRACE`).
+ *
+ * A trace point records only a 32-bit ID, a `CNTVCT_EL0` timestamp and up to
+ * @ref max_args raw argument words into this CPU's ring; nothing is
+ * formatted on the target. The name and `printf`-style format of each trace
+ * point are compiled into the `.trace_fmt` section, and the ID is the offset
+ * of that string in the section, so it is fixed at link time.
+ *
+ * Every CPU owns a ring of `UKERNEL_TRACE_ENTRIES` entries of 64 bytes,
+ * written only by that CPU (a `xino::sync::overwrite_ring`). The ring
+ * overwrites its oldest entries: it keeps the most recent history, like a
+ * flight recorder. trace_init() allocates the rings of the CPUs that boot;
+ * trace points before it are not recorded.
+ *
+ * dump() prints the rings to stdout as `xino-trace:` lines. The host tool
+ * `tools/xino_trace.py` reads them from a console log, looks the IDs up in
+ * the `.trace_fmt` section of `ukernel.elf`, and writes either text or a
+ * Chrome trace JSON file (which Perfetto opens):
+ *
+ * @code
+ * tools/xino_trace.py build/ukernel/ukernel.elf console.log -o trace.json
+ * @endcode
+ *
+ * Without `UKERNEL_TRACE`, trace points compile to nothing and their
+ * arguments are not evaluated.
+ *
+ * @par Example
+ * @code
+ * XINO_TRACE("alloc_pages", "order %u pa %#lx", order, pa);
+ *
+ * XINO_TRACE_BEGIN("irq", "intid %u", intid);
+ * handler(intid);
+ * XINO_TRACE_END("irq");
+ * @endcode
+ *
+ * @author Amirreza Zarrabi
+ * @date 2026
+ */
+
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <config.h> // for UKERNEL_TRACE and UKERNEL_TRACE_ENTRIES
+
+#ifdef UKERNEL_TRACE
+
+#include <cstddef>
+#include <cstdint>
+#include <errno.hpp>
+#include <type_traits>
+
+extern "C" {
+extern const char __trace_fmt_start[];
+}
+
+namespace xino::trace {
+
+static constexpr std::size_t max_args{5};
+
+/**
+ * @struct entry
+ * @brief One trace event (64 bytes).
+ *
+ * `seq` is `pos + 1` once the entry at ring position `pos` is committed,
+ * and `0` while it is being written.
+ */
+struct entry {
+  std::uint64_t seq;
+  std::uint64_t ts; // CNTVCT_EL0.
+  std::uint32_t id; // Offset in `.trace_fmt`.
+  std::uint32_t nr_args;
+  std::uint64_t args[max_args];
+};
+
+static_assert(sizeof(entry) == 64);
+
+static constexpr std::size_t nr_entries{UKERNEL_TRACE_ENTRIES};
+static_assert(nr_entries != 0 && (nr_entries & (nr_entries - 1)) == 0,
+              "UKERNEL_TRACE_ENTRIES must be a power of two");
+
+/**
+ * @brief Allocate a ring per CPU (boot CPU, once).
+ *
+ * Call after `xino::percpu::percpu_init()`, before secondaries boot.
+ *
+ * @retval `xino::error_nr::ok` Success.
+ * @retval `xino::error_nr::nomem` Failed to allocate the rings.
+ */
+[[nodiscard]] xino::error_t trace_init() noexcept;
+
+/** @brief Append an entry to this CPU's ring (any context). */
+void write(std::uint32_t id, const std::uint64_t *args,
+           std::uint32_t nr_args) noexcept;
+
+/** @brief Print every CPU's ring to stdout, for `tools/xino_trace.py`. */
+void dump() noexcept;
+
+/** @brief Raw word of a trace point argument. */
+template <typename T>
+[[nodiscard, gnu::always_inline]] inline std::uint64_t
+to_word(const T &v) noexcept {
+  if constexpr (std::is_pointer_v<T>)
+    return reinterpret_cast<std::uintptr_t>(v);
+  else if constexpr (std::is_enum_v<T>)
+    return static_cast<std::uint64_t>(
+        static_cast<std::underlying_type_t<T>>(v));
+  else if constexpr (std::is_integral_v<T>)
+    return static_cast<std::uint64_t>(v); // Signed values sign-extend.
+  else
+    return static_cast<std::uintptr_t>(v); // E.g. `phys_addr`.
+}
+
+template <typename... Args>
+[[gnu::always_inline]] inline void emit(const char *fmt,
+                                        const Args &...args) noexcept {
+  static_assert(sizeof...(Args) <= max_args, "too many trace arguments");
+
+  const std::uint64_t words[sizeof...(Args) + 1]{to_word(args)..., 0};
+  write(static_cast<std::uint32_t>(fmt - __trace_fmt_start), words,
+        sizeof...(Args));
+}
+
+} // namespace xino::trace
+
+/**
+ * The string is `<phase><name>\0<format>`; the phase follows the Chrome trace
+ * event format: `i` (instant), `B` (begin) or `E` (end).
+ */
+#define XINO_TRACE_POINT(phase, name, fmt, ...)                                \
+  do {                                                                         \
+    [[gnu::section(".trace_fmt"), gnu::used]] static constexpr char            \
+        xino_trace_fmt_[]{phase name "\0" fmt};                                \
+    ::xino::trace::emit(xino_trace_fmt_ __VA_OPT__(, ) __VA_ARGS__);           \
+  } while (0)
+
+#else // !UKERNEL_TRACE
+
+#define XINO_TRACE_POINT(phase, name, fmt, ...)                                \
+  do {                                                                         \
+  } while (0)
+
+#endif // UKERNEL_TRACE
+
+/** @brief Instant event. */
+#define XINO_TRACE(name, fmt, ...)                                             \
+  XINO_TRACE_POINT("i", name, fmt __VA_OPT__(, ) __VA_ARGS__)
+
+/** @brief Start of a duration event on this CPU. */
+#define XINO_TRACE_BEGIN(name, fmt, ...)                                       \
+  XINO_TRACE_POINT("B", name, fmt __VA_OPT__(, ) __VA_ARGS__)
+
+/** @brief End of the innermost duration event @p name on this CPU. */
+#define XINO_TRACE_END(name) XINO_TRACE_POINT("E", name, "")
+
+#endif // __TRACE_HPP__
@@ -10,6 +10,22 @@
           "width" : 64,
           "fields" : [ {"access" : "rw"} ]
         },
+        {
+          "encoding" : "CNTVCT_EL0",
+          "width" : 64,
+          "fields" : [ {
+            "access" : "ro",
+            "description" : "Virtual count (generic timer)."
+          } ]
+        },
+        {
+          "encoding" : "CNTFRQ_EL0",
+          "width" : 64,
+          "fields" : [ {
+            "access" : "ro",
+            "description" : "Generic timer frequency, in Hz."
+          } ]
+        },
         {
           "encoding" : "CurrentEL",
           "width" : 64,
@@ -125,6 +141,14 @@
             "access" : "ro",
             "description" : "Support for small translation tables",
             "enum_values" : {"not_supported" : 0, "supported" : 1}
+          },
+          {
+            "name" : "ccidx",
+            "lsb" : 20,
+            "width" : 4,
+            "access" : "ro",
+            "description" : "Support for 64-bit format of CCSIDR_EL1",
+            "enum_values" : {"not_supported" : 0, "supported" : 1}
           } ]
         },
         {
@@ -608,6 +632,340 @@
               "description" : "VMID (8 or 16 bits depending on implementation)."
             }
           ]
+        },
+        {
+          "encoding" : "MPIDR_EL1",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "aff0",
+              "lsb" : 0,
+              "width" : 8,
+              "access" : "ro",
+              "description" : "Affinity level 0."
+            },
+            {
+              "name" : "aff1",
+              "lsb" : 8,
+              "width" : 8,
+              "access" : "ro",
+              "description" : "Affinity level 1."
+            },
+            {
+              "name" : "aff2",
+              "lsb" : 16,
+              "width" : 8,
+              "access" : "ro",
+              "description" : "Affinity level 2."
+            },
+            {
+              "name" : "aff3",
+              "lsb" : 32,
+              "width" : 8,
+              "access" : "ro",
+              "description" : "Affinity level 3."
+            }
+          ]
+        },
+        {
+          "encoding" : "VBAR_EL2",
+          "width" : 64,
+          "policy" : {"post_write" : "isb"},
+          "fields" : [ {
+            "access" : "rw",
+            "description" : "Vector base address (2 KB aligned)."
+          } ]
+        },
+        {
+          "encoding" : "ESR_EL2",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "iss",
+              "lsb" : 0,
+              "width" : 25,
+              "access" : "ro",
+              "description" : "Instruction specific syndrome."
+            },
+            {
+              "name" : "il",
+              "bit" : 25,
+              "access" : "ro",
+              "description" : "Instruction length: 1 = 32-bit."
+            },
+            {
+              "name" : "ec",
+              "lsb" : 26,
+              "width" : 6,
+              "access" : "ro",
+              "description" : "Exception class."
+            }
+          ]
+        },
+        {
+          "encoding" : "ELR_EL2",
+          "width" : 64,
+          "fields" : [ {
+            "access" : "rw",
+            "description" : "Exception link register."
+          } ]
+        },
+        {
+          "encoding" : "FAR_EL2",
+          "width" : 64,
+          "fields" : [ {
+            "access" : "ro",
+            "description" : "Fault address."
+          } ]
+        },
+        {
+          "encoding" : "ICC_SRE_EL2",
+          "width" : 64,
+          "policy" : {"post_write" : "isb"},
+          "fields" : [
+            {
+              "name" : "sre",
+              "bit" : 0,
+              "access" : "rw",
+              "description" : "System register interface for EL2."
+            },
+            {
+              "name" : "dfb",
+              "bit" : 1,
+              "access" : "rw",
+              "description" : "Disable FIQ bypass."
+            },
+            {
+              "name" : "dib",
+              "bit" : 2,
+              "access" : "rw",
+              "description" : "Disable IRQ bypass."
+            },
+            {
+              "name" : "enable",
+              "bit" : 3,
+              "access" : "rw",
+              "description" : "Allow EL1 to use ICC_SRE_EL1."
+            }
+          ]
+        },
+        {
+          "encoding" : "ICC_PMR_EL1",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "priority",
+              "lsb" : 0,
+              "width" : 8,
+              "access" : "rw",
+              "description" : "Priority mask: higher values unmask more."
+            }
+          ]
+        },
+        {
+          "encoding" : "ICC_IGRPEN1_EL1",
+          "width" : 64,
+          "policy" : {"post_write" : "isb"},
+          "fields" : [
+            {
+              "name" : "enable",
+              "bit" : 0,
+              "access" : "rw",
+              "description" : "Enable Group 1 interrupts."
+            }
+          ]
+        },
+        {
+          "encoding" : "ICC_IAR1_EL1",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "intid",
+              "lsb" : 0,
+              "width" : 24,
+              "access" : "ro",
+              "description" : "INTID of the acknowledged interrupt."
+            }
+          ]
+        },
+        {
+          "encoding" : "ICC_EOIR1_EL1",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "intid",
+              "lsb" : 0,
+              "width" : 24,
+              "access" : "rw",
+              "description" : "INTID to end (write-only register)."
+            }
+          ]
+        },
+        {
+          "encoding" : "ICC_SGI1R_EL1",
+          "width" : 64,
+          "policy" : {"post_write" : "isb"},
+          "fields" : [
+            {
+              "name" : "target_list",
+              "lsb" : 0,
+              "width" : 16,
+              "access" : "rw",
+              "description" : "Aff0 targets, within the range."
+            },
+            {
+              "name" : "aff1",
+              "lsb" : 16,
+              "width" : 8,
+              "access" : "rw",
+              "description" : "Target affinity level 1."
+            },
+            {
+              "name" : "intid",
+              "lsb" : 24,
+              "width" : 4,
+              "access" : "rw",
+              "description" : "SGI number."
+            },
+            {
+              "name" : "aff2",
+              "lsb" : 32,
+              "width" : 8,
+              "access" : "rw",
+              "description" : "Target affinity level 2."
+            },
+            {
+              "name" : "irm",
+              "bit" : 40,
+              "access" : "rw",
+              "description" : "1: all PEs except self (write-only)."
+            },
+            {
+              "name" : "rs",
+              "lsb" : 44,
+              "width" : 4,
+              "access" : "rw",
+              "description" : "Range selector: Aff0 / 16."
+            },
+            {
+              "name" : "aff3",
+              "lsb" : 48,
+              "width" : 8,
+              "access" : "rw",
+              "description" : "Target affinity level 3."
+            }
+          ]
+        },
+        {
+          "encoding" : "CTR_EL0",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "iminline",
+              "lsb" : 0,
+              "width" : 4,
+              "access" : "ro",
+              "description" : "Log2 words of the smallest I-cache line."
+            },
+            {
+              "name" : "dminline",
+              "lsb" : 16,
+              "width" : 4,
+              "access" : "ro",
+              "description" : "Log2 words of the smallest D-cache line."
+            },
+            {
+              "name" : "cwg",
+              "lsb" : 24,
+              "width" : 4,
+              "access" : "ro",
+              "description" : "Log2 words of the cache writeback granule."
+            },
+            {
+              "name" : "idc",
+              "bit" : 28,
+              "access" : "ro",
+              "description" : "No D-cache clean to PoU needed for coherence."
+            },
+            {
+              "name" : "dic",
+              "bit" : 29,
+              "access" : "ro",
+              "description" : "I-cache invalidation to PoU not needed."
+            }
+          ]
+        },
+        {
+          "encoding" : "CLIDR_EL1",
+          "width" : 64,
+          "fields" : [
+            {
+              "name" : "ctype1",
+              "lsb" : 0,
+              "width" : 3,
+              "access" : "ro",
+              "description" : "Cache type of level 1 (next levels follow).",
+              "enum_values" : {
+                "none" : 0,
+                "instruction" : 1,
+                "data" : 2,
+                "separate" : 3,
+                "unified" : 4
+              }
+            },
+            {
+              "name" : "louis",
+              "lsb" : 21,
+              "width" : 3,
+              "access" : "ro",
+              "description" : "Level of Unification Inner Shareable."
+            },
+            {
+              "name" : "loc",
+              "lsb" : 24,
+              "width" : 3,
+              "access" : "ro",
+              "description" : "Level of Coherence."
+            },
+            {
+              "name" : "louu",
+              "lsb" : 27,
+              "width" : 3,
+              "access" : "ro",
+              "description" : "Level of Unification Uniprocessor."
+            }
+          ]
+        },
+        {
+          "encoding" : "CSSELR_EL1",
+          "width" : 64,
+          "policy" : {"post_write" : "isb"},
+          "fields" : [
+            {
+              "name" : "ind",
+              "bit" : 0,
+              "access" : "rw",
+              "description" : "1: instruction cache."
+            },
+            {
+              "name" : "level",
+              "lsb" : 1,
+              "width" : 3,
+              "access" : "rw",
+              "description" : "Cache level (0 is level 1)."
+            }
+          ]
+        },
+        {
+          "encoding" : "CCSIDR_EL1",
+          "width" : 64,
+          "fields" : [ {
+            "name" : "line_size",
+            "lsb" : 0,
+            "width" : 3,
+            "access" : "ro",
+            "description" : "Log2 bytes of the line, minus 4."
+          } ]
         }
       ]
 }
\ No newline at end of file
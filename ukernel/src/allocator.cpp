@@ -1,7 +1,15 @@
 
 #include <allocator.hpp>
+#include <cache.hpp>
 #include <config.h>
 #include <cpu.hpp>
+#include <klog.hpp>
+#include <mm_memblock.hpp>
+#include <mm_memmap.hpp>
+#include <mm_va_layout.hpp>
+#include <new>
+#include <runtime.hpp> // use_mapping
+#include <trace.hpp>
 
 namespace xino::allocator {
 
@@ -49,4 +57,167 @@ extern "C" void ukernel_boot_alloc_init() noexcept {
     xino::cpu::panic();
 }
 
+/**
+ * @brief Global physical page allocator.
+ *
+ * Serves @ref boot_allocator until @ref page_allocator_t::handoff() switches
+ * it to zones sized to the RAM found at boot.
+ */
+__cacheline_aligned constinit page_allocator_t page_allocator{};
+
+// Usable VA of a zone allocator (via the direct map).
+static zone_allocator_t *zone_va(xino::mm::phys_addr pa) noexcept {
+  return xino::mm::va_layout::phys_to_virt(pa, xino::runtime::use_mapping)
+      .ptr<zone_allocator_t>();
+}
+
+zone_allocator_t *page_allocator_t::find_zone(xino::mm::phys_addr pa) noexcept {
+  const xino::mm::phys_addr base{pa.align_down(zone_size)};
+
+  for (std::size_t i{0}; i < nr_zones; i++) {
+    if (zones[i].base == base)
+      return zone_va(zones[i].pa);
+  }
+
+  return nullptr;
+}
+
+void page_allocator_t::add_free(xino::mm::phys_addr pa,
+                                std::size_t size) noexcept {
+  using namespace xino::mm::va_layout;
+
+  const xino::mm::phys_addr end{pa + size};
+
+  // Split at zone windows.
+  while (pa < end) {
+    const xino::mm::phys_addr window_end{pa.align_down(zone_size) + zone_size};
+    const xino::mm::phys_addr chunk_end{end < window_end ? end : window_end};
+    const std::size_t chunk{static_cast<std::size_t>(chunk_end - pa)};
+
+    if (zone_allocator_t *z{find_zone(pa)}; z != nullptr) {
+      z->add_range(pa, chunk);
+
+      // The pages are now managed by the allocator.
+      for (std::size_t pfn{pa_to_pfn(pa)}; pfn < pa_to_pfn(chunk_end); pfn++) {
+        if (pfn_valid(pfn))
+          pa_to_page(pfn_to_pa(pfn))->flags &= ~xino::mm::page::PG_RESERVED;
+      }
+    }
+
+    pa = chunk_end;
+  }
+}
+
+xino::error_t page_allocator_t::handoff() noexcept {
+  using namespace xino::mm;
+
+  const memblock::region_map &memory{memblock::memory};
+  const std::size_t gs{va_layout::granule_size()};
+
+  if (main_ready || memory.count() == 0)
+    return xino::error_nr::invalid;
+
+  // `PA{0}` is the failure value of alloc_pages(); never hand out page 0
+  // (DRAM starts at 0 on some boards, e.g. rock5b).
+  if (memory[0].base == phys_addr{}) {
+    if (auto ret{memblock::reserve(phys_addr{}, gs)};
+        ret != xino::error_nr::ok)
+      return ret;
+  }
+
+  // Memmap over all RAM banks.
+  const std::size_t start_pfn{va_layout::pa_to_pfn(memory[0].base)};
+  const std::size_t end_pfn{va_layout::pa_to_pfn(
+      memory[memory.count() - 1].end().align_up(gs))};
+
+  const phys_addr memmap{memblock::alloc(memmap_size(end_pfn - start_pfn), gs)};
+  if (memmap == phys_addr{})
+    return xino::error_nr::nomem;
+
+  if (auto ret{memmap_init(start_pfn, end_pfn, memmap)};
+      ret != xino::error_nr::ok)
+    return ret;
+
+  // One zone per `zone_size` aligned window with memory. Zone storage is
+  // reserved in memblock, so it is not handed out below.
+  for (std::size_t m{0}; m < memory.count(); m++) {
+    for (phys_addr w{memory[m].base.align_down(zone_size)};
+         w < memory[m].end(); w += zone_size) {
+      // Banks are sorted; a window shared by two banks is the last one.
+      if (nr_zones != 0 && zones[nr_zones - 1].base == w)
+        continue;
+
+      if (nr_zones == max_zones)
+        return xino::error_nr::nomem;
+
+      const phys_addr pa{
+          memblock::alloc(sizeof(zone_allocator_t), alignof(zone_allocator_t))};
+      if (pa == phys_addr{})
+        return xino::error_nr::nomem;
+
+      zone_allocator_t *z{new (static_cast<void *>(zone_va(pa)))
+                              zone_allocator_t{}};
+      if (auto ret{z->init(w, zone_size, false)}; ret != xino::error_nr::ok)
+        return ret;
+
+      zones[nr_zones++] = zone{w, pa};
+    }
+  }
+
+  // Populate from "usable minus reserved" in one pass.
+  memblock::for_each_free(
+      [this](phys_addr pa, std::size_t size) { add_free(pa, size); });
+
+  // Release the unused part of the boot heap.
+  boot_allocator.for_each_free([this, gs](phys_addr pa, unsigned order) {
+    add_free(pa, order_to_pages(order) * gs);
+  });
+
+  main_ready = true;
+
+  return xino::error_nr::ok;
+}
+
+xino::mm::phys_addr page_allocator_t::alloc_pages(const xino::nothrow_t &,
+                                                  unsigned order) noexcept {
+  if (!main_ready)
+    return boot_allocator.alloc_pages(xino::nothrow, order);
+
+  xino::mm::phys_addr pa{};
+
+  xino::sync::irq_flags_t f{lock.lock_irqsave()};
+  // Prefer high memory; keep low memory for users that need it.
+  for (std::size_t i{nr_zones}; i-- > 0 && pa == xino::mm::phys_addr{};)
+    pa = zone_va(zones[i].pa)->alloc_pages(xino::nothrow, order);
+  lock.unlock_irqrestore(f);
+
+  XINO_TRACE("alloc_pages", "order %u pa %#lx", order, pa);
+
+  return pa;
+}
+
+void page_allocator_t::free_pages(xino::mm::phys_addr pa,
+                                  unsigned order) noexcept {
+  if (!main_ready) {
+    boot_allocator.free_pages(pa, order);
+    return;
+  }
+
+  xino::sync::irq_flags_t f{lock.lock_irqsave()};
+  // Also adopts pages allocated from the boot heap before the handoff.
+  zone_allocator_t *z{find_zone(pa)};
+  if (z != nullptr)
+    z->free_pages(pa, order);
+  lock.unlock_irqrestore(f);
+
+  if (z == nullptr) {
+    xino::klog::log(xino::klog::level::err,
+                    "allocator: free_pages(%#lx, %u): not in any zone\n",
+                    (unsigned long)pa, order);
+    return;
+  }
+
+  XINO_TRACE("free_pages", "order %u pa %#lx", order, pa);
+}
+
 } // namespace xino::allocator
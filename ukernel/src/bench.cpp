@@ -0,0 +1,349 @@
+#include <config.h>
+
+#ifdef UKERNEL_BENCH
+
+#include <bench.hpp>
+#include <cache.hpp>
+#include <cpu.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <percpu.hpp>
+#include <qspinlock.hpp>
+#include <rcu.hpp>
+#include <smp.hpp>
+#include <sync.hpp>
+
+namespace xino::bench {
+
+struct lock_stats {
+  std::uint64_t acquisitions;
+  std::uint64_t total_ticks; // Sum of acquisition latencies.
+  std::uint64_t max_ticks;
+};
+
+[[gnu::used, gnu::section(".percpu_aligned")]]
+constinit xino::percpu::hot<lock_stats> lock_stats_pcpu{};
+
+static constexpr std::uint64_t run_ms{200}; // Duration of each phase.
+static constexpr unsigned cs_work{16};      // Shared writes under the lock.
+static constexpr unsigned think_loops{256}; // Delay between acquisitions.
+
+__cacheline_aligned constinit static xino::sync::spin_lock spin{"bench"};
+__cacheline_aligned constinit static xino::sync::queued_spin_lock qspin{};
+__cacheline_aligned constinit static std::uint64_t shared[cs_work]{};
+
+__cacheline_aligned constinit static unsigned barrier_count{0};
+__cacheline_aligned constinit static unsigned barrier_gen{0};
+__cacheline_aligned constinit static std::uint64_t deadline{0};
+
+static void cpu_barrier(unsigned ncpu) {
+  const unsigned gen{__atomic_load_n(&barrier_gen, __ATOMIC_ACQUIRE)};
+
+  if (__atomic_add_fetch(&barrier_count, 1, __ATOMIC_ACQ_REL) == ncpu) {
+    __atomic_store_n(&barrier_count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&barrier_gen, gen + 1, __ATOMIC_RELEASE);
+    xino::cpu::sev();
+    return;
+  }
+
+  xino::cpu::sevl();
+  while (__atomic_load_n(&barrier_gen, __ATOMIC_ACQUIRE) == gen)
+    xino::cpu::wfe();
+}
+
+static std::uint64_t ticks_to_ns(std::uint64_t ticks, std::uint64_t freq) {
+  return ticks * 1000000000 / freq;
+}
+
+/** @brief Synchronize the CPUs; returns the (common) end of the phase. */
+static std::uint64_t phase_start(unsigned cpu, unsigned ncpu) {
+  if (cpu == 0)
+    __atomic_store_n(&deadline,
+                     xino::cpu::cntvct_el0::read() +
+                         xino::cpu::cntfrq_el0::read() / 1000 * run_ms,
+                     __ATOMIC_RELAXED);
+
+  cpu_barrier(ncpu);
+
+  return __atomic_load_n(&deadline, __ATOMIC_RELAXED);
+}
+
+template <typename Lock>
+static void run(const char *name, Lock &lock, unsigned ncpu) {
+  const unsigned cpu{xino::percpu::this_cpu_id()};
+  const std::uint64_t freq{xino::cpu::cntfrq_el0::read()};
+
+  lock_stats &s{xino::percpu::this_cpu(lock_stats_pcpu)};
+  s = {};
+
+  const std::uint64_t end{phase_start(cpu, ncpu)};
+
+  for (;;) {
+    const std::uint64_t t0{xino::cpu::cntvct_el0::read()};
+    if (t0 >= end)
+      break;
+
+    lock.lock();
+    const std::uint64_t t1{xino::cpu::cntvct_el0::read()};
+
+    for (unsigned i{0}; i < cs_work; i++)
+      shared[i]++;
+
+    lock.unlock();
+
+    s.acquisitions++;
+    s.total_ticks += t1 - t0;
+    if (t1 - t0 > s.max_ticks)
+      s.max_ticks = t1 - t0;
+
+    for (unsigned i{0}; i < think_loops; i++)
+      __asm__ __volatile__("" ::: "memory");
+  }
+
+  cpu_barrier(ncpu);
+
+  if (cpu != 0)
+    return;
+
+  std::uint64_t min_acq{~std::uint64_t{0}}, max_acq{0};
+
+  printf("%s (%u CPUs, %lu ms):\n", name, ncpu, (unsigned long)run_ms);
+  for (unsigned c{0}; c < ncpu; c++) {
+    const lock_stats &p{xino::percpu::per_cpu(lock_stats_pcpu, c)};
+    const std::uint64_t avg{p.acquisitions ? p.total_ticks / p.acquisitions
+                                           : 0};
+
+    printf("  cpu%u: %lu acquisitions, avg %lu ns, max %lu ns\n", c,
+           (unsigned long)p.acquisitions,
+           (unsigned long)ticks_to_ns(avg, freq),
+           (unsigned long)ticks_to_ns(p.max_ticks, freq));
+
+    if (p.acquisitions < min_acq)
+      min_acq = p.acquisitions;
+    if (p.acquisitions > max_acq)
+      max_acq = p.acquisitions;
+  }
+
+  // Fairness: fewest acquisitions relative to most (100% is fair).
+  printf("  fairness (min/max): %lu%%\n",
+         (unsigned long)(max_acq ? min_acq * 100 / max_acq : 100));
+}
+
+void lock_bench(unsigned ncpu) noexcept {
+  run("spin_lock", spin, ncpu);
+  run("queued_spin_lock", qspin, ncpu);
+}
+
+struct read_stats {
+  std::uint64_t reads;
+  std::uint64_t updates;
+  std::uint64_t torn; // Reads that saw a half-updated object (must be 0).
+};
+
+[[gnu::used, gnu::section(".percpu_aligned")]]
+constinit xino::percpu::hot<read_stats> read_stats_pcpu{};
+
+static constexpr unsigned update_every{1024}; // CPU0 reads per update.
+static constexpr unsigned qs_every{64};       // Reads per quiescent state.
+
+/** @brief Shared object; `a == b` in every published version. */
+struct bench_obj {
+  xino::rcu::rcu_head rcu;
+  std::uint64_t a;
+  std::uint64_t b;
+};
+
+__cacheline_aligned constinit static xino::sync::rw_spin_lock obj_lock{};
+__cacheline_aligned constinit static bench_obj locked_obj{};
+__cacheline_aligned constinit static bench_obj first_obj{};
+__cacheline_aligned constinit static bench_obj *rcu_obj{&first_obj};
+
+static void free_obj(xino::rcu::rcu_head *h) {
+  if (h != &first_obj.rcu)
+    delete reinterpret_cast<bench_obj *>(h);
+}
+
+template <typename Read, typename Update>
+static void run_reads(const char *name, unsigned ncpu, Read &&read,
+                      Update &&update) {
+  const unsigned cpu{xino::percpu::this_cpu_id()};
+
+  read_stats &s{xino::percpu::this_cpu(read_stats_pcpu)};
+  s = {};
+
+  const std::uint64_t end{phase_start(cpu, ncpu)};
+
+  while (xino::cpu::cntvct_el0::read() < end) {
+    for (unsigned i{0}; i < qs_every; i++)
+      if (!read())
+        s.torn++;
+
+    s.reads += qs_every;
+    xino::rcu::rcu_quiescent_state();
+
+    if (cpu == 0 && s.reads % update_every == 0) {
+      update();
+      s.updates++;
+    }
+  }
+
+  cpu_barrier(ncpu);
+
+  if (cpu != 0)
+    return;
+
+  std::uint64_t total{0}, updates{0}, torn{0};
+
+  printf("%s (%u CPUs, %lu ms):\n", name, ncpu, (unsigned long)run_ms);
+  for (unsigned c{0}; c < ncpu; c++) {
+    const read_stats &p{xino::percpu::per_cpu(read_stats_pcpu, c)};
+
+    printf("  cpu%u: %lu reads\n", c, (unsigned long)p.reads);
+    total += p.reads;
+    updates += p.updates;
+    torn += p.torn;
+  }
+
+  printf("  total: %lu reads/ms, %lu updates, %lu torn\n",
+         (unsigned long)(total / run_ms), (unsigned long)updates,
+         (unsigned long)torn);
+}
+
+void rcu_bench(unsigned ncpu) noexcept {
+  run_reads(
+      "rw_spin_lock", ncpu,
+      [] {
+        obj_lock.read_lock();
+        const bool ok{locked_obj.a == locked_obj.b};
+        obj_lock.read_unlock();
+        return ok;
+      },
+      [] {
+        obj_lock.write_lock();
+        locked_obj.a++;
+        locked_obj.b++;
+        obj_lock.write_unlock();
+      });
+
+  run_reads(
+      "rcu", ncpu,
+      [] {
+        xino::rcu::rcu_read_lock();
+        const bench_obj *o{xino::rcu::rcu_dereference(rcu_obj)};
+        const bool ok{o->a == o->b};
+        xino::rcu::rcu_read_unlock();
+        return ok;
+      },
+      [] {
+        bench_obj *const old{rcu_obj};
+        bench_obj *const o{new (std::nothrow) bench_obj{*old}};
+        if (o == nullptr)
+          return;
+
+        o->a++;
+        o->b++;
+        xino::rcu::rcu_assign_pointer(rcu_obj, o);
+        xino::rcu::call_rcu(&old->rcu, free_obj);
+      });
+}
+
+static constexpr unsigned ipi_rounds{1000}; // Calls per measurement.
+
+[[gnu::used, gnu::section(".percpu_aligned")]]
+constinit xino::percpu::hot<std::uint64_t> ipi_calls_pcpu{};
+
+static void ipi_nop(void *) {}
+
+static void ipi_count(void *) { xino::percpu::this_cpu_inc(ipi_calls_pcpu); }
+
+void ipi_bench() noexcept {
+  const unsigned self{xino::percpu::this_cpu_id()};
+  const std::uint64_t freq{xino::cpu::cntfrq_el0::read()};
+
+  xino::smp::cpumask others{xino::smp::cpu_online_mask()};
+  others.clear(self);
+
+  if (others.empty()) {
+    printf("ipi: no other online CPU\n");
+    return;
+  }
+
+  // Round trip: one synchronous call at a time.
+  printf("ipi round trip (%u calls per CPU):\n", ipi_rounds);
+  others.for_each([&](unsigned cpu) {
+    std::uint64_t total{0}, max{0};
+
+    for (unsigned i{0}; i < ipi_rounds; i++) {
+      const std::uint64_t t0{xino::cpu::cntvct_el0::read()};
+      xino::smp::smp_call_function_single(cpu, ipi_nop, nullptr, true);
+      const std::uint64_t t{xino::cpu::cntvct_el0::read() - t0};
+
+      total += t;
+      if (t > max)
+        max = t;
+    }
+
+    printf("  cpu%u: avg %lu ns, max %lu ns\n", cpu,
+           (unsigned long)ticks_to_ns(total / ipi_rounds, freq),
+           (unsigned long)ticks_to_ns(max, freq));
+  });
+
+  // Asynchronous broadcast: calls queued while the targets are busy share
+  // an SGI.
+  others.for_each([&](unsigned cpu) {
+    xino::percpu::per_cpu(ipi_calls_pcpu, cpu) = 0;
+  });
+
+  std::uint64_t ipis[xino::smp::nr_cpus_max]{};
+  others.for_each(
+      [&](unsigned cpu) { ipis[cpu] = xino::smp::nr_call_ipis(cpu); });
+
+  const std::uint64_t t0{xino::cpu::cntvct_el0::read()};
+  for (unsigned i{0}; i < ipi_rounds; i++)
+    xino::smp::smp_call_function_many(others, ipi_count, nullptr, false);
+  xino::smp::smp_call_function_many(others, ipi_nop, nullptr, true);
+  const std::uint64_t t{xino::cpu::cntvct_el0::read() - t0};
+
+  printf("ipi broadcast (%u async calls to %u CPUs): %lu ns per call\n",
+         ipi_rounds, others.weight(),
+         (unsigned long)ticks_to_ns(t / ipi_rounds, freq));
+  others.for_each([&](unsigned cpu) {
+    printf("  cpu%u: %lu calls, %lu SGIs\n", cpu,
+           (unsigned long)__atomic_load_n(
+               &xino::percpu::per_cpu(ipi_calls_pcpu, cpu), __ATOMIC_RELAXED),
+           (unsigned long)(xino::smp::nr_call_ipis(cpu) - ipis[cpu]));
+  });
+}
+
+/** @brief Number of CPUs taking part in run_all(), see bench_secondary(). */
+constinit static unsigned bench_ncpu{1};
+
+static void bench_secondary(void *) {
+  lock_bench(bench_ncpu);
+  rcu_bench(bench_ncpu);
+}
+
+void run_all() noexcept {
+  // The benchmarks index CPUs from 0; use the first online CPUs only.
+  const xino::smp::cpumask online{xino::smp::cpu_online_mask()};
+  unsigned ncpu{1};
+  while (ncpu < xino::smp::nr_cpus_max && online.test(ncpu))
+    ncpu++;
+
+  xino::smp::cpumask others{};
+  for (unsigned cpu{1}; cpu < ncpu; cpu++)
+    others.set(cpu);
+
+  bench_ncpu = ncpu;
+  // Published by the release in smp_call_function_many().
+  xino::smp::smp_call_function_many(others, bench_secondary, nullptr, false);
+
+  lock_bench(ncpu);
+  rcu_bench(ncpu);
+  ipi_bench();
+}
+
+} // namespace xino::bench
+
+#endif // UKERNEL_BENCH
@@ -0,0 +1,261 @@
+#include <barrier.hpp>
+#include <cache.hpp>
+#include <cache_maint.hpp>
+#include <config.h> // UKERNEL_CACHE_LINE
+#include <cpu.hpp>
+#include <cstdint>
+#include <klog.hpp>
+#include <percpu.hpp>
+#include <sync.hpp>
+
+namespace xino::cache {
+
+/** @brief Geometry of one cache level, see read_geometry(). */
+struct cache_geometry {
+  unsigned line_shift; // Log2 bytes.
+  unsigned ways;
+  unsigned sets;
+};
+
+// Safe defaults until cache_init(): the smallest architectural line.
+__read_mostly constinit static std::size_t dline{16};
+__read_mostly constinit static std::size_t iline{16};
+__read_mostly constinit static std::size_t cwg{0};
+__read_mostly constinit static bool idc{false};
+__read_mostly constinit static bool dic{false};
+
+/** @brief Size above which whole-cache maintenance is cheaper (0: never). */
+__read_mostly constinit static std::size_t set_way_threshold{0};
+
+/** @brief Size of `CTR_EL0` line fields (log2 words), in bytes. */
+static std::size_t ctr_bytes(std::uint64_t ctr, std::uint64_t mask,
+                             unsigned lsb) {
+  return std::size_t{4} << ((ctr & mask) >> lsb);
+}
+
+/** @brief Cache type of level @p level (0 is level 1), see `CLIDR_EL1`. */
+static unsigned clidr_ctype(std::uint64_t clidr, unsigned level) {
+  return (clidr >> (3 * level)) & xino::cpu::clidr_el1::ctype1::mask;
+}
+
+static unsigned clidr_loc(std::uint64_t clidr) {
+  return (clidr & xino::cpu::clidr_el1::loc::mask) >> 24;
+}
+
+/**
+ * @brief Read the geometry of the data (or unified) cache of level @p level.
+ *
+ * Call with IRQs masked: `CSSELR_EL1` selects the cache `CCSIDR_EL1` reads.
+ */
+static cache_geometry read_geometry(unsigned level) {
+  using namespace xino::cpu;
+
+  csselr_el1::write(csselr_el1::level::encode(level));
+  const std::uint64_t c{ccsidr_el1::read()};
+
+  cache_geometry g{};
+  g.line_shift = static_cast<unsigned>(c & ccsidr_el1::line_size::mask) + 4;
+  // Associativity and NumSets moved with FEAT_CCIDX.
+  using mmfr2 = id_aa64mmfr2_el1;
+  if (mmfr2::read_ccidx() != mmfr2::ccidx::not_supported) {
+    g.ways = static_cast<unsigned>((c >> 3) & 0x1fffff) + 1;
+    g.sets = static_cast<unsigned>((c >> 32) & 0xffffff) + 1;
+  } else {
+    g.ways = static_cast<unsigned>((c >> 3) & 0x3ff) + 1;
+    g.sets = static_cast<unsigned>((c >> 13) & 0x7fff) + 1;
+  }
+
+  return g;
+}
+
+/** @brief Total size of this CPU's data and unified caches, up to the LoC. */
+static std::size_t dcache_total_size() {
+  const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+  const std::uint64_t clidr{xino::cpu::clidr_el1::read()};
+
+  std::size_t total{0};
+  for (unsigned level{0}; level < clidr_loc(clidr); level++) {
+    if (clidr_ctype(clidr, level) < xino::cpu::clidr_el1::ctype1::data)
+      continue;
+
+    const cache_geometry g{read_geometry(level)};
+    total += (std::size_t{g.ways} * g.sets) << g.line_shift;
+  }
+
+  xino::sync::irq_restore(f);
+
+  return total;
+}
+
+void cache_init() noexcept {
+  using xino::cpu::ctr_el0;
+
+  const std::uint64_t ctr{ctr_el0::read()};
+  const std::size_t d{ctr_bytes(ctr, ctr_el0::dminline::mask, 16)};
+  const std::size_t i{ctr_bytes(ctr, ctr_el0::iminline::mask, 0)};
+  // CWG 0: not reported; assume the D-cache line.
+  const std::size_t w{(ctr & ctr_el0::cwg::mask) != 0
+                          ? ctr_bytes(ctr, ctr_el0::cwg::mask, 24)
+                          : d};
+  const std::size_t total{dcache_total_size()};
+
+  // Check if it is the first CPU running cache_init().
+  if (cwg == 0) {
+    dline = d;
+    iline = i;
+    cwg = w;
+    idc = (ctr & ctr_el0::idc::mask) != 0;
+    dic = (ctr & ctr_el0::dic::mask) != 0;
+    set_way_threshold = total;
+  } else {
+    if (d < dline)
+      dline = d;
+    if (i < iline)
+      iline = i;
+    if (w > cwg)
+      cwg = w;
+    idc = idc && (ctr & ctr_el0::idc::mask) != 0;
+    dic = dic && (ctr & ctr_el0::dic::mask) != 0;
+    if (total < set_way_threshold)
+      set_way_threshold = total;
+  }
+
+  if (w > UKERNEL_CACHE_LINE)
+    xino::klog::log(xino::klog::level::warn,
+                    "cache: writeback granule %zu > UKERNEL_CACHE_LINE\n", w);
+}
+
+std::size_t dcache_line_size() noexcept { return dline; }
+
+std::size_t icache_line_size() noexcept { return iline; }
+
+std::size_t cache_writeback_granule() noexcept {
+  return cwg != 0 ? cwg : UKERNEL_CACHE_LINE;
+}
+
+/**
+ * @brief Apply @p Op to every @p line sized line overlapping [@p start,
+ *        @p end); four lines per iteration.
+ */
+template <void (*Op)(std::uintptr_t)>
+static void for_each_line(std::uintptr_t start, std::uintptr_t end,
+                          std::size_t line) {
+  const std::size_t step{4 * line};
+  std::uintptr_t a{start & ~(line - 1)};
+
+  for (; a < end && end - a >= step; a += step) {
+    Op(a);
+    Op(a + line);
+    Op(a + 2 * line);
+    Op(a + 3 * line);
+  }
+
+  for (; a < end; a += line)
+    Op(a);
+}
+
+/** @brief Whether whole-cache maintenance may replace a @p size range. */
+static bool use_set_way(std::size_t size) {
+  // Set/way operations miss the other CPUs' caches.
+  return set_way_threshold != 0 && size >= set_way_threshold &&
+         xino::percpu::nr_cpu_ids() == 1;
+}
+
+void clean_dcache_range(xino::mm::virt_addr va, std::size_t size) noexcept {
+  if (use_set_way(size)) {
+    clean_dcache_all();
+    return;
+  }
+
+  const auto start{static_cast<xino::mm::virt_addr::value_type>(va)};
+  for_each_line<xino::cpu::dc_cvac>(start, start + size, dline);
+  xino::barrier::dsb<xino::barrier::opt::sy>();
+}
+
+void clean_inval_dcache_range(xino::mm::virt_addr va,
+                              std::size_t size) noexcept {
+  if (use_set_way(size)) {
+    clean_inval_dcache_all();
+    return;
+  }
+
+  const auto start{static_cast<xino::mm::virt_addr::value_type>(va)};
+  for_each_line<xino::cpu::dc_civac>(start, start + size, dline);
+  xino::barrier::dsb<xino::barrier::opt::sy>();
+}
+
+void inval_dcache_range(xino::mm::virt_addr va, std::size_t size) noexcept {
+  std::uintptr_t start{static_cast<xino::mm::virt_addr::value_type>(va)};
+  std::uintptr_t end{start + size};
+  const std::uintptr_t mask{dline - 1};
+
+  // Partial lines hold data outside the range: clean them too.
+  if (start & mask) {
+    start &= ~mask;
+    xino::cpu::dc_civac(start);
+    start += dline;
+  }
+
+  if ((end & mask) && end > start) {
+    end &= ~mask;
+    xino::cpu::dc_civac(end);
+  }
+
+  if (end > start)
+    for_each_line<xino::cpu::dc_ivac>(start, end, dline);
+  xino::barrier::dsb<xino::barrier::opt::sy>();
+}
+
+void sync_icache_range(xino::mm::virt_addr va, std::size_t size) noexcept {
+  using namespace xino::barrier;
+
+  const auto start{static_cast<xino::mm::virt_addr::value_type>(va)};
+
+  if (!idc)
+    for_each_line<xino::cpu::dc_cvau>(start, start + size, dline);
+  dsb<opt::ish>();
+
+  if (!dic) {
+    for_each_line<xino::cpu::ic_ivau>(start, start + size, iline);
+    dsb<opt::ish>();
+  }
+
+  isb();
+}
+
+/** @brief Apply @p Op to every line of this CPU's data and unified caches. */
+template <void (*Op)(std::uint64_t)> static void for_each_set_way() {
+  const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+  const std::uint64_t clidr{xino::cpu::clidr_el1::read()};
+
+  // Complete earlier stores before the walk.
+  xino::barrier::dsb<xino::barrier::opt::sy>();
+
+  for (unsigned level{0}; level < clidr_loc(clidr); level++) {
+    if (clidr_ctype(clidr, level) < xino::cpu::clidr_el1::ctype1::data)
+      continue;
+
+    const cache_geometry g{read_geometry(level)};
+    // Way in the top bits, set above the line offset, level in [3:1].
+    const unsigned way_shift{
+        g.ways > 1 ? static_cast<unsigned>(__builtin_clz(g.ways - 1)) : 0U};
+
+    for (unsigned way{0}; way < g.ways; way++)
+      for (unsigned set{0}; set < g.sets; set++)
+        Op((std::uint64_t{way} << way_shift) |
+           (std::uint64_t{set} << g.line_shift) | (level << 1));
+
+    xino::barrier::dsb<xino::barrier::opt::sy>();
+  }
+
+  xino::barrier::isb();
+  xino::sync::irq_restore(f);
+}
+
+void clean_dcache_all() noexcept { for_each_set_way<xino::cpu::dc_csw>(); }
+
+void clean_inval_dcache_all() noexcept {
+  for_each_set_way<xino::cpu::dc_cisw>();
+}
+
+} // namespace xino::cache
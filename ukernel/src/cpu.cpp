@@ -1,9 +1,12 @@
-
 #include <cpu.hpp>
+#include <plat_uart.hpp>
 
 namespace xino::cpu {
 
 [[noreturn]] void panic() {
+  // Text queued for the console is sent polled before the CPU stops.
+  xino::plat::uart::console_sync();
+
   for (;;)
     wfe();
 
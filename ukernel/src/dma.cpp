@@ -0,0 +1,469 @@
+#include <allocator.hpp> // buddy, page_allocator, size_to_order_up
+#include <cache.hpp>
+#include <cache_maint.hpp>
+#include <config.h> // UKERNEL_DMA_POOL_SIZE
+#include <cpu.hpp>
+#include <cstring>
+#include <dma.hpp>
+#include <mm_ioremap.hpp>
+#include <mm_paging.hpp>
+#include <mm_va_layout.hpp>
+#include <optional>
+#include <runtime.hpp> // use_mapping
+#include <sync.hpp>
+
+namespace xino::dma {
+
+using pv_t = xino::mm::phys_addr::value_type;
+
+/** @brief Order of the DMA pool. */
+static constexpr unsigned pool_order{
+    xino::allocator::size_to_order_up(UKERNEL_DMA_POOL_SIZE)};
+
+/** @brief Buddy allocator managing the pages of the DMA pool. */
+using pool_allocator_t = xino::allocator::buddy<pool_order>;
+
+/**
+ * @brief A live bounce buffer.
+ *
+ * `[pa, pa + size)` in the pool stands in for `[buf, buf + size)`.
+ */
+struct bounce {
+  void *buf; // Zero means the slot is free.
+  xino::mm::phys_addr pa;
+  std::size_t size;
+  unsigned order;
+};
+
+// Maximum number of live bounce buffers.
+static constexpr std::size_t max_bounces{64};
+
+// Pool `[pool_pa, pool_pa + pool_size)`, accessed at `pool_va`.
+__read_mostly static constinit xino::mm::phys_addr pool_pa{};
+__read_mostly static constinit xino::mm::virt_addr pool_va{};
+__read_mostly static constinit std::size_t pool_size{};
+// The CPU accesses the pool non-cacheable.
+__read_mostly static constinit bool pool_coherent{};
+
+static constinit pool_allocator_t pool_allocator{};
+static constinit bounce bounces[max_bounces]{};
+__cacheline_aligned static constinit xino::sync::spin_lock pool_lock{
+    "dma_pool"};
+
+[[nodiscard]] static xino::mm::bus_addr
+to_bus(xino::mm::phys_addr pa) noexcept {
+  return xino::mm::bus_addr{static_cast<pv_t>(pa)};
+}
+
+[[nodiscard]] static xino::mm::phys_addr
+to_phys(xino::mm::bus_addr addr) noexcept {
+  return xino::mm::phys_addr{static_cast<pv_t>(addr)};
+}
+
+[[nodiscard]] static bool in_pool(xino::mm::phys_addr pa) noexcept {
+  return pool_pa <= pa && pa < pool_pa + pool_size;
+}
+
+[[nodiscard]] static xino::mm::virt_addr
+pool_to_virt(xino::mm::phys_addr pa) noexcept {
+  return pool_va + static_cast<std::size_t>(pa - pool_pa);
+}
+
+[[nodiscard]] static bool reachable(const device &dev, xino::mm::phys_addr pa,
+                                    std::size_t size) noexcept {
+  return static_cast<pv_t>(pa) + (size - 1) <= dev.dma_mask;
+}
+
+/* Address translation. */
+
+// Translate a kernel VA, including the vmalloc window.
+[[nodiscard]] static std::optional<xino::mm::phys_addr>
+kernel_virt_to_phys(xino::mm::virt_addr va) noexcept {
+  using namespace xino::mm::paging;
+
+  const std::optional<xino::mm::phys_addr> pa{
+      xino::mm::va_layout::virt_to_phys(va, xino::runtime::use_mapping)};
+  if (pa.has_value() || !xino::runtime::use_mapping ||
+      !xino::mm::va_layout::is_vmalloc(va))
+    return pa;
+
+  xino::mm::phys_addr leaf_pa{};
+  std::size_t leaf{};
+
+  xino::sync::irq_flags_t f{kernel_page_table_lock.lock_irqsave()};
+  const xino::error_t ret{kernel_page_table.lookup({va, 0}, leaf_pa, leaf)};
+  kernel_page_table_lock.unlock_irqrestore(f);
+
+  if (ret != xino::error_nr::ok)
+    return std::nullopt;
+
+  return leaf_pa;
+}
+
+/**
+ * @brief Physically contiguous prefix of `[va, va + size)`.
+ *
+ * @param[out] pa Receives the physical address of @p va.
+ * @return Length of the prefix, or 0 if @p va is not mapped.
+ */
+[[nodiscard]] static std::size_t
+contiguous_run(xino::mm::virt_addr va, std::size_t size,
+               xino::mm::phys_addr &pa) noexcept {
+  const std::optional<xino::mm::phys_addr> first{kernel_virt_to_phys(va)};
+  if (!first.has_value())
+    return 0;
+
+  pa = first.value();
+
+  // Other windows map linearly.
+  if (!xino::runtime::use_mapping || !xino::mm::va_layout::is_vmalloc(va))
+    return size;
+
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+
+  // Walk page by page while the PAs stay adjacent.
+  std::size_t run{gs - (static_cast<std::size_t>(va) & (gs - 1))};
+  while (run < size) {
+    const std::optional<xino::mm::phys_addr> next{
+        kernel_virt_to_phys(va + run)};
+    if (!next.has_value() || next.value() != pa + run)
+      return run;
+
+    run += gs;
+  }
+
+  return size;
+}
+
+/* Cache maintenance. */
+
+static void sync_for_device(xino::mm::virt_addr va, std::size_t size,
+                            direction dir) noexcept {
+  switch (dir) {
+  case direction::to_device:
+    xino::cache::clean_dcache_range(va, size);
+    break;
+  case direction::from_device:
+    xino::cache::inval_dcache_range(va, size);
+    break;
+  case direction::bidirectional:
+    xino::cache::clean_inval_dcache_range(va, size);
+    break;
+  }
+}
+
+static void sync_for_cpu(xino::mm::virt_addr va, std::size_t size,
+                         direction dir) noexcept {
+  // Drop lines fetched speculatively while the device was writing.
+  if (dir != direction::to_device)
+    xino::cache::inval_dcache_range(va, size);
+}
+
+// Usable VA of a directly mapped (not bounced) bus address.
+[[nodiscard]] static xino::mm::virt_addr
+direct_to_virt(xino::mm::bus_addr addr) noexcept {
+  return xino::mm::va_layout::phys_to_virt(to_phys(addr),
+                                           xino::runtime::use_mapping);
+}
+
+/* Bounce buffers. */
+
+// Find the bounce buffer containing @p pa; call holding `pool_lock`.
+[[nodiscard]] static bounce *find_bounce(xino::mm::phys_addr pa) noexcept {
+  for (bounce &b : bounces) {
+    if (b.buf != nullptr && b.pa <= pa && pa < b.pa + b.size)
+      return &b;
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief Look up the bounce buffer containing @p addr.
+ *
+ * @param[out] b Receives a copy of the bounce buffer.
+ * @return `true` if @p addr is bounced.
+ */
+[[nodiscard]] static bool lookup_bounce(xino::mm::bus_addr addr,
+                                        bounce &b) noexcept {
+  const xino::mm::phys_addr pa{to_phys(addr)};
+
+  if (!in_pool(pa))
+    return false;
+
+  xino::sync::irq_flags_t f{pool_lock.lock_irqsave()};
+  const bounce *const it{find_bounce(pa)};
+  if (it != nullptr)
+    b = *it;
+  pool_lock.unlock_irqrestore(f);
+
+  return it != nullptr;
+}
+
+[[nodiscard]] static xino::mm::bus_addr
+map_bounce(const device &dev, void *buf, std::size_t size,
+           direction dir) noexcept {
+  const unsigned order{xino::allocator::size_to_order_up(size)};
+
+  // The device must reach the pool.
+  if (pool_size == 0 || !reachable(dev, pool_pa, pool_size))
+    return xino::mm::bus_addr{};
+
+  xino::mm::phys_addr pa{};
+
+  xino::sync::irq_flags_t f{pool_lock.lock_irqsave()};
+  for (bounce &it : bounces) {
+    if (it.buf != nullptr)
+      continue;
+
+    pa = pool_allocator.alloc_pages(xino::nothrow, order);
+    if (pa != xino::mm::phys_addr{})
+      it = bounce{buf, pa, size, order};
+    break;
+  }
+  pool_lock.unlock_irqrestore(f);
+
+  if (pa == xino::mm::phys_addr{})
+    return xino::mm::bus_addr{};
+
+  xino::mm::virt_addr va{pool_to_virt(pa)};
+
+  if (dir != direction::from_device)
+    memcpy(va.ptr<void>(), buf, size);
+
+  if (!pool_coherent && !dev.coherent)
+    sync_for_device(va, size, dir);
+
+  return to_bus(pa);
+}
+
+static void unmap_bounce(const device &dev, const bounce &b,
+                         direction dir) noexcept {
+  const xino::mm::virt_addr va{pool_to_virt(b.pa)};
+
+  if (dir != direction::to_device) {
+    if (!pool_coherent && !dev.coherent)
+      sync_for_cpu(va, b.size, dir);
+    memcpy(b.buf, va.ptr<void>(), b.size);
+  }
+
+  xino::sync::irq_flags_t f{pool_lock.lock_irqsave()};
+  if (bounce *const it{find_bounce(b.pa)}; it != nullptr)
+    *it = bounce{};
+  pool_allocator.free_pages(b.pa, b.order);
+  pool_lock.unlock_irqrestore(f);
+}
+
+xino::error_t dma_init() noexcept {
+  using xino::allocator::page_allocator;
+
+  const std::size_t size{xino::allocator::order_to_pages(pool_order) *
+                         xino::mm::va_layout::granule_size()};
+
+  // Page 0 is never handed out, so neither the pool nor any block of it
+  // starts at `PA{0}`, the failure value of both allocators.
+  const xino::mm::phys_addr pa{
+      page_allocator.alloc_pages(xino::nothrow, pool_order)};
+  if (pa == xino::mm::phys_addr{})
+    return xino::error_nr::nomem;
+
+  const xino::mm::virt_addr alias{
+      xino::mm::va_layout::phys_to_virt(pa, xino::runtime::use_mapping)};
+
+  // The pool is only accessed non-cacheable from now on; drop its lines.
+  xino::cache::clean_inval_dcache_range(alias, size);
+
+  xino::mm::virt_addr va{};
+  bool coherent{};
+
+  if (xino::runtime::use_mapping) {
+    va = xino::mm::ioremap(pa, size, xino::mm::prot_writecombine);
+    coherent = true;
+  } else {
+    using xino::cpu::sctlr_el2;
+
+    // Identity mapping; non-cacheable if the MMU or the data cache is off.
+    const sctlr_el2::reg_type sctlr{sctlr_el2::read()};
+    va = alias;
+    coherent = (sctlr & sctlr_el2::m::mask) == 0 ||
+               (sctlr & sctlr_el2::c::mask) == 0;
+  }
+
+  if (va == xino::mm::virt_addr{} ||
+      pool_allocator.init(pa, size) != xino::error_nr::ok) {
+    if (va != xino::mm::virt_addr{})
+      xino::mm::iounmap(va);
+    page_allocator.free_pages(pa, pool_order);
+    return xino::error_nr::nomem;
+  }
+
+  pool_pa = pa;
+  pool_va = va;
+  pool_size = size;
+  pool_coherent = coherent;
+
+  return xino::error_nr::ok;
+}
+
+/* Streaming mappings. */
+
+xino::mm::bus_addr map_single(const device &dev, void *buf, std::size_t size,
+                              direction dir) noexcept {
+  if (buf == nullptr || size == 0)
+    return xino::mm::bus_addr{};
+
+  const xino::mm::virt_addr va{buf};
+
+  xino::mm::phys_addr pa{};
+  const std::size_t run{contiguous_run(va, size, pa)};
+  if (run == 0)
+    return xino::mm::bus_addr{};
+
+  if (run < size || !reachable(dev, pa, size))
+    return map_bounce(dev, buf, size, dir);
+
+  if (!dev.coherent)
+    sync_for_device(va, size, dir);
+
+  return to_bus(pa);
+}
+
+void unmap_single(const device &dev, xino::mm::bus_addr addr, std::size_t size,
+                  direction dir) noexcept {
+  if (bounce b; lookup_bounce(addr, b)) {
+    unmap_bounce(dev, b, dir);
+    return;
+  }
+
+  if (!dev.coherent)
+    sync_for_cpu(direct_to_virt(addr), size, dir);
+}
+
+void sync_single_for_cpu(const device &dev, xino::mm::bus_addr addr,
+                         std::size_t size, direction dir) noexcept {
+  if (bounce b; lookup_bounce(addr, b)) {
+    if (dir == direction::to_device)
+      return;
+
+    const std::size_t off{static_cast<std::size_t>(to_phys(addr) - b.pa)};
+    const xino::mm::virt_addr va{pool_to_virt(to_phys(addr))};
+
+    if (!pool_coherent && !dev.coherent)
+      sync_for_cpu(va, size, dir);
+    memcpy(static_cast<char *>(b.buf) + off, va.ptr<void>(), size);
+    return;
+  }
+
+  if (!dev.coherent)
+    sync_for_cpu(direct_to_virt(addr), size, dir);
+}
+
+void sync_single_for_device(const device &dev, xino::mm::bus_addr addr,
+                            std::size_t size, direction dir) noexcept {
+  if (bounce b; lookup_bounce(addr, b)) {
+    const std::size_t off{static_cast<std::size_t>(to_phys(addr) - b.pa)};
+    xino::mm::virt_addr va{pool_to_virt(to_phys(addr))};
+
+    if (dir != direction::from_device)
+      memcpy(va.ptr<void>(), static_cast<char *>(b.buf) + off, size);
+    if (!pool_coherent && !dev.coherent)
+      sync_for_device(va, size, dir);
+    return;
+  }
+
+  if (!dev.coherent)
+    sync_for_device(direct_to_virt(addr), size, dir);
+}
+
+/* Scatter-gather mappings. */
+
+std::size_t sg_init_buffer(scatterlist *sg, std::size_t nents, void *buf,
+                           std::size_t size) noexcept {
+  xino::mm::virt_addr va{buf};
+  const xino::mm::virt_addr end{va + size};
+
+  std::size_t n{0};
+  while (va < end) {
+    xino::mm::phys_addr pa{};
+    const std::size_t run{
+        contiguous_run(va, static_cast<std::size_t>(end - va), pa)};
+    if (run == 0 || n == nents)
+      return 0;
+
+    sg[n++] = scatterlist{va.ptr<void>(), run, xino::mm::bus_addr{}};
+    va += run;
+  }
+
+  return n;
+}
+
+std::size_t map_sg(const device &dev, scatterlist *sg, std::size_t nents,
+                   direction dir) noexcept {
+  for (std::size_t i{0}; i < nents; i++) {
+    sg[i].dma_address = map_single(dev, sg[i].buf, sg[i].length, dir);
+    if (sg[i].dma_address == xino::mm::bus_addr{}) {
+      unmap_sg(dev, sg, i, dir);
+      return 0;
+    }
+  }
+
+  return nents;
+}
+
+void unmap_sg(const device &dev, scatterlist *sg, std::size_t nents,
+              direction dir) noexcept {
+  for (std::size_t i{0}; i < nents; i++)
+    unmap_single(dev, sg[i].dma_address, sg[i].length, dir);
+}
+
+void sync_sg_for_cpu(const device &dev, scatterlist *sg, std::size_t nents,
+                     direction dir) noexcept {
+  for (std::size_t i{0}; i < nents; i++)
+    sync_single_for_cpu(dev, sg[i].dma_address, sg[i].length, dir);
+}
+
+void sync_sg_for_device(const device &dev, scatterlist *sg, std::size_t nents,
+                        direction dir) noexcept {
+  for (std::size_t i{0}; i < nents; i++)
+    sync_single_for_device(dev, sg[i].dma_address, sg[i].length, dir);
+}
+
+/* Coherent memory. */
+
+void *alloc_coherent(std::size_t size, xino::mm::bus_addr &handle) noexcept {
+  if (size == 0 || !pool_coherent)
+    return nullptr;
+
+  const unsigned order{xino::allocator::size_to_order_up(size)};
+
+  xino::sync::irq_flags_t f{pool_lock.lock_irqsave()};
+  const xino::mm::phys_addr pa{
+      pool_allocator.alloc_pages(xino::nothrow, order)};
+  pool_lock.unlock_irqrestore(f);
+
+  if (pa == xino::mm::phys_addr{})
+    return nullptr;
+
+  xino::mm::virt_addr va{pool_to_virt(pa)};
+  memset(va.ptr<void>(), 0,
+         xino::allocator::order_to_pages(order) *
+             xino::mm::va_layout::granule_size());
+
+  handle = to_bus(pa);
+
+  return va.ptr<void>();
+}
+
+void free_coherent(void *addr, std::size_t size) noexcept {
+  if (addr == nullptr)
+    return;
+
+  const xino::mm::phys_addr pa{
+      pool_pa + static_cast<std::size_t>(xino::mm::virt_addr{addr} - pool_va)};
+
+  xino::sync::irq_flags_t f{pool_lock.lock_irqsave()};
+  pool_allocator.free_pages(pa, xino::allocator::size_to_order_up(size));
+  pool_lock.unlock_irqrestore(f);
+}
+
+} // namespace xino::dma
@@ -0,0 +1,68 @@
+#include <cpu.hpp>
+#include <cstdio>
+#include <exception.hpp>
+#include <klog.hpp>
+#include <plat_gic.hpp>
+#include <plat_uart.hpp>
+#include <trace.hpp>
+
+namespace xino::exception {
+
+extern "C" {
+/* See vectors.S. */
+extern char __vectors[];
+}
+
+void exception_init() noexcept {
+  xino::cpu::vbar_el2::write(reinterpret_cast<std::uintptr_t>(__vectors));
+}
+
+static const char *kind_name(vector_kind kind) {
+  switch (kind) {
+  case vector_kind::sync:
+    return "sync";
+  case vector_kind::irq:
+    return "irq";
+  case vector_kind::fiq:
+    return "fiq";
+  case vector_kind::serror:
+    return "serror";
+  }
+
+  return "?";
+}
+
+extern "C" void ukernel_exception_sync(exception_frame *frame) {
+  using esr = xino::cpu::esr_el2;
+
+  const esr::reg_type v{esr::read()};
+  XINO_TRACE("sync_exception", "esr %#lx elr %#lx far %#lx", v, frame->elr,
+             xino::cpu::far_el2::read());
+
+  // Queued console text and log records first, then the report, polled.
+  xino::plat::uart::console_sync();
+  xino::klog::crash_dump();
+  fprintf(stderr, "EL2 sync exception: ESR %#lx (EC %#lx) ELR %#lx FAR %#lx\n",
+          (unsigned long)v, (unsigned long)((v & esr::ec::mask) >> 26),
+          (unsigned long)frame->elr,
+          (unsigned long)xino::cpu::far_el2::read());
+
+  xino::cpu::panic();
+}
+
+extern "C" void ukernel_exception_irq(exception_frame *) {
+  xino::plat::gic::handle_irq();
+}
+
+extern "C" [[noreturn]] void
+ukernel_exception_unexpected(exception_frame *frame, vector_kind kind) {
+  xino::plat::uart::console_sync();
+  xino::klog::crash_dump();
+  fprintf(stderr, "EL2 unexpected %s exception: ESR %#lx ELR %#lx\n",
+          kind_name(kind), (unsigned long)xino::cpu::esr_el2::read(),
+          (unsigned long)frame->elr);
+
+  xino::cpu::panic();
+}
+
+} // namespace xino::exception
@@ -0,0 +1,650 @@
+#include <fdt.hpp>
+#include <mm_memblock.hpp>
+#include <mm_va_layout.hpp>
+#include <runtime.hpp> // use_mapping
+
+namespace xino::fdt {
+
+/* FDT header (big-endian), see section 5.2. */
+struct header {
+  std::uint32_t magic;
+  std::uint32_t totalsize;
+  std::uint32_t off_dt_struct;
+  std::uint32_t off_dt_strings;
+  std::uint32_t off_mem_rsvmap;
+  std::uint32_t version;
+  std::uint32_t last_comp_version;
+  std::uint32_t boot_cpuid_phys;
+  std::uint32_t size_dt_strings;
+  std::uint32_t size_dt_struct;
+};
+
+static constexpr std::uint32_t FDT_MAGIC{0xd00dfeed};
+static constexpr std::uint32_t FDT_VERSION{17};
+
+// Structure block tokens, see section 5.4.
+static constexpr std::uint32_t FDT_BEGIN_NODE{0x1};
+static constexpr std::uint32_t FDT_END_NODE{0x2};
+static constexpr std::uint32_t FDT_PROP{0x3};
+static constexpr std::uint32_t FDT_NOP{0x4};
+static constexpr std::uint32_t FDT_END{0x9};
+
+/** @brief Maximum node depth tracked by @ref parent. */
+static constexpr unsigned max_depth{32};
+/** @brief Maximum number of RAM banks indexed by @ref init. */
+static constexpr std::size_t max_memory_banks{32};
+
+static constinit xino::mm::phys_addr dtb_pa{};
+static constinit const std::uint8_t *dtb{nullptr};
+static constinit std::uint32_t dtb_size{0};
+static constinit const std::uint8_t *structs{nullptr};
+static constinit std::uint32_t structs_size{0};
+static constinit const char *strings{nullptr};
+static constinit std::uint32_t strings_size{0};
+static constinit std::uint32_t rsvmap_off{0};
+
+// Boot lookups, see init().
+static constinit node root_node{};
+static constinit node cpus{};
+static constinit node chosen{};
+static constinit node aliases{};
+static constinit unsigned ncpu{0};
+static constinit std::size_t nbanks{0};
+static constinit xino::mm::memblock::region banks[max_memory_banks]{};
+
+[[nodiscard]] static constexpr std::uint32_t align4(std::uint32_t v) noexcept {
+  return (v + 3) & ~std::uint32_t{3};
+}
+
+/** @brief Length of the string at @p s, or @p max if not NUL-terminated. */
+[[nodiscard]] static std::size_t bounded_strlen(const char *s,
+                                                std::size_t max) noexcept {
+  std::size_t n{0};
+  while (n < max && s[n] != '\0')
+    n++;
+
+  return n;
+}
+
+/**
+ * @brief Read the token at @p off, and return the offset of the next token.
+ *
+ * @return Offset of the next token, or `-1` on `FDT_END` or a malformed
+ *         structure block.
+ */
+[[nodiscard]] static std::int32_t next_tag(std::int32_t off,
+                                           std::uint32_t &tag) noexcept {
+  if (off < 0 || (off & 3) != 0 ||
+      static_cast<std::uint32_t>(off) + 4 > structs_size)
+    return -1;
+
+  tag = be32(structs + off);
+  std::uint32_t next{static_cast<std::uint32_t>(off) + 4};
+
+  switch (tag) {
+  case FDT_BEGIN_NODE: {
+    const std::size_t n{bounded_strlen(
+        reinterpret_cast<const char *>(structs + next), structs_size - next)};
+    if (n == structs_size - next)
+      return -1;
+
+    next = align4(next + static_cast<std::uint32_t>(n) + 1);
+    break;
+  }
+  case FDT_PROP: {
+    if (next + 8 > structs_size)
+      return -1;
+
+    const std::uint32_t len{be32(structs + next)};
+    if (len > structs_size - next - 8)
+      return -1;
+
+    next = align4(next + 8 + len);
+    break;
+  }
+  case FDT_END_NODE:
+  case FDT_NOP:
+    break;
+  default: // FDT_END or unknown.
+    return -1;
+  }
+
+  return next > structs_size ? -1 : static_cast<std::int32_t>(next);
+}
+
+/** @brief Decode the property at @p off (an `FDT_PROP` token). */
+[[nodiscard]] static property prop_at(std::int32_t off) noexcept {
+  const std::uint32_t len{be32(structs + off + 4)};
+  const std::uint32_t nameoff{be32(structs + off + 8)};
+
+  if (nameoff >= strings_size ||
+      bounded_strlen(strings + nameoff, strings_size - nameoff) ==
+          strings_size - nameoff)
+    return {};
+
+  return property{strings + nameoff, structs + off + 12, len};
+}
+
+/**
+ * @brief Skip the properties of the node at @p n.
+ *
+ * @return Offset of the first token after the properties (a child, or the
+ *         node's `FDT_END_NODE`), or `-1`.
+ */
+[[nodiscard]] static std::int32_t skip_properties(node n) noexcept {
+  std::uint32_t tag{};
+  std::int32_t off{next_tag(n.off, tag)};
+
+  while (off >= 0) {
+    std::uint32_t t{};
+    const std::int32_t next{next_tag(off, t)};
+    if (t != FDT_PROP && t != FDT_NOP)
+      return off;
+
+    off = next;
+  }
+
+  return -1;
+}
+
+/** @brief Node name length up to the unit address (`@`). */
+[[nodiscard]] static std::size_t base_name_len(const char *s) noexcept {
+  std::size_t n{0};
+  while (s[n] != '\0' && s[n] != '@')
+    n++;
+
+  return n;
+}
+
+/** @brief Check if @p n matches the path component @p comp. */
+[[nodiscard]] static bool name_matches(node n, std::string_view comp) noexcept {
+  const std::string_view full{name(n)};
+
+  if (full == comp)
+    return true;
+
+  // A component without a unit address matches any unit address.
+  return comp.find('@') == std::string_view::npos &&
+         full.substr(0, base_name_len(full.data())) == comp;
+}
+
+xino::error_t init(xino::mm::phys_addr pa) noexcept {
+  if (pa == xino::mm::phys_addr{} || !pa.is_align(8))
+    return xino::error_nr::invalid;
+
+  const auto *hdr{
+      xino::mm::va_layout::phys_to_virt(pa, xino::runtime::use_mapping)
+          .ptr<const header>()};
+
+  if (be32(&hdr->magic) != FDT_MAGIC)
+    return xino::error_nr::invalid;
+
+  const std::uint32_t total{be32(&hdr->totalsize)};
+  const std::uint32_t st_off{be32(&hdr->off_dt_struct)};
+  const std::uint32_t st_size{be32(&hdr->size_dt_struct)};
+  const std::uint32_t str_off{be32(&hdr->off_dt_strings)};
+  const std::uint32_t str_size{be32(&hdr->size_dt_strings)};
+  const std::uint32_t rsv_off{be32(&hdr->off_mem_rsvmap)};
+
+  if (be32(&hdr->version) < FDT_VERSION ||
+      be32(&hdr->last_comp_version) > FDT_VERSION)
+    return xino::error_nr::invalid;
+
+  if (total < sizeof(header) || st_off > total || st_size > total - st_off ||
+      str_off > total || str_size > total - str_off || rsv_off > total ||
+      (st_off & 3) != 0 || (rsv_off & 7) != 0)
+    return xino::error_nr::invalid;
+
+  dtb_pa = pa;
+  dtb = reinterpret_cast<const std::uint8_t *>(hdr);
+  dtb_size = total;
+  structs = dtb + st_off;
+  structs_size = st_size;
+  strings = reinterpret_cast<const char *>(dtb + str_off);
+  strings_size = str_size;
+  rsvmap_off = rsv_off;
+
+  // Index the boot lookups.
+  root_node = next_node({});
+  if (!root_node.valid())
+    return xino::error_nr::invalid;
+
+  cpus = find_node("/cpus");
+  chosen = find_node("/chosen");
+  aliases = find_node("/aliases");
+
+  ncpu = 0;
+  for_each_cpu_node([](node, std::uint64_t) { ncpu++; });
+
+  const unsigned ac{address_cells(root_node)};
+  const unsigned sc{size_cells(root_node)};
+
+  nbanks = 0;
+  for_each_child(root_node, [&](node n) {
+    const char *type{get_property(n, "device_type").str()};
+    if (type == nullptr || std::string_view{type} != "memory")
+      return;
+
+    const property r{get_property(n, "reg")};
+    if (ac > 2 || sc > 2 || ac + sc == 0)
+      return;
+
+    for (std::size_t i{0}; i + ac + sc <= r.nr_cells() &&
+                           nbanks < max_memory_banks;
+         i += ac + sc) {
+      const std::size_t size{static_cast<std::size_t>(r.cells(i + ac, sc))};
+      if (size != 0)
+        banks[nbanks++] = {xino::mm::phys_addr{r.cells(i, ac)}, size};
+    }
+  });
+
+  return xino::error_nr::ok;
+}
+
+bool present() noexcept { return dtb != nullptr; }
+
+xino::mm::phys_addr blob_pa() noexcept { return dtb_pa; }
+
+std::size_t blob_size() noexcept { return dtb_size; }
+
+/* Tree walk. */
+
+node root() noexcept { return root_node; }
+
+node next_node(node n) noexcept {
+  if (dtb == nullptr)
+    return {};
+
+  std::uint32_t tag{};
+  std::int32_t off{0};
+
+  if (n.valid()) {
+    off = next_tag(n.off, tag);
+  }
+
+  while (off >= 0) {
+    const std::int32_t next{next_tag(off, tag)};
+    if (next < 0)
+      return {};
+    if (tag == FDT_BEGIN_NODE)
+      return node{off};
+
+    off = next;
+  }
+
+  return {};
+}
+
+node first_child(node n) noexcept {
+  if (!n.valid())
+    return {};
+
+  const std::int32_t off{skip_properties(n)};
+  std::uint32_t tag{};
+  if (off < 0 || next_tag(off, tag) < 0 || tag != FDT_BEGIN_NODE)
+    return {};
+
+  return node{off};
+}
+
+node next_sibling(node n) noexcept {
+  if (!n.valid())
+    return {};
+
+  // Skip the subtree of `n`.
+  std::uint32_t tag{};
+  std::int32_t off{n.off};
+  unsigned depth{0};
+
+  do {
+    off = next_tag(off, tag);
+    if (off < 0)
+      return {};
+
+    if (tag == FDT_BEGIN_NODE)
+      depth++;
+    else if (tag == FDT_END_NODE)
+      depth--;
+  } while (depth != 0);
+
+  // Skip NOPs up to the next sibling or the parent's FDT_END_NODE.
+  for (;;) {
+    const std::int32_t next{next_tag(off, tag)};
+    if (next < 0)
+      return {};
+    if (tag == FDT_BEGIN_NODE)
+      return node{off};
+    if (tag != FDT_NOP)
+      return {};
+
+    off = next;
+  }
+}
+
+node parent(node n) noexcept {
+  if (!n.valid() || dtb == nullptr)
+    return {};
+
+  node stack[max_depth]{};
+  unsigned depth{0};
+  std::uint32_t tag{};
+
+  for (std::int32_t off{0}; off >= 0 && off <= n.off;) {
+    const std::int32_t next{next_tag(off, tag)};
+
+    if (tag == FDT_BEGIN_NODE) {
+      if (off == n.off)
+        return depth == 0 ? node{} : stack[depth - 1];
+      if (depth == max_depth)
+        return {};
+
+      stack[depth++] = node{off};
+    } else if (tag == FDT_END_NODE) {
+      if (depth == 0)
+        return {};
+
+      depth--;
+    }
+
+    off = next;
+  }
+
+  return {};
+}
+
+const char *name(node n) noexcept {
+  if (!n.valid())
+    return "";
+
+  return reinterpret_cast<const char *>(structs + n.off + 4);
+}
+
+/* Lookup. */
+
+node find_node(std::string_view path) noexcept {
+  node n{root_node};
+
+  if (!n.valid() || path.empty())
+    return {};
+
+  // Not an absolute path, resolve the alias (up to the first '/').
+  if (path.front() != '/') {
+    const std::size_t slash{path.find('/')};
+    const std::string_view alias{path.substr(0, slash)};
+
+    if (!aliases.valid())
+      return {};
+
+    node found{};
+    std::uint32_t tag{};
+    for (std::int32_t off{next_tag(aliases.off, tag)}; off >= 0;) {
+      const std::int32_t next{next_tag(off, tag)};
+      if (tag != FDT_PROP && tag != FDT_NOP)
+        break;
+
+      if (tag == FDT_PROP) {
+        const property p{prop_at(off)};
+        if (p.valid() && std::string_view{p.name} == alias) {
+          const char *target{p.str()};
+          if (target != nullptr && target[0] == '/')
+            found = find_node(target);
+          break;
+        }
+      }
+
+      off = next;
+    }
+
+    if (!found.valid() || slash == std::string_view::npos)
+      return found;
+
+    n = found;
+    path = path.substr(slash);
+  }
+
+  while (!path.empty()) {
+    // Skip separators.
+    while (!path.empty() && path.front() == '/')
+      path.remove_prefix(1);
+
+    if (path.empty())
+      break;
+
+    const std::string_view comp{path.substr(0, path.find('/'))};
+    path.remove_prefix(comp.size());
+
+    node c{first_child(n)};
+    while (c.valid() && !name_matches(c, comp))
+      c = next_sibling(c);
+
+    if (!c.valid())
+      return {};
+
+    n = c;
+  }
+
+  return n;
+}
+
+node find_phandle(std::uint32_t phandle) noexcept {
+  if (phandle == 0 || phandle == 0xffffffff)
+    return {};
+
+  for (node n{root_node}; n.valid(); n = next_node(n)) {
+    property p{get_property(n, "phandle")};
+    if (!p.valid())
+      p = get_property(n, "linux,phandle");
+
+    if (p.nr_cells() == 1 && p.u32(0) == phandle)
+      return n;
+  }
+
+  return {};
+}
+
+node find_compatible(const char *compat, node from) noexcept {
+  for (node n{next_node(from)}; n.valid(); n = next_node(n))
+    if (is_compatible(n, compat))
+      return n;
+
+  return {};
+}
+
+property get_property(node n, const char *prop) noexcept {
+  if (!n.valid())
+    return {};
+
+  const std::string_view want{prop};
+  std::uint32_t tag{};
+
+  for (std::int32_t off{next_tag(n.off, tag)}; off >= 0;) {
+    const std::int32_t next{next_tag(off, tag)};
+    if (tag != FDT_PROP && tag != FDT_NOP)
+      break;
+
+    if (tag == FDT_PROP) {
+      const property p{prop_at(off)};
+      if (p.valid() && std::string_view{p.name} == want)
+        return p;
+    }
+
+    off = next;
+  }
+
+  return {};
+}
+
+bool is_compatible(node n, const char *compat) noexcept {
+  const property p{get_property(n, "compatible")};
+  if (p.str() == nullptr)
+    return false;
+
+  // NUL-separated string list.
+  const std::string_view want{compat};
+  const char *s{reinterpret_cast<const char *>(p.data)};
+  const char *end{s + p.len};
+
+  while (s < end) {
+    const std::string_view cur{s};
+    if (cur == want)
+      return true;
+
+    s += cur.size() + 1;
+  }
+
+  return false;
+}
+
+/* Standard properties. */
+
+unsigned address_cells(node n) noexcept {
+  const property p{get_property(n, "#address-cells")};
+  return p.nr_cells() == 1 ? p.u32(0) : 2;
+}
+
+unsigned size_cells(node n) noexcept {
+  const property p{get_property(n, "#size-cells")};
+  return p.nr_cells() == 1 ? p.u32(0) : 1;
+}
+
+bool reg(node n, std::size_t idx, xino::mm::phys_addr &base,
+         std::size_t &size) noexcept {
+  const node p{parent(n)};
+  if (!p.valid())
+    return false;
+
+  const unsigned ac{address_cells(p)};
+  const unsigned sc{size_cells(p)};
+  if (ac == 0 || ac > 2 || sc > 2)
+    return false;
+
+  const property r{get_property(n, "reg")};
+  const std::size_t pos{idx * (ac + sc)};
+  if (pos + ac + sc > r.nr_cells())
+    return false;
+
+  base = xino::mm::phys_addr{r.cells(pos, ac)};
+  size = static_cast<std::size_t>(r.cells(pos + ac, sc));
+
+  return true;
+}
+
+bool interrupt(node n, std::size_t idx, irq_spec &spec) noexcept {
+  const property irqs{get_property(n, "interrupts")};
+  if (!irqs.valid())
+    return false;
+
+  // Find `interrupt-parent` on the node or its ancestors.
+  node ctrl{};
+  for (node c{n}; c.valid() && !ctrl.valid(); c = parent(c)) {
+    const property ip{get_property(c, "interrupt-parent")};
+    if (ip.nr_cells() == 1)
+      ctrl = find_phandle(ip.u32(0));
+  }
+
+  if (!ctrl.valid())
+    return false;
+
+  const property ic{get_property(ctrl, "#interrupt-cells")};
+  if (ic.nr_cells() != 1 || ic.u32(0) == 0 || ic.u32(0) > irq_spec::max_cells)
+    return false;
+
+  const unsigned nc{ic.u32(0)};
+  const std::size_t pos{idx * nc};
+  if (pos + nc > irqs.nr_cells())
+    return false;
+
+  spec.controller = ctrl;
+  spec.nr_cells = nc;
+  for (unsigned i{0}; i < nc; i++)
+    spec.cells[i] = irqs.u32(pos + i);
+
+  return true;
+}
+
+/* Boot queries. */
+
+node cpus_node() noexcept { return cpus; }
+
+node chosen_node() noexcept { return chosen; }
+
+unsigned nr_cpus() noexcept { return ncpu; }
+
+std::size_t nr_memory_banks() noexcept { return nbanks; }
+
+bool memory_bank(std::size_t idx, xino::mm::phys_addr &base,
+                 std::size_t &size) noexcept {
+  if (idx >= nbanks)
+    return false;
+
+  base = banks[idx].base;
+  size = banks[idx].size;
+
+  return true;
+}
+
+node stdout_node() noexcept {
+  const char *path{get_property(chosen, "stdout-path").str()};
+  if (path == nullptr)
+    return {};
+
+  // Strip the options, e.g. "serial2:1500000n8".
+  const std::string_view p{path};
+  return find_node(p.substr(0, p.find(':')));
+}
+
+bool mem_rsv(std::size_t idx, xino::mm::phys_addr &base,
+             std::size_t &size) noexcept {
+  if (dtb == nullptr)
+    return false;
+
+  // Entries are pairs of 64-bit big-endian values, ending with a zero entry.
+  const std::size_t off{rsvmap_off + idx * 16};
+  if (off + 16 > dtb_size)
+    return false;
+
+  const std::uint8_t *e{dtb + off};
+  base = xino::mm::phys_addr{(std::uint64_t{be32(e)} << 32) | be32(e + 4)};
+  size = static_cast<std::size_t>((std::uint64_t{be32(e + 8)} << 32) |
+                                  be32(e + 12));
+
+  return base != xino::mm::phys_addr{} || size != 0;
+}
+
+xino::error_t memblock_setup() noexcept {
+  namespace memblock = xino::mm::memblock;
+
+  if (dtb == nullptr)
+    return xino::error_nr::invalid;
+
+  for (std::size_t i{0}; i < nbanks; i++) {
+    const xino::error_t ret{memblock::add_memory(banks[i].base, banks[i].size)};
+    if (ret != xino::error_nr::ok)
+      return ret;
+  }
+
+  // Keep the DTB, everything downstream reads it in place.
+  xino::error_t ret{memblock::reserve(dtb_pa, dtb_size)};
+  if (ret != xino::error_nr::ok)
+    return ret;
+
+  xino::mm::phys_addr base{};
+  std::size_t size{};
+
+  for (std::size_t i{0}; mem_rsv(i, base, size); i++) {
+    ret = memblock::reserve(base, size);
+    if (ret != xino::error_nr::ok)
+      return ret;
+  }
+
+  // Static `/reserved-memory` regions (dynamic ones have no `reg`).
+  for_each_child(find_node("/reserved-memory"), [&](node n) {
+    for (std::size_t i{0}; ret == xino::error_nr::ok && reg(n, i, base, size);
+         i++)
+      ret = memblock::reserve(base, size);
+  });
+
+  return ret;
+}
+
+} // namespace xino::fdt
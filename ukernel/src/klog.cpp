@@ -0,0 +1,342 @@
+#include <cache.hpp>
+#include <cpu.hpp>
+#include <cpumask.hpp>
+#include <cstddef> // for offsetof
+#include <cstdio>
+#include <klog.hpp>
+#include <new>
+#include <percpu.hpp>
+#include <plat_gic.hpp>
+#include <plat_uart.hpp>
+#include <ring.hpp>
+#include <smp.hpp>
+#include <sync.hpp>
+
+namespace xino::klog {
+
+/** @brief SGI that asks a CPU to flush(); SGI 0 is for function calls. */
+static constexpr unsigned sgi_klog_flush{1};
+
+/** @brief Records of one CPU; layout described by `xino_klog`. */
+struct alignas(UKERNEL_CACHE_LINE) log_ring {
+  // Producer: the owner CPU.
+  xino::sync::overwrite_ring<record, nr_records> records;
+
+  // Consumer (under `consumer_lock`): next position to flush.
+  alignas(UKERNEL_CACHE_LINE) std::uint64_t tail;
+  std::uint64_t dropped;
+  record staged;       // Merge stage of flush() and dump().
+  record crash_staged; // Merge stage of crash_dump(), which takes no lock.
+};
+
+/** @brief Ring of the boot CPU until klog_init() allocates them all. */
+__cacheline_aligned constinit static log_ring boot_ring{};
+
+/** @brief Rings of CPUs `[0, nr_rings)`; set by klog_init(). */
+__read_mostly constinit static log_ring *rings{&boot_ring};
+__read_mostly constinit static unsigned nr_rings{1};
+
+__cacheline_aligned constinit static xino::sync::spin_lock consumer_lock{
+    "klog"};
+
+/** @brief The flush SGI is installed. */
+__read_mostly constinit static bool sgi_ready{};
+
+/** @brief An SGI is on its way; later records ride on it. */
+__cacheline_aligned constinit static bool flush_pending{};
+
+static const char *level_name(std::uint8_t lvl) noexcept {
+  switch (static_cast<level>(lvl)) {
+  case level::emerg:
+    return "EMERG";
+  case level::err:
+    return "ERR";
+  case level::warn:
+    return "WARN";
+  case level::info:
+    return "INFO";
+  case level::debug:
+    return "DEBUG";
+  }
+
+  return "?";
+}
+
+/** @brief Load `rings` into @p rs and return their number (any context). */
+static unsigned load_rings(log_ring *&rs) noexcept {
+  // klog_init() sets `nr_rings` last; a CPU that sees it sees the array.
+  const unsigned n{__atomic_load_n(&nr_rings, __ATOMIC_ACQUIRE)};
+  rs = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+  return n;
+}
+
+/** @brief Write @p rec to the console as one line. */
+static void emit(const record &rec) noexcept {
+  const std::uint64_t freq{xino::cpu::cntfrq_el0::read()};
+  const std::uint64_t us{(rec.ts % freq) * 1000000 / freq};
+
+  char line[sizeof(rec.text) + 48];
+  int n{std::snprintf(line, sizeof(line), "[%5lu.%06lu] cpu%u %s: %.*s\n",
+                      (unsigned long)(rec.ts / freq), (unsigned long)us,
+                      (unsigned)rec.cpu, level_name(rec.level), (int)rec.len,
+                      rec.text)};
+  if (n < 0)
+    return;
+
+  if (static_cast<std::size_t>(n) >= sizeof(line))
+    n = sizeof(line) - 1;
+  xino::plat::uart::console_write(line, static_cast<std::size_t>(n));
+}
+
+/**
+ * @brief Print the records of the @p n rings @p rs from @p pos[cpu] up to
+ *        each ring's head, oldest first across CPUs, and advance @p pos.
+ *
+ * A position that was overwritten skips to the oldest record still in the
+ * ring; @p dropped (if any) counts the records skipped. A record that is not
+ * committed yet stops its ring. Records are copied to @p stage of each ring.
+ */
+static void merge(log_ring *rs, unsigned n, std::uint64_t *pos,
+                  std::uint64_t *dropped, record log_ring::*stage) noexcept {
+  bool ready[xino::smp::nr_cpus_max]{};
+
+  const auto load = [&](unsigned cpu) {
+    log_ring &r{rs[cpu]};
+
+    for (;;) {
+      const std::uint64_t head{r.records.load_head()};
+      if (head - pos[cpu] > nr_records) {
+        if (dropped != nullptr)
+          dropped[cpu] += head - nr_records - pos[cpu];
+        pos[cpu] = head - nr_records;
+      }
+
+      if (pos[cpu] == head || r.records.read(pos[cpu], r.*stage)) {
+        ready[cpu] = pos[cpu] != head;
+        return;
+      }
+
+      // Not committed yet, unless the producer lapped us while copying.
+      if (r.records.load_head() - pos[cpu] <= nr_records) {
+        ready[cpu] = false;
+        return;
+      }
+    }
+  };
+
+  for (unsigned cpu{0}; cpu < n; cpu++)
+    load(cpu);
+
+  for (;;) {
+    unsigned first{n};
+    for (unsigned cpu{0}; cpu < n; cpu++)
+      if (ready[cpu] &&
+          (first == n || (rs[cpu].*stage).ts < (rs[first].*stage).ts))
+        first = cpu;
+
+    if (first == n)
+      return;
+
+    emit(rs[first].*stage);
+    pos[first]++;
+    load(first);
+  }
+}
+
+/**
+ * @brief Whether flush() can take a record: a ring's next record is
+ *        committed, or the ring was lapped.
+ *
+ * A ring whose next record is still being written is not counted; its
+ * producer kicks a flush once it commits.
+ */
+static bool flushable() noexcept {
+  log_ring *rs;
+  const unsigned n{load_rings(rs)};
+
+  for (unsigned cpu{0}; cpu < n; cpu++) {
+    const log_ring &r{rs[cpu]};
+    const std::uint64_t tail{__atomic_load_n(&r.tail, __ATOMIC_RELAXED)};
+    const std::uint64_t head{r.records.load_head()};
+
+    if (head != tail &&
+        (head - tail > nr_records || r.records.committed(tail)))
+      return true;
+  }
+
+  return false;
+}
+
+void flush() noexcept {
+  // Re-checked after every pass: records committed while the lock was held
+  // are taken too, as a flush that lost try_lock() relies on it.
+  while (flushable()) {
+    const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+    if (!consumer_lock.try_lock()) {
+      // The holder re-checks the rings after unlocking.
+      xino::sync::irq_restore(f);
+      return;
+    }
+
+    log_ring *rs;
+    const unsigned n{load_rings(rs)};
+
+    std::uint64_t pos[xino::smp::nr_cpus_max];
+    std::uint64_t dropped[xino::smp::nr_cpus_max]{};
+    for (unsigned cpu{0}; cpu < n; cpu++)
+      pos[cpu] = rs[cpu].tail;
+
+    merge(rs, n, pos, dropped, &log_ring::staged);
+
+    for (unsigned cpu{0}; cpu < n; cpu++) {
+      __atomic_store_n(&rs[cpu].tail, pos[cpu], __ATOMIC_RELAXED);
+      rs[cpu].dropped += dropped[cpu];
+      if (dropped[cpu] != 0) {
+        char line[64];
+        const int k{std::snprintf(line, sizeof(line),
+                                  "klog: cpu%u dropped %lu records\n", cpu,
+                                  (unsigned long)dropped[cpu])};
+        if (k > 0)
+          xino::plat::uart::console_write(line, static_cast<std::size_t>(k));
+      }
+    }
+
+    consumer_lock.unlock();
+    xino::sync::irq_restore(f);
+
+    // Order the unlock before the re-check, against a CPU that commits and
+    // then fails try_lock().
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  }
+}
+
+static void flush_ipi(unsigned, void *) {
+  // Clear first: records committed from now on send a new SGI.
+  __atomic_store_n(&flush_pending, false, __ATOMIC_RELEASE);
+  flush();
+}
+
+/** @brief Have an online CPU, preferably another one, run flush(). */
+static void kick() noexcept {
+  if (!__atomic_load_n(&sgi_ready, __ATOMIC_ACQUIRE) ||
+      __atomic_exchange_n(&flush_pending, true, __ATOMIC_ACQ_REL))
+    return;
+
+  const unsigned self{xino::percpu::this_cpu_id()};
+  unsigned target{self};
+  xino::smp::cpu_online_mask().for_each([&](unsigned cpu) {
+    if (cpu != self)
+      target = cpu;
+  });
+
+  xino::smp::cpumask m{};
+  m.set(target);
+  xino::plat::gic::send_sgi(sgi_klog_flush, m);
+}
+
+void vlog(level lvl, const char *fmt, std::va_list ap) noexcept {
+  const unsigned cpu{xino::percpu::this_cpu_id()};
+
+  log_ring *rs;
+  // A CPU without a ring (klog_init() failed to allocate them) drops it.
+  if (cpu >= load_rings(rs))
+    return;
+
+  std::uint64_t pos;
+  record &rec{rs[cpu].records.reserve(pos)};
+
+  rec.ts = xino::cpu::cntvct_el0::read();
+  rec.cpu = static_cast<std::uint16_t>(cpu);
+  rec.level = static_cast<std::uint8_t>(lvl);
+
+  int n{std::vsnprintf(rec.text, sizeof(rec.text), fmt, ap)};
+  if (n < 0)
+    n = 0;
+  else if (static_cast<std::size_t>(n) >= sizeof(rec.text))
+    n = sizeof(rec.text) - 1;
+  if (n > 0 && rec.text[n - 1] == '\n')
+    n--;
+  rec.len = static_cast<std::uint8_t>(n);
+
+  rs[cpu].records.commit(rec, pos);
+
+  kick();
+}
+
+void log(level lvl, const char *fmt, ...) noexcept {
+  std::va_list ap;
+  va_start(ap, fmt);
+  vlog(lvl, fmt, ap);
+  va_end(ap);
+}
+
+void dump() noexcept {
+  std::uint64_t pos[xino::smp::nr_cpus_max];
+
+  const xino::sync::irq_flags_t f{consumer_lock.lock_irqsave()};
+  log_ring *rs;
+  const unsigned n{load_rings(rs)};
+  for (unsigned cpu{0}; cpu < n; cpu++)
+    pos[cpu] = rs[cpu].records.first(rs[cpu].records.load_head());
+
+  merge(rs, n, pos, nullptr, &log_ring::staged);
+  consumer_lock.unlock_irqrestore(f);
+}
+
+void crash_dump() noexcept {
+  std::uint64_t pos[xino::smp::nr_cpus_max];
+
+  log_ring *rs;
+  const unsigned n{load_rings(rs)};
+  for (unsigned cpu{0}; cpu < n; cpu++)
+    pos[cpu] = __atomic_load_n(&rs[cpu].tail, __ATOMIC_RELAXED);
+
+  // Not `staged`: the consumer may hold it.
+  merge(rs, n, pos, nullptr, &log_ring::crash_staged);
+}
+
+void klog_init() noexcept {
+  const unsigned n{xino::percpu::nr_cpu_ids()};
+  log_ring *const rs{new (std::nothrow) log_ring[n]{}};
+
+  const xino::sync::irq_flags_t f{consumer_lock.lock_irqsave()};
+  if (rs != nullptr) {
+    // Secondaries are not up yet: only this CPU has logged, in `boot_ring`.
+    rs[0] = boot_ring;
+    __atomic_store_n(&rings, rs, __ATOMIC_RELEASE);
+    __atomic_store_n(&nr_rings, n, __ATOMIC_RELEASE);
+  }
+  consumer_lock.unlock_irqrestore(f);
+
+  xino_klog.freq = xino::cpu::cntfrq_el0::read();
+  xino_klog.nr_cpus = nr_rings;
+  xino_klog.rings = rings;
+
+  if (rs == nullptr)
+    log(level::err, "klog: no memory for %u rings, only cpu0 logs\n", n);
+
+  xino::plat::gic::set_handler(sgi_klog_flush, flush_ipi, nullptr);
+  __atomic_store_n(&sgi_ready, true, __ATOMIC_RELEASE);
+
+  kick();
+}
+
+void klog_cpu_online() noexcept { xino::plat::gic::enable(sgi_klog_flush); }
+
+} // namespace xino::klog
+
+extern "C" {
+[[gnu::used]] constinit xino_klog_desc xino_klog{
+    .magic = 0x474f4c4b4f4e4958, // "XINOKLOG", little-endian.
+    .version = 1,
+    .nr_cpus = 1,
+    .nr_records = xino::klog::nr_records,
+    .record_size = sizeof(xino::klog::record),
+    .ring_size = sizeof(xino::klog::log_ring),
+    .records_offset =
+        offsetof(xino::klog::log_ring, records) +
+        decltype(xino::klog::log_ring::records)::slots_offset(),
+    .freq = 0,
+    .rings = &xino::klog::boot_ring,
+};
+}
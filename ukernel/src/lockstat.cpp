@@ -0,0 +1,157 @@
+#include <config.h>
+
+#ifdef UKERNEL_LOCKSTAT
+
+#include <cache.hpp>
+#include <cstdio>
+#include <cstring>
+#include <lockstat.hpp>
+#include <sync.hpp>
+
+namespace xino::sync {
+
+__cacheline_aligned constinit static lock_stats *registered_locks{};
+
+// Protects `registered_locks`. A bare flag: a `spin_lock` would register
+// itself.
+__cacheline_aligned constinit static bool registry_busy{};
+
+[[nodiscard]] static irq_flags_t registry_lock() noexcept {
+  const irq_flags_t f{irq_save()};
+
+  while (__atomic_exchange_n(&registry_busy, true, __ATOMIC_ACQUIRE)) {
+    /* Spin. */
+  }
+
+  return f;
+}
+
+static void registry_unlock(irq_flags_t f) noexcept {
+  __atomic_store_n(&registry_busy, false, __ATOMIC_RELEASE);
+  irq_restore(f);
+}
+
+void lockstat_register(lock_stats *s) noexcept {
+  // Called with the lock held, so only once per lock.
+  const irq_flags_t f{registry_lock()};
+  s->registered = true;
+  s->next = registered_locks;
+  registered_locks = s;
+  registry_unlock(f);
+}
+
+void lockstat_unregister(lock_stats *s) noexcept {
+  const irq_flags_t f{registry_lock()};
+  if (s->registered) {
+    lock_stats **p{&registered_locks};
+    while (*p != s)
+      p = &(*p)->next;
+
+    *p = s->next;
+    s->registered = false;
+  }
+  registry_unlock(f);
+}
+
+/** @brief Statistics of all locks with the same name. */
+struct lock_class {
+  const char *name;
+  const void *addr; // For unnamed locks.
+  unsigned nr_locks;
+  std::uint64_t acquisitions;
+  std::uint64_t contended;
+  std::uint64_t spin_total;
+  std::uint64_t spin_max;
+  std::uint64_t hold_total;
+  std::uint64_t hold_max;
+};
+
+static constexpr unsigned max_classes{64};
+
+static bool same_class(const lock_class &c, const lock_stats *s) {
+  if (c.name == nullptr || s->name == nullptr)
+    return c.addr == s;
+
+  return strcmp(c.name, s->name) == 0;
+}
+
+static std::uint64_t ticks_to_ns(std::uint64_t ticks, std::uint64_t freq) {
+  return ticks * 1000000000 / freq;
+}
+
+void lockstat_dump() noexcept {
+  lock_class classes[max_classes];
+  unsigned nr{0};
+  bool truncated{false};
+
+  // Snapshot under the registry lock: a lock may be destroyed after it.
+  const irq_flags_t f{registry_lock()};
+  for (const lock_stats *s{registered_locks}; s != nullptr; s = s->next) {
+    unsigned i{0};
+    while (i < nr && !same_class(classes[i], s))
+      i++;
+
+    if (i == nr) {
+      if (nr == max_classes) {
+        truncated = true;
+        continue;
+      }
+
+      classes[nr++] = {s->name, s, 0, 0, 0, 0, 0, 0, 0};
+    }
+
+    // Racy snapshot of the counters; good enough for statistics.
+    lock_class &c{classes[i]};
+    c.nr_locks++;
+    c.acquisitions += s->acquisitions;
+    c.contended += s->contended;
+    c.spin_total += s->spin_total;
+    c.hold_total += s->hold_total;
+    if (s->spin_max > c.spin_max)
+      c.spin_max = s->spin_max;
+    if (s->hold_max > c.hold_max)
+      c.hold_max = s->hold_max;
+  }
+  registry_unlock(f);
+
+  // Most contended first (insertion sort; few classes).
+  for (unsigned i{1}; i < nr; i++) {
+    const lock_class c{classes[i]};
+    unsigned j{i};
+    for (; j > 0 && classes[j - 1].contended < c.contended; j--)
+      classes[j] = classes[j - 1];
+    classes[j] = c;
+  }
+
+  const std::uint64_t freq{xino::cpu::cntfrq_el0::read()};
+
+  printf("lockstat: class locks acquisitions contended "
+         "spin-avg/max(ns) hold-avg/max(ns)\n");
+  for (unsigned i{0}; i < nr; i++) {
+    const lock_class &c{classes[i]};
+    const std::uint64_t spin_avg{c.contended ? c.spin_total / c.contended
+                                             : 0};
+    const std::uint64_t hold_avg{c.acquisitions
+                                     ? c.hold_total / c.acquisitions
+                                     : 0};
+
+    if (c.name != nullptr)
+      printf("  %s", c.name);
+    else
+      printf("  spin_lock@%p", c.addr);
+
+    printf(" %u %lu %lu %lu/%lu %lu/%lu\n", c.nr_locks,
+           (unsigned long)c.acquisitions, (unsigned long)c.contended,
+           (unsigned long)ticks_to_ns(spin_avg, freq),
+           (unsigned long)ticks_to_ns(c.spin_max, freq),
+           (unsigned long)ticks_to_ns(hold_avg, freq),
+           (unsigned long)ticks_to_ns(c.hold_max, freq));
+  }
+
+  if (truncated)
+    printf("  (more than %u classes; the rest are not shown)\n", max_classes);
+}
+
+} // namespace xino::sync
+
+#endif // UKERNEL_LOCKSTAT
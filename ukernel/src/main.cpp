@@ -1,12 +1,44 @@
-
+#include <config.h>
 #include <cstdio>
 
+#ifdef UKERNEL_BENCH
+#include <bench.hpp>
+#endif
+
+#ifdef UKERNEL_LOCKSTAT
+#include <lockstat.hpp>
+#endif
+
+#ifdef UKERNEL_TRACE
+#include <trace.hpp>
+#endif
+
+#ifdef UKERNEL_KLOG_DUMP
+#include <klog.hpp>
+#endif
+
 namespace xino::runtime {
 
 void main() {
   unsigned long x;
   __asm__ volatile("mrs %0, CurrentEL" : "=r"(x));
   fprintf(stderr, "CurrentEL: %lu\n", x);
+
+#ifdef UKERNEL_BENCH
+  xino::bench::run_all();
+#endif
+
+#ifdef UKERNEL_LOCKSTAT
+  xino::sync::lockstat_dump();
+#endif
+
+#ifdef UKERNEL_TRACE
+  xino::trace::dump();
+#endif
+
+#ifdef UKERNEL_KLOG_DUMP
+  xino::klog::dump();
+#endif
 }
 
 } // namespace xino::runtime
@@ -0,0 +1,190 @@
+#include <allocator.hpp> // buddy, size_to_order, size_to_order_up
+#include <cache.hpp>
+#include <config.h>      // UKERNEL_DEVMAP_SLOT_SIZE
+#include <mm_ioremap.hpp>
+#include <mm_paging.hpp>
+#include <mm_va_layout.hpp>
+#include <runtime.hpp> // use_mapping
+#include <sync.hpp>
+
+namespace xino::mm {
+
+using pv_t = xino::mm::phys_addr::value_type;
+
+/** @brief Buddy allocator managing VA ranges of the devmap window. */
+using devmap_allocator_t = xino::allocator::buddy<
+    xino::allocator::size_to_order(UKERNEL_DEVMAP_SLOT_SIZE),
+    xino::mm::virt_addr>;
+
+/**
+ * @brief A live device mapping.
+ *
+ * `[va, va + size)` maps `[pa, pa + size)`; both are granule aligned. The VA
+ * range is part of a devmap block `[blk_va, blk_va + 2^order pages)`.
+ */
+struct iomap {
+  xino::mm::phys_addr pa;
+  xino::mm::virt_addr va;
+  std::size_t size;
+  xino::mm::virt_addr blk_va;
+  unsigned order;
+  unsigned refs; // Zero means the slot is free.
+  xino::mm::prot p;
+};
+
+// Maximum number of distinct live mappings.
+static constexpr std::size_t max_iomaps{64};
+
+static constinit devmap_allocator_t devmap_allocator{};
+static constinit iomap iomaps[max_iomaps]{};
+__cacheline_aligned static constinit xino::sync::spin_lock devmap_lock{
+    "devmap"};
+
+// Find a live mapping covering `[pa, pa + size)` with protections @p p.
+[[nodiscard]] static iomap *find_covering(xino::mm::phys_addr pa,
+                                          std::size_t size,
+                                          xino::mm::prot p) noexcept {
+  for (iomap &m : iomaps) {
+    if (m.refs != 0 && m.p == p && m.pa <= pa && pa + size <= m.pa + m.size)
+      return &m;
+  }
+
+  return nullptr;
+}
+
+// Find the live mapping containing @p va.
+[[nodiscard]] static iomap *find_by_va(xino::mm::virt_addr va) noexcept {
+  for (iomap &m : iomaps) {
+    if (m.refs != 0 && m.va <= va && va < m.va + m.size)
+      return &m;
+  }
+
+  return nullptr;
+}
+
+[[nodiscard]] static iomap *find_free_slot() noexcept {
+  for (iomap &m : iomaps) {
+    if (m.refs == 0)
+      return &m;
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief Create a new mapping for the granule-aligned `[pa, pa + size)`.
+ *
+ * If @p size is at least a block, the VA block is allocated to cover
+ * `[pa.align_down(block), pa + size)` so that the VA is congruent to @p pa
+ * modulo the block size, and `map_range()` can use block descriptors.
+ */
+[[nodiscard]] static iomap *map_new(xino::mm::phys_addr pa, std::size_t size,
+                                    xino::mm::prot p) noexcept {
+  iomap *m{find_free_slot()};
+  if (m == nullptr)
+    return nullptr;
+
+  const std::size_t bs{xino::mm::paging::kernel_block_size()};
+  // Offset of `pa` within the VA block.
+  const std::size_t off{
+      size >= bs ? static_cast<std::size_t>(static_cast<pv_t>(pa) & (bs - 1))
+                 : 0};
+
+  const unsigned order{xino::allocator::size_to_order_up(off + size)};
+
+  const xino::mm::virt_addr blk_va{
+      devmap_allocator.alloc_pages(xino::nothrow, order)};
+  if (blk_va == xino::mm::virt_addr{})
+    return nullptr;
+
+  const xino::mm::virt_addr va{blk_va + off};
+
+  xino::error_t ret;
+  {
+    xino::sync::irq_flags_t f{
+        xino::mm::paging::kernel_page_table_lock.lock_irqsave()};
+    ret = xino::mm::paging::kernel_page_table.map_range({va, 0}, pa, size, p);
+    if (ret != xino::error_nr::ok) {
+      // Drop the mapped prefix, if any.
+      (void)xino::mm::paging::kernel_page_table.unmap_range({va, 0}, size);
+    }
+    xino::mm::paging::kernel_page_table_lock.unlock_irqrestore(f);
+  }
+
+  if (ret != xino::error_nr::ok) {
+    devmap_allocator.free_pages(blk_va, order);
+    return nullptr;
+  }
+
+  *m = iomap{pa, va, size, blk_va, order, 1, p};
+
+  return m;
+}
+
+static void unmap_one(iomap &m) noexcept {
+  {
+    xino::sync::irq_flags_t f{
+        xino::mm::paging::kernel_page_table_lock.lock_irqsave()};
+    (void)xino::mm::paging::kernel_page_table.unmap_range({m.va, 0}, m.size);
+    xino::mm::paging::kernel_page_table_lock.unlock_irqrestore(f);
+  }
+
+  devmap_allocator.free_pages(m.blk_va, m.order);
+  m = iomap{};
+}
+
+xino::error_t ioremap_init() noexcept {
+  return devmap_allocator.init(xino::mm::va_layout::devmap_va,
+                               xino::mm::va_layout::devmap_slot_size);
+}
+
+xino::mm::virt_addr ioremap(xino::mm::phys_addr pa, std::size_t size,
+                            xino::mm::prot p) noexcept {
+  if (size == 0 || pa + size < pa)
+    return xino::mm::virt_addr{};
+
+  if (!xino::runtime::use_mapping) [[unlikely]] {
+    // MMU is off, identity mapping.
+    return xino::mm::virt_addr{static_cast<pv_t>(pa)};
+  }
+
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+  // Granule aligned `[start, end)` covering `[pa, pa + size)`.
+  const xino::mm::phys_addr start{pa.align_down(gs)};
+  const xino::mm::phys_addr end{(pa + size).align_up(gs)};
+  const std::size_t span{static_cast<std::size_t>(end - start)};
+
+  xino::mm::virt_addr va{};
+
+  xino::sync::irq_flags_t f{devmap_lock.lock_irqsave()};
+
+  iomap *m{find_covering(start, span, p)};
+  if (m != nullptr) {
+    // Share the existing mapping.
+    m->refs++;
+  } else {
+    m = map_new(start, span, p);
+  }
+
+  if (m != nullptr)
+    va = m->va + static_cast<std::size_t>(pa - m->pa);
+
+  devmap_lock.unlock_irqrestore(f);
+
+  return va;
+}
+
+void iounmap(xino::mm::virt_addr va) noexcept {
+  if (!xino::runtime::use_mapping || !xino::mm::va_layout::is_devmap(va))
+    return;
+
+  xino::sync::irq_flags_t f{devmap_lock.lock_irqsave()};
+
+  iomap *m{find_by_va(va)};
+  if (m != nullptr && --m->refs == 0)
+    unmap_one(*m);
+
+  devmap_lock.unlock_irqrestore(f);
+}
+
+} // namespace xino::mm
@@ -0,0 +1,185 @@
+#include <cpu.hpp>
+#include <mm_memblock.hpp>
+#include <mm_va_layout.hpp>
+
+namespace xino::mm::memblock {
+
+/* region_map. */
+
+std::size_t region_map::first_ending_after(
+    xino::mm::phys_addr pa) const noexcept {
+  // Regions are sorted and disjoint, so `end()` is increasing.
+  std::size_t lo{0};
+  std::size_t hi{cnt};
+
+  while (lo < hi) {
+    const std::size_t mid{lo + (hi - lo) / 2};
+    if (regions[mid].end() > pa)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
+xino::error_t region_map::add(xino::mm::phys_addr base,
+                              std::size_t size) noexcept {
+  if (size == 0)
+    return xino::error_nr::ok;
+
+  if (base + size < base)
+    return xino::error_nr::overflow;
+
+  xino::mm::phys_addr end{base + size};
+
+  // First region ending at or after `base` (adjacent regions are merged).
+  std::size_t i{base == xino::mm::phys_addr{} ? 0
+                                               : first_ending_after(base - 1)};
+
+  // Merge all regions starting at or before `end`.
+  std::size_t j{i};
+  for (; j < cnt && regions[j].base <= end; j++) {
+    if (regions[j].base < base)
+      base = regions[j].base;
+    if (regions[j].end() > end)
+      end = regions[j].end();
+  }
+
+  if (i == j) {
+    // No merge, insert a new region at `i`.
+    if (cnt == max_regions)
+      return xino::error_nr::nomem;
+
+    for (std::size_t k{cnt}; k > i; k--)
+      regions[k] = regions[k - 1];
+    cnt++;
+  } else {
+    // Replace `[i, j)` by a single region at `i`.
+    const std::size_t gone{j - i - 1};
+
+    for (std::size_t k{j}; k < cnt; k++)
+      regions[k - gone] = regions[k];
+    cnt -= gone;
+  }
+
+  regions[i] = region{base, static_cast<std::size_t>(end - base)};
+
+  return xino::error_nr::ok;
+}
+
+xino::error_t region_map::remove(xino::mm::phys_addr base,
+                                 std::size_t size) noexcept {
+  if (size == 0)
+    return xino::error_nr::ok;
+
+  if (base + size < base)
+    return xino::error_nr::overflow;
+
+  const xino::mm::phys_addr end{base + size};
+
+  std::size_t i{first_ending_after(base)};
+
+  while (i < cnt && regions[i].base < end) {
+    const region r{regions[i]};
+
+    if (r.base < base && r.end() > end) {
+      // Split in two.
+      if (cnt == max_regions)
+        return xino::error_nr::nomem;
+
+      for (std::size_t k{cnt}; k > i + 1; k--)
+        regions[k] = regions[k - 1];
+      cnt++;
+
+      regions[i] = region{r.base, static_cast<std::size_t>(base - r.base)};
+      regions[i + 1] = region{end, static_cast<std::size_t>(r.end() - end)};
+      break;
+    }
+
+    if (r.base < base) {
+      // Trim the tail.
+      regions[i].size = static_cast<std::size_t>(base - r.base);
+      i++;
+      continue;
+    }
+
+    if (r.end() > end) {
+      // Trim the head.
+      regions[i] = region{end, static_cast<std::size_t>(r.end() - end)};
+      break;
+    }
+
+    // Fully covered, erase.
+    for (std::size_t k{i + 1}; k < cnt; k++)
+      regions[k - 1] = regions[k];
+    cnt--;
+  }
+
+  return xino::error_nr::ok;
+}
+
+bool region_map::overlaps(xino::mm::phys_addr base,
+                          std::size_t size) const noexcept {
+  if (size == 0)
+    return false;
+
+  const std::size_t i{first_ending_after(base)};
+  return i < cnt && regions[i].base < base + size;
+}
+
+/* memblock. */
+
+constinit region_map memory{};
+constinit region_map reserved{};
+
+xino::error_t add_memory(xino::mm::phys_addr base, std::size_t size) noexcept {
+  return memory.add(base, size);
+}
+
+xino::error_t reserve(xino::mm::phys_addr base, std::size_t size) noexcept {
+  return reserved.add(base, size);
+}
+
+xino::error_t unreserve(xino::mm::phys_addr base, std::size_t size) noexcept {
+  return reserved.remove(base, size);
+}
+
+void reserve_image() noexcept {
+  if (reserve(xino::mm::va_layout::ukimage_pa_base,
+              xino::mm::va_layout::ukimage_size) != xino::error_nr::ok)
+    xino::cpu::panic();
+}
+
+xino::mm::phys_addr alloc(std::size_t size, std::size_t align,
+                          bool top_down) noexcept {
+  xino::mm::phys_addr found{};
+
+  if (size == 0)
+    return found;
+
+  // Free ranges are visited in ascending order: top-down keeps the last fit,
+  // bottom-up the first one.
+  for_each_free([&](xino::mm::phys_addr base, std::size_t len) {
+    if (len < size || (!top_down && found != xino::mm::phys_addr{}))
+      return;
+
+    const xino::mm::phys_addr end{base + len};
+    const xino::mm::phys_addr c{top_down ? (end - size).align_down(align)
+                                         : base.align_up(align)};
+
+    // Fits in `[base, end)`, and `PA{0}` is reserved for errors.
+    if (c < base || c + size > end || c == xino::mm::phys_addr{})
+      return;
+
+    found = c;
+  });
+
+  if (found != xino::mm::phys_addr{} &&
+      reserve(found, size) != xino::error_nr::ok)
+    return xino::mm::phys_addr{};
+
+  return found;
+}
+
+} // namespace xino::mm::memblock
@@ -0,0 +1,57 @@
+#include <cache.hpp>
+#include <mm_memmap.hpp>
+#include <mm_va_layout.hpp>
+
+namespace xino::mm::va_layout {
+
+// See mm_va_layout.hpp.
+__read_mostly constinit xino::mm::phys_addr memmap_pa{};
+__read_mostly constinit std::size_t memmap_start_pfn{};
+__read_mostly constinit std::size_t memmap_end_pfn{};
+
+} // namespace xino::mm::va_layout
+
+namespace xino::mm {
+
+xino::error_t memmap_init(std::size_t start_pfn, std::size_t end_pfn,
+                          xino::mm::phys_addr storage) noexcept {
+  using namespace xino::mm::va_layout;
+
+  if (end_pfn <= start_pfn || !storage.is_align(alignof(xino::mm::page)))
+    return xino::error_nr::invalid;
+
+  memmap_pa = storage;
+  memmap_start_pfn = start_pfn;
+  memmap_end_pfn = end_pfn;
+
+  xino::mm::page *pg{memmap_base()};
+  for (std::size_t i{0}; i < end_pfn - start_pfn; i++)
+    pg[i] = xino::mm::page{xino::mm::page::PG_RESERVED, {0}, 0, 0, 0,
+                           xino::mm::page::MT_UNMOVABLE};
+
+  return xino::error_nr::ok;
+}
+
+void prep_compound(xino::mm::page *head, unsigned order) noexcept {
+  const std::size_t nr{std::size_t{1} << order};
+
+  head->order = static_cast<std::uint8_t>(order);
+  if (order == 0) {
+    head->flags &= ~(xino::mm::page::PG_HEAD | xino::mm::page::PG_TAIL);
+    return;
+  }
+
+  head->flags = (head->flags & ~xino::mm::page::PG_TAIL) |
+                xino::mm::page::PG_HEAD;
+
+  for (std::size_t i{1}; i < nr; i++) {
+    xino::mm::page &tail{head[i]};
+
+    tail.flags = (tail.flags & ~xino::mm::page::PG_HEAD) |
+                 xino::mm::page::PG_TAIL;
+    tail.head_off = static_cast<std::uint32_t>(i);
+    tail.order = 0;
+  }
+}
+
+} // namespace xino::mm
@@ -1,5 +1,6 @@
 
 #include <barrier.hpp>
+#include <cache.hpp>
 #include <cpu.hpp>
 #include <mm_paging.hpp>
 
@@ -163,11 +164,18 @@ vtcr_sl0(unsigned ipa_bits) noexcept {
 [[nodiscard]] static xino::cpu::mair_el2::reg_type make_mair_el2() noexcept {
   using xino::cpu::mair_el2;
 
-  mair_el2::reg_type attr_normal = 0xffU; // Attr0.
-  mair_el2::reg_type attr_device = 0x00U; // Attr1, and others.
-
-  return static_cast<mair_el2::reg_type>((attr_normal << 0) |
-                                         (attr_device << 8));
+  // See MAIR_IDX_* in mm_paging.hpp.
+  mair_el2::reg_type attr_normal = 0xffU;       // Attr0.
+  mair_el2::reg_type attr_device = 0x00U;       // Attr1, and others.
+  mair_el2::reg_type attr_normal_nc = 0x44U;    // Attr2.
+  mair_el2::reg_type attr_normal_wt = 0xaaU;    // Attr3.
+  mair_el2::reg_type attr_device_ngnre = 0x04U; // Attr4.
+  mair_el2::reg_type attr_device_gre = 0x0cU;   // Attr5.
+
+  return static_cast<mair_el2::reg_type>(
+      (attr_normal << 0) | (attr_device << 8) | (attr_normal_nc << 16) |
+      (attr_normal_wt << 24) | (attr_device_ngnre << 32) |
+      (attr_device_gre << 40));
 }
 
 // D24.2.183 TCR_EL2, Translation Control Register, When ELIsInHost.
@@ -297,6 +305,25 @@ void install_kernel_ttbr(xino::mm::phys_addr ttbr1_pa,
   install_ttbr<xino::cpu::ttbr1_el2>(ttbr1_pa, asid);
 }
 
+/* uKernel page table. */
+
+/**
+ * @brief Stage-1 page table of the uKernel address space (TTBR1_EL2).
+ *
+ * Page-table pages are allocated from the page allocator (the boot heap until
+ * the handoff). All updates must be done holding @ref kernel_page_table_lock.
+ */
+constinit kernel_page_table_t kernel_page_table{};
+
+__cacheline_aligned constinit xino::sync::spin_lock kernel_page_table_lock{
+    "kernel_page_table"};
+
+void kernel_page_table_init() noexcept {
+  if (kernel_page_table.init(xino::allocator::page_allocator) !=
+      xino::error_nr::ok)
+    xino::cpu::panic();
+}
+
 /* Boot. */
 
 void enable_mmu() noexcept {
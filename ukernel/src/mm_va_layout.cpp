@@ -1,4 +1,5 @@
 
+#include <cache.hpp>
 #include <cpu.hpp>
 #include <mm_va_layout.hpp>
 
@@ -39,13 +40,13 @@ extern char __image_end[];
  * can lead to less predictable code generation and addressing modes across TUs.
  * A single strong definition in one TU keeps early-boot code paths stable.
  */
-constinit xino::mm::virt_addr ukimage_va_base{};
+__read_mostly constinit xino::mm::virt_addr ukimage_va_base{};
 
 /** @brief Runtime PA base of the uKernel image, see @ref ukimage_va_base.  */
-constinit xino::mm::phys_addr ukimage_pa_base{};
+__read_mostly constinit xino::mm::phys_addr ukimage_pa_base{};
 
 /** @brief Size of the uKernel image, see @ref ukimage_va_base.  */
-constinit std::size_t ukimage_size{};
+__read_mostly constinit std::size_t ukimage_size{};
 
 /**
  * @brief Initialize uKernel VA-layout runtime bases while the MMU is off.
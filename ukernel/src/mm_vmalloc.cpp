@@ -0,0 +1,242 @@
+#include <allocator.hpp> // buddy, page_allocator, size_to_order*
+#include <cache.hpp>
+#include <config.h>      // UKERNEL_VMALLOC_SLOT_SIZE
+#include <mm_paging.hpp>
+#include <mm_va_layout.hpp>
+#include <mm_vmalloc.hpp>
+#include <new>
+#include <runtime.hpp> // use_mapping
+#include <sync.hpp>
+
+namespace xino::mm {
+
+/** @brief Buddy allocator managing VA ranges of the vmalloc window. */
+using vmalloc_allocator_t = xino::allocator::buddy<
+    xino::allocator::size_to_order(UKERNEL_VMALLOC_SLOT_SIZE),
+    xino::mm::virt_addr>;
+
+/**
+ * @brief A live vmalloc allocation.
+ *
+ * If `mapped`, `[va, va + size)` is mapped in the uKernel page table and the
+ * VA range is the vmalloc block `[va, va + 2^order pages)`. Otherwise, `va` is
+ * the identity VA of a physically contiguous block of `2^order` pages.
+ */
+struct vm_area {
+  vm_area *next;
+  xino::mm::virt_addr va;
+  std::size_t size; // Granule aligned.
+  unsigned order;
+  bool mapped;
+};
+
+static constexpr xino::mm::prot prot_vmalloc{xino::mm::prot::RW |
+                                             xino::mm::prot::KERNEL |
+                                             xino::mm::prot::SHARED};
+
+static constinit vmalloc_allocator_t vmalloc_allocator{};
+// List of live allocations, protected by `vmalloc_lock`.
+static constinit vm_area *vm_areas{};
+__cacheline_aligned static constinit xino::sync::spin_lock vmalloc_lock{
+    "vmalloc"};
+
+/**
+ * @brief Back `[va, va + size)` with physical memory and map it.
+ *
+ * Tries a block for every block-aligned VA with at least a block remaining,
+ * and falls back to single pages.
+ *
+ * @note On failure, a prefix of the range may be mapped; see
+ *       @ref release_range.
+ */
+[[nodiscard]] static xino::error_t map_pages(xino::mm::virt_addr va,
+                                             std::size_t size) noexcept {
+  using namespace xino::mm::paging;
+  using xino::allocator::page_allocator;
+
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+  const std::size_t bs{kernel_block_size()};
+  const unsigned block_order{xino::allocator::size_to_order(bs)};
+
+  const xino::mm::virt_addr end{va + size};
+
+  while (va < end) {
+    xino::mm::phys_addr pa{};
+    std::size_t chunk{gs};
+    unsigned order{0};
+
+    // Try a huge block first.
+    if (va.is_align(bs) && static_cast<std::size_t>(end - va) >= bs) {
+      pa = page_allocator.alloc_pages(xino::nothrow, block_order);
+      if (pa != xino::mm::phys_addr{}) {
+        chunk = bs;
+        order = block_order;
+      }
+    }
+
+    if (pa == xino::mm::phys_addr{})
+      pa = page_allocator.alloc_pages(xino::nothrow, 0);
+
+    if (pa == xino::mm::phys_addr{})
+      return xino::error_nr::nomem;
+
+    xino::sync::irq_flags_t f{kernel_page_table_lock.lock_irqsave()};
+    const xino::error_t ret{
+        kernel_page_table.map_range({va, 0}, pa, chunk, prot_vmalloc)};
+    kernel_page_table_lock.unlock_irqrestore(f);
+
+    if (ret != xino::error_nr::ok) {
+      page_allocator.free_pages(pa, order);
+      return ret;
+    }
+
+    va += chunk;
+  }
+
+  return xino::error_nr::ok;
+}
+
+/**
+ * @brief Unmap `[va, va + size)` and free the pages backing it.
+ *
+ * The backing pages are found by walking the page table; holes (never mapped
+ * pages) are skipped.
+ */
+static void release_range(xino::mm::virt_addr va, std::size_t size) noexcept {
+  using namespace xino::mm::paging;
+  using xino::allocator::page_allocator;
+
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+  const xino::mm::virt_addr end{va + size};
+
+  xino::sync::irq_flags_t f{kernel_page_table_lock.lock_irqsave()};
+
+  while (va < end) {
+    xino::mm::phys_addr pa{};
+    std::size_t leaf{gs};
+
+    if (kernel_page_table.lookup({va, 0}, pa, leaf) == xino::error_nr::ok) {
+      // Unmap before freeing; blocks are removed as a whole.
+      (void)kernel_page_table.unmap_range({va, 0}, leaf);
+      page_allocator.free_pages(pa, xino::allocator::size_to_order(leaf));
+    } else {
+      leaf = gs;
+    }
+
+    va += leaf;
+  }
+
+  kernel_page_table_lock.unlock_irqrestore(f);
+}
+
+xino::error_t vmalloc_init() noexcept {
+  return vmalloc_allocator.init(xino::mm::va_layout::vmalloc_va,
+                                xino::mm::va_layout::vmalloc_slot_size);
+}
+
+void *vmalloc(std::size_t size) noexcept {
+  using xino::allocator::page_allocator;
+
+  const std::size_t gs{xino::mm::va_layout::granule_size()};
+
+  // Check for zero size and overflow.
+  if (size == 0 || size + gs < size)
+    return nullptr;
+
+  size = (size + gs - 1) & ~(gs - 1);
+
+  vm_area *area{new (std::nothrow) vm_area{}};
+  if (area == nullptr)
+    return nullptr;
+
+  if (!xino::runtime::use_mapping) [[unlikely]] {
+    // MMU is off, physically contiguous allocation.
+    const unsigned order{xino::allocator::size_to_order_up(size)};
+
+    const xino::mm::phys_addr pa{
+        page_allocator.alloc_pages(xino::nothrow, order)};
+    if (pa == xino::mm::phys_addr{}) {
+      delete area;
+      return nullptr;
+    }
+
+    *area = vm_area{nullptr, xino::mm::va_layout::phys_to_virt(pa, false),
+                    size, order, false};
+  } else {
+    // One extra page as the guard.
+    const unsigned order{xino::allocator::size_to_order_up(size + gs)};
+
+    xino::sync::irq_flags_t f{vmalloc_lock.lock_irqsave()};
+    const xino::mm::virt_addr va{
+        vmalloc_allocator.alloc_pages(xino::nothrow, order)};
+    vmalloc_lock.unlock_irqrestore(f);
+
+    if (va == xino::mm::virt_addr{}) {
+      delete area;
+      return nullptr;
+    }
+
+    if (map_pages(va, size) != xino::error_nr::ok) {
+      release_range(va, size);
+
+      f = vmalloc_lock.lock_irqsave();
+      vmalloc_allocator.free_pages(va, order);
+      vmalloc_lock.unlock_irqrestore(f);
+
+      delete area;
+      return nullptr;
+    }
+
+    *area = vm_area{nullptr, va, size, order, true};
+  }
+
+  xino::sync::irq_flags_t f{vmalloc_lock.lock_irqsave()};
+  area->next = vm_areas;
+  vm_areas = area;
+  vmalloc_lock.unlock_irqrestore(f);
+
+  return static_cast<void *>(area->va);
+}
+
+void vfree(void *addr) noexcept {
+  using xino::allocator::page_allocator;
+
+  if (addr == nullptr)
+    return;
+
+  const xino::mm::virt_addr va{addr};
+
+  // Find and unlink the area.
+  vm_area *area{nullptr};
+
+  xino::sync::irq_flags_t f{vmalloc_lock.lock_irqsave()};
+  for (vm_area **it{&vm_areas}; *it != nullptr; it = &(*it)->next) {
+    if ((*it)->va == va) {
+      area = *it;
+      *it = area->next;
+      break;
+    }
+  }
+  vmalloc_lock.unlock_irqrestore(f);
+
+  if (area == nullptr)
+    return;
+
+  if (area->mapped) {
+    release_range(area->va, area->size);
+
+    f = vmalloc_lock.lock_irqsave();
+    vmalloc_allocator.free_pages(area->va, area->order);
+    vmalloc_lock.unlock_irqrestore(f);
+  } else {
+    std::optional<xino::mm::phys_addr> pa{
+        xino::mm::va_layout::virt_to_phys(area->va, false)};
+
+    if (pa.has_value())
+      page_allocator.free_pages(pa.value(), area->order);
+  }
+
+  delete area;
+}
+
+} // namespace xino::mm
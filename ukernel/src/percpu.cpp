@@ -1,14 +1,21 @@
 
 
+#include <cache.hpp>
+#include <config.h> // UKERNEL_PERCPU_DYN_SIZE and UKERNEL_PAGE_SIZE
 #include <new>
 #include <percpu.hpp>
 #include <string.h>
+#include <sync.hpp>
 
 namespace xino::percpu {
 
-static xino::mm::virt_addr base; // CPU0 area base
-static std::size_t unit;         // bytes per CPU
-static std::size_t nr_cpus;
+__read_mostly static xino::mm::virt_addr base; // CPU0 area base
+__read_mostly static std::size_t unit;         // bytes per CPU
+__read_mostly static std::size_t nr_cpus;
+__read_mostly static bool bootstrapped; // TPIDR_EL2 is valid
+
+/** @brief Logical CPU index, in every CPU area (`0` in the template). */
+[[gnu::used, gnu::section(".percpu")]] constinit var<unsigned> cpu_number{0};
 
 static xino::mm::virt_addr cpu_base(unsigned cpu_idx) {
   return base + (unit * cpu_idx);
@@ -38,6 +45,11 @@ static std::size_t percpu_size() noexcept {
 void percpu_bootstrap_init() noexcept {
   xino::cpu::tpidr_el2::write(
       reinterpret_cast<xino::cpu::tpidr_el2::reg_type>(__percpu_aligned_start));
+  __atomic_store_n(&bootstrapped, true, __ATOMIC_RELEASE);
+}
+
+bool ready() noexcept {
+  return __atomic_load_n(&bootstrapped, __ATOMIC_ACQUIRE);
 }
 
 /**
@@ -57,10 +69,13 @@ void percpu_cpu_online(unsigned cpu_idx) noexcept {
       static_cast<xino::cpu::tpidr_el2::reg_type>(cpu_base(cpu_idx)));
 }
 
+static xino::error_t first_chunk_init() noexcept;
+
 xino::error_t percpu_init(unsigned ncpu) noexcept {
-  // Check if percpu area is empty.
-  // `unit` is cache-line aligned (see linker.ldspp).
-  unit = percpu_size();
+  // Static template followed by the first chunk's dynamic area. Each CPU
+  // area is on its own pages, so no cache line is shared between CPUs.
+  unit = (percpu_size() + UKERNEL_PERCPU_DYN_SIZE + UKERNEL_PAGE_SIZE - 1) &
+         ~std::size_t{UKERNEL_PAGE_SIZE - 1};
   if (unit == 0)
     return xino::error_nr::ok;
 
@@ -74,22 +89,253 @@ xino::error_t percpu_init(unsigned ncpu) noexcept {
     return xino::error_nr::overflow;
 
   // Allocate memory for all available CPUs.
-  base = xino::mm::virt_addr{new (std::align_val_t{UKERNEL_CACHE_LINE},
+  base = xino::mm::virt_addr{new (std::align_val_t{UKERNEL_PAGE_SIZE},
                                   std::nothrow) unsigned char[bytes]};
   if (base == xino::mm::virt_addr{})
     return xino::error_nr::nomem;
 
   for (unsigned cpu = 0; cpu < nr_cpus; cpu++) {
     xino::mm::virt_addr a{cpu_base(cpu)};
-    // Copy the template to the cpu area.
-    memcpy(a.ptr<void>(), __percpu_aligned_start, unit);
+    // Copy the template to the cpu area; the dynamic tail starts zeroed.
+    memcpy(a.ptr<void>(), __percpu_aligned_start, percpu_size());
+    memset((a + percpu_size()).ptr<void>(), 0, unit - percpu_size());
+    per_cpu(cpu_number, cpu) = cpu;
   }
 
   // Switch from bootstrap area to the final area.
   xino::cpu::tpidr_el2::write(
       static_cast<xino::cpu::tpidr_el2::reg_type>(cpu_base(0)));
 
+  return first_chunk_init();
+}
+
+unsigned nr_cpu_ids() noexcept {
+  return nr_cpus == 0 ? 1 : static_cast<unsigned>(nr_cpus);
+}
+
+xino::mm::virt_addr per_cpu_addr(xino::mm::virt_addr sym,
+                                 unsigned cpu_idx) noexcept {
+  // Bootstrap, the boot CPU runs on the template.
+  if (nr_cpus == 0)
+    return sym;
+
+  const std::ptrdiff_t off{sym - xino::mm::virt_addr{__percpu_aligned_start}};
+  return cpu_base(cpu_idx) + static_cast<std::uintptr_t>(off);
+}
+
+/* Dynamic per-CPU allocator. */
+
+/** @brief Allocation granularity, in bytes. */
+static constexpr std::size_t slot_size{8};
+static constexpr std::size_t bits_per_word{64};
+
+/**
+ * @brief A chunk of dynamic per-CPU memory.
+ *
+ * A chunk is `nr_cpus` copies of `unit` bytes, laid out with the same stride
+ * as the CPU areas, so a chunk offset is the same for every CPU and
+ * `this_cpu_addr()` works on chunk addresses. `start` is the chunk's first
+ * slot in the template address space (i.e. relative to
+ * `__percpu_aligned_start`).
+ *
+ * The first chunk is the tail of the CPU areas, after the static template;
+ * other chunks are allocated on demand and never released.
+ */
+struct chunk {
+  chunk *next;
+  std::uintptr_t start;
+  std::size_t nr_slots;
+  std::size_t nr_free;
+  std::uint64_t *alloc_map; // Slot in use.
+  std::uint64_t *bound_map; // Slot starts an allocation.
+};
+
+// List of chunks, protected by `chunk_lock`.
+static constinit chunk *chunks{};
+__cacheline_aligned static constinit xino::sync::spin_lock chunk_lock{
+    "percpu_chunk"};
+
+[[nodiscard]] static bool test_bit(const std::uint64_t *map,
+                                   std::size_t i) noexcept {
+  return (map[i / bits_per_word] >> (i % bits_per_word)) & 1;
+}
+
+static void assign_bit(std::uint64_t *map, std::size_t i, bool v) noexcept {
+  const std::uint64_t mask{std::uint64_t{1} << (i % bits_per_word)};
+
+  if (v)
+    map[i / bits_per_word] |= mask;
+  else
+    map[i / bits_per_word] &= ~mask;
+}
+
+/** @brief Create a chunk of @p nr_slots slots starting at @p start. */
+[[nodiscard]] static chunk *new_chunk(std::uintptr_t start,
+                                      std::size_t nr_slots) noexcept {
+  const std::size_t words{(nr_slots + bits_per_word - 1) / bits_per_word};
+
+  chunk *c{new (std::nothrow) chunk{}};
+  std::uint64_t *maps{new (std::nothrow) std::uint64_t[2 * words]{}};
+  if (c == nullptr || maps == nullptr) {
+    delete c;
+    delete[] maps;
+    return nullptr;
+  }
+
+  *c = chunk{nullptr, start, nr_slots, nr_slots, maps, maps + words};
+
+  return c;
+}
+
+static xino::error_t first_chunk_init() noexcept {
+  const std::size_t dyn{unit - percpu_size()};
+  if (dyn < slot_size)
+    return xino::error_nr::ok;
+
+  chunk *c{new_chunk(
+      reinterpret_cast<std::uintptr_t>(__percpu_aligned_start) + percpu_size(),
+      dyn / slot_size)};
+  if (c == nullptr)
+    return xino::error_nr::nomem;
+
+  chunks = c;
+
   return xino::error_nr::ok;
 }
 
+/**
+ * @brief First-fit @p n slots in @p c with the address aligned to @p align.
+ *
+ * @return First slot, or `c->nr_slots` if nothing fits.
+ */
+[[nodiscard]] static std::size_t find_fit(const chunk *c, std::size_t n,
+                                          std::size_t align) noexcept {
+  std::size_t i{0};
+
+  while (i + n <= c->nr_slots) {
+    // Align the candidate.
+    const std::uintptr_t a{c->start + i * slot_size};
+    const std::uintptr_t aligned{(a + align - 1) & ~(align - 1)};
+    i += (aligned - a) / slot_size;
+
+    std::size_t j{0};
+    while (j < n && i + j < c->nr_slots && !test_bit(c->alloc_map, i + j))
+      j++;
+
+    if (j == n)
+      return i;
+
+    // Restart past the used slot.
+    i += j + 1;
+  }
+
+  return c->nr_slots;
+}
+
+/** @brief Allocate @p n slots aligned to @p align, with `chunk_lock` held. */
+[[nodiscard]] static std::uintptr_t alloc_locked(std::size_t n,
+                                                 std::size_t align) noexcept {
+  for (chunk *c{chunks}; c != nullptr; c = c->next) {
+    if (c->nr_free < n)
+      continue;
+
+    const std::size_t i{find_fit(c, n, align)};
+    if (i == c->nr_slots)
+      continue;
+
+    for (std::size_t j{0}; j < n; j++)
+      assign_bit(c->alloc_map, i + j, true);
+    assign_bit(c->bound_map, i, true);
+    c->nr_free -= n;
+
+    return c->start + i * slot_size;
+  }
+
+  return 0;
+}
+
+void *alloc_percpu(std::size_t size, std::size_t align) noexcept {
+  // CPU areas and chunks are cache-line aligned.
+  if (size == 0 || size > unit || align > UKERNEL_CACHE_LINE ||
+      (align & (align - 1)) != 0 || nr_cpus == 0)
+    return nullptr;
+
+  if (align < slot_size)
+    align = slot_size;
+
+  const std::size_t n{(size + slot_size - 1) / slot_size};
+
+  xino::sync::irq_flags_t f{chunk_lock.lock_irqsave()};
+  std::uintptr_t p{alloc_locked(n, align)};
+  chunk_lock.unlock_irqrestore(f);
+
+  if (p == 0) {
+    // Add a chunk; allocate outside the lock.
+    unsigned char *mem{new (std::align_val_t{UKERNEL_PAGE_SIZE}, std::nothrow)
+                           unsigned char[unit * nr_cpus]};
+    if (mem == nullptr)
+      return nullptr;
+
+    // Same offset from every CPU area as CPU0's copy from `base`.
+    const std::ptrdiff_t off{xino::mm::virt_addr{mem} - base};
+    const std::uintptr_t tmpl{
+        reinterpret_cast<std::uintptr_t>(__percpu_aligned_start)};
+
+    chunk *c{new_chunk(tmpl + static_cast<std::uintptr_t>(off),
+                       unit / slot_size)};
+    if (c == nullptr) {
+      ::operator delete[](mem, std::align_val_t{UKERNEL_PAGE_SIZE});
+      return nullptr;
+    }
+
+    // Append, so older chunks are filled first.
+    f = chunk_lock.lock_irqsave();
+    chunk **tail{&chunks};
+    while (*tail != nullptr)
+      tail = &(*tail)->next;
+    *tail = c;
+    p = alloc_locked(n, align);
+    chunk_lock.unlock_irqrestore(f);
+
+    if (p == 0)
+      return nullptr;
+  }
+
+  // Zero every CPU's copy.
+  for (unsigned cpu{0}; cpu < nr_cpus; cpu++)
+    memset(per_cpu_addr(xino::mm::virt_addr{p}, cpu).ptr<void>(), 0, size);
+
+  return reinterpret_cast<void *>(p);
+}
+
+void free_percpu(void *ptr) noexcept {
+  if (ptr == nullptr)
+    return;
+
+  const std::uintptr_t p{reinterpret_cast<std::uintptr_t>(ptr)};
+
+  xino::sync::irq_flags_t f{chunk_lock.lock_irqsave()};
+  for (chunk *c{chunks}; c != nullptr; c = c->next) {
+    if (p < c->start || p >= c->start + c->nr_slots * slot_size)
+      continue;
+
+    const std::size_t i{(p - c->start) / slot_size};
+    if (!test_bit(c->bound_map, i))
+      break; // Not an allocation start.
+
+    // The allocation ends at the next start or free slot.
+    std::size_t j{i};
+    do {
+      assign_bit(c->alloc_map, j, false);
+      j++;
+    } while (j < c->nr_slots && test_bit(c->alloc_map, j) &&
+             !test_bit(c->bound_map, j));
+
+    assign_bit(c->bound_map, i, false);
+    c->nr_free += j - i;
+    break;
+  }
+  chunk_lock.unlock_irqrestore(f);
+}
+
 } // namespace xino::percpu
@@ -0,0 +1,65 @@
+#include <percpu_counter.hpp>
+
+namespace xino::percpu {
+
+xino::error_t percpu_counter::init(std::int64_t value,
+                                   std::int32_t batch_size) noexcept {
+  if (batch_size <= 0)
+    return xino::error_nr::invalid;
+
+  deltas = alloc_percpu<var<std::int64_t>>();
+  if (deltas == nullptr)
+    return xino::error_nr::nomem;
+
+  count = value;
+  batch = batch_size;
+
+  return xino::error_nr::ok;
+}
+
+void percpu_counter::destroy() noexcept {
+  free_percpu(deltas);
+  deltas = nullptr;
+  lock.destroy();
+}
+
+void percpu_counter::add(std::int64_t delta) noexcept {
+  std::int64_t *const local{&deltas->value};
+
+  // Single LSE atomic on this CPU's delta, IRQ-safe without masking.
+  if (const std::int64_t d{this_cpu_add_return(local, delta)};
+      d < batch && d > -batch)
+    return;
+
+  // Fold. Take the delta under the lock, so sum() sees it exactly once; an
+  // IRQ adding in between is folded too.
+  const xino::sync::irq_flags_t f{lock.lock_irqsave()};
+  __atomic_store_n(&count, count + this_cpu_xchg(local, 0), __ATOMIC_RELAXED);
+  lock.unlock_irqrestore(f);
+}
+
+std::int64_t percpu_counter::sum() noexcept {
+  const xino::sync::irq_flags_t f{lock.lock_irqsave()};
+
+  std::int64_t v{count};
+  for_each_cpu([&](unsigned cpu) {
+    v += __atomic_load_n(per_cpu_ptr(&deltas->value, cpu), __ATOMIC_RELAXED);
+  });
+
+  lock.unlock_irqrestore(f);
+
+  return v;
+}
+
+void percpu_counter::set(std::int64_t value) noexcept {
+  const xino::sync::irq_flags_t f{lock.lock_irqsave()};
+
+  for_each_cpu([&](unsigned cpu) {
+    __atomic_store_n(per_cpu_ptr(&deltas->value, cpu), 0, __ATOMIC_RELAXED);
+  });
+  __atomic_store_n(&count, value, __ATOMIC_RELAXED);
+
+  lock.unlock_irqrestore(f);
+}
+
+} // namespace xino::percpu
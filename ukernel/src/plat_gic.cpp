@@ -0,0 +1,312 @@
+#include <barrier.hpp>
+#include <config.h> // for UKERNEL_GICD_BASE, UKERNEL_GICR_BASE, ...
+#include <cpu.hpp>
+#include <fdt.hpp>
+#include <io.hpp>
+#include <mm_ioremap.hpp>
+#include <percpu.hpp>
+#include <plat_gic.hpp>
+#include <smp.hpp>
+#include <trace.hpp>
+
+namespace xino::plat::gic {
+
+// Distributor registers (see 12.9).
+static constexpr std::uintptr_t GICD_CTLR{0x0000};
+static constexpr std::uintptr_t GICD_TYPER{0x0004};
+static constexpr std::uintptr_t GICD_IGROUPR{0x0080};
+static constexpr std::uintptr_t GICD_ISENABLER{0x0100};
+static constexpr std::uintptr_t GICD_ICENABLER{0x0180};
+static constexpr std::uintptr_t GICD_ICPENDR{0x0280};
+static constexpr std::uintptr_t GICD_IPRIORITYR{0x0400};
+static constexpr std::uintptr_t GICD_IROUTER{0x6000};
+
+static constexpr std::uint32_t GICD_CTLR_ENABLE_GRP1{1U << 1};
+static constexpr std::uint32_t GICD_CTLR_ARE_NS{1U << 4};
+static constexpr std::uint32_t GICD_CTLR_RWP{1U << 31};
+
+// Redistributor registers, RD_base frame (see 12.11).
+static constexpr std::uintptr_t GICR_CTLR{0x0000};
+static constexpr std::uintptr_t GICR_TYPER{0x0008};
+static constexpr std::uintptr_t GICR_WAKER{0x0014};
+
+static constexpr std::uint32_t GICR_CTLR_RWP{1U << 3};
+static constexpr std::uint64_t GICR_TYPER_VLPIS{1UL << 1};
+static constexpr std::uint64_t GICR_TYPER_LAST{1UL << 4};
+static constexpr std::uint32_t GICR_WAKER_PROCESSOR_SLEEP{1U << 1};
+static constexpr std::uint32_t GICR_WAKER_CHILDREN_ASLEEP{1U << 2};
+
+// Redistributor registers, SGI_base frame (at RD_base + 64 KB).
+static constexpr std::uintptr_t GICR_SGI_OFFSET{0x10000};
+static constexpr std::uintptr_t GICR_IGROUPR0{0x0080};
+static constexpr std::uintptr_t GICR_ISENABLER0{0x0100};
+static constexpr std::uintptr_t GICR_ICENABLER0{0x0180};
+static constexpr std::uintptr_t GICR_ICPENDR0{0x0280};
+static constexpr std::uintptr_t GICR_IPRIORITYR{0x0400};
+
+/** @brief Priority of every interrupt (lower is more urgent). */
+static constexpr std::uint32_t default_prio{0xa0};
+static constexpr std::uint32_t default_prio_x4{default_prio * 0x01010101U};
+
+static constexpr const char *compatible{"arm,gic-v3"};
+
+__read_mostly constinit static xino::mm::virt_addr gicd_base{};
+__read_mostly constinit static xino::mm::virt_addr gicr_base{};
+__read_mostly constinit static std::size_t gicr_size{0};
+__read_mostly constinit static unsigned nr_irqs{0};
+
+/** @brief This CPU's redistributor (RD_base). */
+[[gnu::used, gnu::section(".percpu")]]
+constinit xino::percpu::var<xino::mm::virt_addr> gicr_rd{};
+
+struct irq_desc {
+  irq_handler_t fn;
+  void *arg;
+};
+
+__read_mostly constinit static irq_desc handlers[max_intid]{};
+
+static xino::mm::virt_addr gicd(std::uintptr_t off) { return gicd_base + off; }
+
+static xino::mm::virt_addr gicr(std::uintptr_t off) {
+  return xino::percpu::this_cpu(gicr_rd) + off;
+}
+
+static xino::mm::virt_addr gicr_sgi(std::uintptr_t off) {
+  return gicr(GICR_SGI_OFFSET + off);
+}
+
+static void gicd_wait_rwp() {
+  while (xino::io::readl_relaxed(gicd(GICD_CTLR)) & GICD_CTLR_RWP) {
+    /* Spin. */
+  }
+}
+
+static void gicr_wait_rwp() {
+  while (xino::io::readl_relaxed(gicr(GICR_CTLR)) & GICR_CTLR_RWP) {
+    /* Spin. */
+  }
+}
+
+/** @brief Affinity of @p mpidr as in `GICD_IROUTER` (Aff3.Aff2.Aff1.Aff0). */
+static std::uint64_t irouter_affinity(std::uint64_t mpidr) {
+  return mpidr & 0xff00ffffffUL;
+}
+
+/** @brief Affinity of @p mpidr as in `GICR_TYPER[63:32]`. */
+static std::uint32_t typer_affinity(std::uint64_t mpidr) {
+  return static_cast<std::uint32_t>(((mpidr >> 8) & 0xff000000UL) |
+                                    (mpidr & 0xffffffUL));
+}
+
+/** @brief GICD and GICR regions, from the DTB or the configuration. */
+static void probe(xino::mm::phys_addr &d_pa, std::size_t &d_size,
+                  xino::mm::phys_addr &r_pa, std::size_t &r_size) {
+  const xino::fdt::node n{xino::fdt::find_compatible(compatible)};
+  if (n.valid() && xino::fdt::reg(n, 0, d_pa, d_size) &&
+      xino::fdt::reg(n, 1, r_pa, r_size))
+    return;
+
+  d_pa = xino::mm::phys_addr{UKERNEL_GICD_BASE};
+  d_size = 0x10000;
+  r_pa = xino::mm::phys_addr{UKERNEL_GICR_BASE};
+  r_size = UKERNEL_GICR_SIZE;
+}
+
+xino::error_t init() noexcept {
+  using namespace xino::io;
+
+  xino::mm::phys_addr d_pa, r_pa;
+  std::size_t d_size, r_size;
+  probe(d_pa, d_size, r_pa, r_size);
+
+  gicd_base = xino::mm::ioremap(d_pa, d_size, xino::mm::prot_device_posted);
+  gicr_base = xino::mm::ioremap(r_pa, r_size, xino::mm::prot_device_posted);
+  if (gicd_base == xino::mm::virt_addr{} ||
+      gicr_base == xino::mm::virt_addr{})
+    return xino::error_nr::invalid;
+
+  gicr_size = r_size;
+
+  writel(0, gicd(GICD_CTLR));
+  gicd_wait_rwp();
+
+  nr_irqs = 32 * ((readl_relaxed(gicd(GICD_TYPER)) & 0x1f) + 1);
+  if (nr_irqs > max_intid)
+    nr_irqs = max_intid;
+
+  const std::uint64_t boot{irouter_affinity(xino::cpu::mpidr_el1::read())};
+
+  // SPIs: Group 1, disabled, not pending, default priority, to the boot CPU.
+  for (unsigned i{first_spi}; i < nr_irqs; i += 32) {
+    writel_relaxed(~0U, gicd(GICD_IGROUPR + i / 8));
+    writel_relaxed(~0U, gicd(GICD_ICENABLER + i / 8));
+    writel_relaxed(~0U, gicd(GICD_ICPENDR + i / 8));
+  }
+
+  for (unsigned i{first_spi}; i < nr_irqs; i += 4)
+    writel_relaxed(default_prio_x4, gicd(GICD_IPRIORITYR + i));
+
+  for (unsigned i{first_spi}; i < nr_irqs; i++)
+    writeq_relaxed(boot, gicd(GICD_IROUTER + i * 8));
+
+  writel(GICD_CTLR_ARE_NS | GICD_CTLR_ENABLE_GRP1, gicd(GICD_CTLR));
+  gicd_wait_rwp();
+
+  return xino::error_nr::ok;
+}
+
+/** @brief Find the redistributor of the CPU with affinity @p aff. */
+static xino::mm::virt_addr find_rd(std::uint32_t aff) {
+  xino::mm::virt_addr rd{gicr_base};
+  const xino::mm::virt_addr end{gicr_base + gicr_size};
+
+  while (rd < end) {
+    const std::uint64_t typer{xino::io::readq_relaxed(rd + GICR_TYPER)};
+    if (static_cast<std::uint32_t>(typer >> 32) == aff)
+      return rd;
+
+    if (typer & GICR_TYPER_LAST)
+      break;
+
+    // RD_base and SGI_base, plus VLPI_base and a reserved frame with GICv4.
+    rd = rd + ((typer & GICR_TYPER_VLPIS) ? 0x40000 : 0x20000);
+  }
+
+  return xino::mm::virt_addr{};
+}
+
+xino::error_t cpu_init() noexcept {
+  using namespace xino::io;
+  using namespace xino::cpu;
+
+  const xino::mm::virt_addr rd{find_rd(typer_affinity(mpidr_el1::read()))};
+  if (rd == xino::mm::virt_addr{})
+    return xino::error_nr::invalid;
+
+  xino::percpu::this_cpu(gicr_rd) = rd;
+
+  // Wake the redistributor up.
+  writel(readl_relaxed(gicr(GICR_WAKER)) & ~GICR_WAKER_PROCESSOR_SLEEP,
+         gicr(GICR_WAKER));
+  while (readl_relaxed(gicr(GICR_WAKER)) & GICR_WAKER_CHILDREN_ASLEEP) {
+    /* Spin. */
+  }
+
+  // SGIs and PPIs: Group 1, disabled, not pending, default priority.
+  writel_relaxed(~0U, gicr_sgi(GICR_IGROUPR0));
+  writel_relaxed(~0U, gicr_sgi(GICR_ICENABLER0));
+  writel_relaxed(~0U, gicr_sgi(GICR_ICPENDR0));
+  for (unsigned i{0}; i < first_spi; i += 4)
+    writel_relaxed(default_prio_x4, gicr_sgi(GICR_IPRIORITYR + i));
+  gicr_wait_rwp();
+
+  // System-register interface, for EL2 and (later) for guests at EL1.
+  icc_sre_el2::write_bits(icc_sre_el2::sre::mask | icc_sre_el2::enable::mask);
+  icc_pmr_el1::write(icc_pmr_el1::priority::encode(0xff));
+  icc_igrpen1_el1::write(icc_igrpen1_el1::enable::mask);
+
+  // Take physical IRQs and FIQs at EL2.
+  hcr_el2::write_bits(hcr_el2::imo::mask | hcr_el2::fmo::mask);
+
+  return xino::error_nr::ok;
+}
+
+void set_handler(unsigned intid, irq_handler_t fn, void *arg) noexcept {
+  if (intid >= max_intid)
+    return;
+
+  handlers[intid] = {fn, arg};
+}
+
+void enable(unsigned intid) noexcept {
+  using namespace xino::io;
+
+  const std::uint32_t bit{1U << (intid % 32)};
+
+  if (intid < first_spi)
+    writel(bit, gicr_sgi(GICR_ISENABLER0));
+  else if (intid < nr_irqs)
+    writel(bit, gicd(GICD_ISENABLER + intid / 32 * 4));
+}
+
+void disable(unsigned intid) noexcept {
+  using namespace xino::io;
+
+  const std::uint32_t bit{1U << (intid % 32)};
+
+  if (intid < first_spi) {
+    writel(bit, gicr_sgi(GICR_ICENABLER0));
+    gicr_wait_rwp();
+  } else if (intid < nr_irqs) {
+    writel(bit, gicd(GICD_ICENABLER + intid / 32 * 4));
+    gicd_wait_rwp();
+  }
+}
+
+/** @brief `ICC_SGI1R_EL1` value without the target list. */
+static std::uint64_t sgi1r_cluster(unsigned sgi, std::uint64_t mpidr) {
+  using sgi1r = xino::cpu::icc_sgi1r_el1;
+  using mpidr_el1 = xino::cpu::mpidr_el1;
+
+  const std::uint64_t aff0{(mpidr & mpidr_el1::aff0::mask) >> 0};
+  const std::uint64_t aff1{(mpidr & mpidr_el1::aff1::mask) >> 8};
+  const std::uint64_t aff2{(mpidr & mpidr_el1::aff2::mask) >> 16};
+  const std::uint64_t aff3{(mpidr & mpidr_el1::aff3::mask) >> 32};
+
+  return sgi1r::intid::encode(sgi) | sgi1r::aff1::encode(aff1) |
+         sgi1r::aff2::encode(aff2) | sgi1r::aff3::encode(aff3) |
+         sgi1r::rs::encode(aff0 / 16);
+}
+
+void send_sgi(unsigned sgi, const xino::smp::cpumask &targets) noexcept {
+  using sgi1r = xino::cpu::icc_sgi1r_el1;
+
+  // The SGI is a system register write, not ordered by DMB; make the stores
+  // visible to the targets first.
+  xino::barrier::dsb<xino::barrier::opt::ishst>();
+
+  xino::smp::cpumask pending{targets};
+
+  while (!pending.empty()) {
+    std::uint64_t cluster{~0UL};
+    std::uint64_t list{0};
+
+    pending.for_each([&](unsigned cpu) {
+      const std::uint64_t mpidr{xino::smp::cpu_mpidr(cpu)};
+      const std::uint64_t c{sgi1r_cluster(sgi, mpidr)};
+
+      if (cluster == ~0UL)
+        cluster = c;
+      else if (c != cluster)
+        return;
+
+      list |= std::uint64_t{1} << (mpidr & 0xf);
+      pending.clear(cpu);
+    });
+
+    sgi1r::write(cluster | sgi1r::target_list::encode(list));
+  }
+}
+
+void handle_irq() noexcept {
+  using namespace xino::cpu;
+
+  for (;;) {
+    const unsigned intid{static_cast<unsigned>(
+        icc_iar1_el1::read() & icc_iar1_el1::intid::mask)};
+    if (intid >= max_intid)
+      return; // Spurious: nothing (more) pending.
+
+    const irq_desc &d{handlers[intid]};
+    XINO_TRACE_BEGIN("irq", "intid %u", intid);
+    if (d.fn != nullptr)
+      d.fn(intid, d.arg);
+    XINO_TRACE_END("irq");
+
+    // EOImode == 0: priority drop and deactivation.
+    icc_eoir1_el1::write(icc_eoir1_el1::intid::encode(intid));
+  }
+}
+
+} // namespace xino::plat::gic
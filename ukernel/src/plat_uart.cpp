@@ -1,10 +1,51 @@
 
+#include <cpu.hpp>
+#include <cpumask.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fdt.hpp>
 #include <io_buffer.h>
+#include <mm_ioremap.hpp>
+#include <mm_va_layout.hpp>
+#include <percpu.hpp>
+#include <plat_gic.hpp>
 #include <plat_uart.hpp>
+#include <ring.hpp>
 #include <stddef.h>
+#include <sync.hpp>
 
 namespace xino::plat::uart {
 
+/**
+ * @brief Send @p buf in bursts of up to @p depth characters ('\n' as CRLF).
+ *
+ * @p wait_empty blocks until the TX FIFO is empty, @p put writes one
+ * character with a relaxed store.
+ */
+template <typename WaitEmpty, typename Put>
+static void burst_write(const char *buf, std::size_t count, std::size_t depth,
+                        WaitEmpty wait_empty, Put put) noexcept {
+  std::size_t i{0};
+  bool cr{false}; // The '\r' for the '\n' at `buf[i]` is sent.
+
+  while (i < count) {
+    wait_empty();
+
+    // One barrier orders the burst after earlier stores; Device memory keeps
+    // the relaxed stores to the data register in order.
+    xino::barrier::iowmb();
+    for (std::size_t room{depth}; room != 0 && i < count; room--) {
+      if (buf[i] == '\n' && !cr) {
+        put('\r');
+        cr = true;
+      } else {
+        put(buf[i++]);
+        cr = false;
+      }
+    }
+  }
+}
+
 /* PL011. */
 
 void PL011::init(const xino::mm::virt_addr &new_base, bool fifo) noexcept {
@@ -17,6 +58,19 @@ void PL011::init(const xino::mm::virt_addr &new_base, bool fifo) noexcept {
   writel(0x7FF, reg(UARTICR)); // Clear pending interrupts.
   writel(UARTLCR_H_WLEN_8 | (fifo ? UARTLCR_H_FEN : 0), reg(UARTLCR_H));
   writel(UARTCR_UARTEN | UARTCR_TXE, reg(UARTCR));
+  fifo_enabled = fifo;
+
+  // Like Linux: revisions before r1p5 have a 16-entry FIFO.
+  const std::uint32_t rev{
+      (readl_relaxed(reg(UARTPeriphID2)) >> UARTPeriphID2_REV_SHIFT) & 0xf};
+  fifo_depth = rev < 3 ? 16 : 32;
+}
+
+void PL011::tx_irq(bool on) noexcept {
+  using namespace xino::io;
+
+  const std::uint32_t imsc{readl_relaxed(reg(UARTIMSC))};
+  writel(on ? imsc | UARTIMSC_TXIM : imsc & ~UARTIMSC_TXIM, reg(UARTIMSC));
 }
 
 void PL011::putc(char c) noexcept {
@@ -35,6 +89,19 @@ void PL011::putc(char c) noexcept {
   writel(static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)), reg(UARTDR));
 }
 
+void PL011::write(const char *buf, std::size_t count) noexcept {
+  if (uart_base == xino::mm::virt_addr{})
+    return;
+
+  burst_write(
+      buf, count, fifo_enabled ? fifo_depth : 1, [] { wait_tx_empty_at(); },
+      [](char c) {
+        xino::io::writel_relaxed(
+            static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)),
+            reg(UARTDR));
+      });
+}
+
 /* DW_APB. */
 
 void DW_APB::init(const xino::mm::virt_addr &new_base, bool fifo) noexcept {
@@ -46,6 +113,7 @@ void DW_APB::init(const xino::mm::virt_addr &new_base, bool fifo) noexcept {
   writel(LCR_WLEN8, reg(LCR)); // 8N1, disable parity, normal access access.
   writel(fifo ? FCR_FIFOE | FCR_RFIFOR | FCR_XFIFOR : 0x0, reg(FCR));
   writel(0x0, reg(MCR)); // No modem ctrl.
+  fifo_enabled = fifo;
 }
 
 void DW_APB::putc(char c) noexcept {
@@ -55,16 +123,356 @@ void DW_APB::putc(char c) noexcept {
     return;
 
   if (c == '\n') {
-    wait_tx_space_at();
+    wait_tx_empty_at();
     writel(static_cast<std::uint32_t>(static_cast<std::uint8_t>('\r')),
            reg(THR));
   }
 
-  wait_tx_space_at();
+  wait_tx_empty_at();
   writel(static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)), reg(THR));
 }
 
-/* xxx_uart. */
+void DW_APB::write(const char *buf, std::size_t count) noexcept {
+  if (uart_base == xino::mm::virt_addr{})
+    return;
+
+  burst_write(
+      buf, count, fifo_enabled ? fifo_depth : 1, [] { wait_tx_empty_at(); },
+      [](char c) {
+        xino::io::writel_relaxed(
+            static_cast<std::uint32_t>(static_cast<std::uint8_t>(c)),
+            reg(THR));
+      });
+}
+
+/* Asynchronous TX. */
+
+/**
+ * @brief Console text in ring-sized pieces.
+ *
+ * A slot holds up to 23 characters rather than one, so a line costs a few
+ * ring operations; '\n' is already expanded to CRLF.
+ */
+struct tx_chunk {
+  std::uint8_t len;
+  char data[23];
+};
+
+static constexpr std::size_t tx_ring_chunks{256};
+
+/** @brief Chunks staged on the stack per ring operation. */
+static constexpr std::size_t tx_batch{8};
+
+static constinit xino::sync::mpsc_ring<tx_chunk, tx_ring_chunks> tx_ring{};
+
+/** @brief Consumer side: held by whoever moves the ring into the FIFO. */
+__cacheline_aligned static constinit xino::sync::spin_lock tx_lock{"uart_tx"};
+static constinit tx_chunk tx_cur{}; // Chunk being sent, under `tx_lock`.
+static constinit std::size_t tx_off{};
+
+/** @brief Async mode: set by tx_async_init(), cleared by console_sync(). */
+__read_mostly static constinit bool tx_async{};
+/** @brief TX interrupt; `0` (an SGI) until tx_async_init() succeeds. */
+__read_mostly static constinit unsigned tx_intid{};
+
+/**
+ * @brief Move queued text into the FIFO until it is full (under `tx_lock`).
+ *
+ * @return Whether everything queued has been sent.
+ */
+static bool tx_fill() noexcept {
+  while (driver::tx_ready()) {
+    if (tx_off == tx_cur.len) {
+      if (!tx_ring.pop(tx_cur)) {
+        tx_cur.len = 0;
+        tx_off = 0;
+        return true;
+      }
+
+      tx_off = 0;
+    }
+
+    driver::tx_put(tx_cur.data[tx_off++]);
+  }
+
+  return tx_off == tx_cur.len && tx_ring.empty();
+}
+
+void tx_kick() noexcept {
+  // A racy peek: a chunk that is being consumed is not lost either way.
+  if (!__atomic_load_n(&tx_async, __ATOMIC_ACQUIRE) || tx_ring.empty_hint())
+    return;
+
+  for (;;) {
+    const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+    if (!tx_lock.try_lock()) {
+      // The holder sees our chunks: it drains the ring, or re-checks it
+      // after unlocking.
+      xino::sync::irq_restore(f);
+      return;
+    }
+
+    const bool done{tx_fill()};
+    driver::tx_irq(!done);
+    tx_lock.unlock();
+    xino::sync::irq_restore(f);
+
+    // A writer may have pushed and failed try_lock() after tx_fill() found
+    // the ring empty; retake the lock for its text.
+    if (!done || tx_ring.empty_hint())
+      return;
+  }
+}
+
+static void tx_irq_handler(unsigned, void *) {
+  driver::tx_irq_ack();
+
+  for (;;) {
+    tx_lock.lock();
+    const bool done{tx_fill()};
+    driver::tx_irq(!done);
+    tx_lock.unlock();
+
+    // As in tx_kick(): a writer whose try_lock() failed relies on us.
+    if (!done || tx_ring.empty_hint())
+      return;
+  }
+}
+
+/** @brief Send the current chunk polled and take the next one (`tx_lock`). */
+static void tx_make_room() noexcept {
+  while (tx_off != tx_cur.len) {
+    if (driver::tx_ready())
+      driver::tx_put(tx_cur.data[tx_off++]);
+  }
+
+  if (!tx_ring.pop(tx_cur))
+    tx_cur.len = 0;
+  tx_off = 0;
+}
+
+/** @brief Queue @p n chunks; when the ring is full, make room polled. */
+static void tx_queue(const tx_chunk *c, std::size_t n) noexcept {
+  for (;;) {
+    const std::size_t k{tx_ring.push_n(c, n)};
+    c += k;
+    n -= k;
+
+    if (n == 0)
+      return;
+
+    // The TX interrupt may target this CPU with IRQs masked, so do not wait
+    // for it.
+    const xino::sync::irq_flags_t f{tx_lock.lock_irqsave()};
+    tx_make_room();
+    tx_lock.unlock_irqrestore(f);
+  }
+}
+
+static void tx_write_async(const char *buf, std::size_t count) noexcept {
+  tx_chunk c[tx_batch];
+  std::size_t n{0};
+  c[0].len = 0;
+
+  for (std::size_t i{0}; i < count; i++) {
+    const std::size_t need{buf[i] == '\n' ? 2U : 1U};
+    if (c[n].len + need > sizeof(c[n].data)) {
+      if (++n == tx_batch) {
+        tx_queue(c, n);
+        n = 0;
+      }
+
+      c[n].len = 0;
+    }
+
+    if (buf[i] == '\n')
+      c[n].data[c[n].len++] = '\r';
+    c[n].data[c[n].len++] = buf[i];
+  }
+
+  if (c[n].len != 0)
+    n++;
+
+  tx_queue(c, n);
+  tx_kick();
+}
+
+void console_write(const char *buf, std::size_t count) noexcept {
+  if (__atomic_load_n(&tx_async, __ATOMIC_ACQUIRE)) {
+    tx_write_async(buf, count);
+    return;
+  }
+
+  driver::write(buf, count);
+}
+
+xino::error_t tx_async_init() noexcept {
+  xino::fdt::irq_spec spec{};
+  if (!xino::fdt::interrupt(xino::fdt::stdout_node(), 0, spec) ||
+      !xino::fdt::is_compatible(spec.controller, "arm,gic-v3") ||
+      spec.nr_cells < 2)
+    return xino::error_nr::invalid;
+
+  // GIC binding: cell 0 is 0 for an SPI, 1 for a PPI; cell 1 is the number.
+  unsigned intid;
+  if (spec.cells[0] == 0)
+    intid = xino::plat::gic::first_spi + spec.cells[1];
+  else if (spec.cells[0] == 1)
+    intid = xino::plat::gic::nr_sgis + spec.cells[1];
+  else
+    return xino::error_nr::invalid;
+
+  if (intid >= xino::plat::gic::max_intid)
+    return xino::error_nr::invalid;
+
+  driver::tx_irq(false);
+  xino::plat::gic::set_handler(intid, tx_irq_handler, nullptr);
+  xino::plat::gic::enable(intid);
+  tx_intid = intid;
+  __atomic_store_n(&tx_async, true, __ATOMIC_RELEASE);
+
+  return xino::error_nr::ok;
+}
+
+/* Per-CPU stdio streams. */
+
+static constexpr std::size_t stream_buf_size{256};
+
+/**
+ * @struct cpu_stream
+ * @brief A CPU's buffered `stdout` or `stderr`.
+ *
+ * `busy` is set while a stdio call uses the stream; a call nested in it (an
+ * IRQ or exception handler on the same CPU) gets the unbuffered stream.
+ */
+struct alignas(UKERNEL_CACHE_LINE) cpu_stream {
+  io_buffer io;
+  bool busy;
+  char buf[stream_buf_size];
+};
+
+static size_t stream_write(io_buffer *io, const char *buf,
+                           size_t count) noexcept {
+  (void)io;
+  console_write(buf, count);
+  return count;
+}
+
+static int stream_flush(io_buffer *io) noexcept {
+  if (io->out != 0) {
+    console_write(io->buffer, io->out);
+    io->out = 0;
+  }
+
+  return 0;
+}
+
+constinit static io_buffer_ops stream_ops{
+    .read = nullptr,
+    .write = stream_write,
+    .flush = stream_flush,
+};
+
+// Index 0 is `stdout`, 1 is `stderr`.
+__cacheline_aligned constinit static cpu_stream
+    streams[xino::smp::nr_cpus_max][2]{};
+
+/** @brief The stream of @p io if it is in `streams`, or `nullptr`. */
+[[nodiscard]] static cpu_stream *to_stream(io_buffer *io) noexcept {
+  const auto p{reinterpret_cast<std::uintptr_t>(io)};
+  const auto first{reinterpret_cast<std::uintptr_t>(&streams[0][0])};
+  const auto last{reinterpret_cast<std::uintptr_t>(
+      &streams[xino::smp::nr_cpus_max - 1][1])};
+
+  return p >= first && p <= last ? reinterpret_cast<cpu_stream *>(io)
+                                 : nullptr;
+}
+
+/**
+ * @brief Stream @p idx of the calling CPU, or `nullptr` before per-CPU
+ *        addressing works (e.g. a panic in early boot).
+ */
+[[nodiscard]] static cpu_stream *this_cpu_stream(unsigned idx) noexcept {
+  if (!xino::percpu::ready())
+    return nullptr;
+
+  const unsigned cpu{xino::percpu::this_cpu_id()};
+  return cpu < xino::smp::nr_cpus_max ? &streams[cpu][idx] : nullptr;
+}
+
+static io_buffer *get_stream(io_buffer *io) noexcept {
+  unsigned idx;
+  if (static_cast<void *>(io) == static_cast<void *>(stdout))
+    idx = 0;
+  else if (static_cast<void *>(io) == static_cast<void *>(stderr))
+    idx = 1;
+  else
+    return io;
+
+  cpu_stream *const s{this_cpu_stream(idx)};
+  if (s == nullptr || s->busy)
+    return io;
+
+  s->busy = true;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+  if (s->io.ops == nullptr) {
+    // `stdout` is line buffered; `stderr` is flushed by put_stream().
+    s->io.mode = idx == 0 ? _IOLBF : _IOFBF;
+    s->io.buffer = s->buf;
+    s->io.buf_size = sizeof(s->buf);
+    s->io.ops = &stream_ops;
+  }
+
+  return &s->io;
+}
+
+static void put_stream(io_buffer *io) noexcept {
+  cpu_stream *s{to_stream(io)};
+  if (s == nullptr)
+    return;
+
+  if (s->io.mode == _IOFBF)
+    (void)stream_flush(io);
+
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  s->busy = false;
+}
+
+void console_sync() noexcept {
+  using namespace xino::cpu;
+
+  const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+
+  // Text is only queued once tx_async_init() succeeded; a panic in early
+  // boot may come before the UART is even set up.
+  if (tx_intid != 0) {
+    __atomic_store_n(&tx_async, false, __ATOMIC_RELEASE);
+
+    // Keep trying for ~10ms, then assume the holder is this (dead) CPU.
+    const std::uint64_t deadline{cntvct_el0::read() +
+                                 cntfrq_el0::read() / 100};
+    bool locked{false};
+    while (!(locked = tx_lock.try_lock()) && cntvct_el0::read() < deadline) {
+      /* Spin. */
+    }
+
+    driver::tx_irq(false);
+    while (!tx_fill()) {
+      /* Spin. */
+    }
+
+    if (locked)
+      tx_lock.unlock();
+  }
+
+  // Then the partial line this CPU's `stdout` holds (polled now), unless it
+  // is in use.
+  if (cpu_stream *const s{this_cpu_stream(0)}; s != nullptr && !s->busy)
+    (void)stream_flush(&s->io);
+
+  xino::sync::irq_restore(f);
+}
 
 } // namespace xino::plat::uart
 
@@ -77,19 +485,54 @@ void uart_set_base(uintptr_t base) {
   xino::plat::uart::driver::set_base(xino::mm::virt_addr{base});
 }
 
+/**
+ * Move the UART registers to a devmap mapping (identity if mapping is off).
+ *
+ * If the DTB `stdout-path` names a UART handled by the driver, switch to it;
+ * otherwise keep the early `UKERNEL_UART_BASE` console.
+ */
+void uart_remap() {
+  using driver = xino::plat::uart::driver;
+
+  xino::mm::phys_addr pa{UKERNEL_UART_BASE};
+  std::size_t size{xino::mm::va_layout::granule_size()};
+
+  const xino::fdt::node n{xino::fdt::stdout_node()};
+  const bool probed{xino::fdt::is_compatible(n, driver::compatible) &&
+                    xino::fdt::reg(n, 0, pa, size)};
+
+  const xino::mm::virt_addr va{
+      xino::mm::ioremap(pa, size, xino::mm::prot_device_posted)};
+  if (va == xino::mm::virt_addr{})
+    return;
+
+  if (probed && pa != xino::mm::phys_addr{UKERNEL_UART_BASE})
+    driver::init(va, true);
+  else
+    driver::set_base(va);
+}
+
 /* Override stdio.h weak writers. */
 
 size_t iob_write_stdout(struct io_buffer *io, const char *buf, size_t count) {
   (void)io;
-  for (int i{0}; i < count; i++)
-    xino::plat::uart::driver::putc(buf[i]);
+  xino::plat::uart::console_write(buf, count);
   return count;
 }
 
 size_t iob_write_stderr(struct io_buffer *io, const char *buf, size_t count) {
   (void)io;
-  for (int i{0}; i < count; i++)
-    xino::plat::uart::driver::putc(buf[i]);
+  xino::plat::uart::console_write(buf, count);
   return count;
 }
+
+/* Override stdio.h weak stream hooks: per-CPU buffered stdout/stderr. */
+
+struct io_buffer *iob_get_stream(struct io_buffer *io) {
+  return xino::plat::uart::get_stream(io);
+}
+
+void iob_put_stream(struct io_buffer *io) {
+  xino::plat::uart::put_stream(io);
+}
 }
@@ -0,0 +1,91 @@
+#include <cache.hpp>
+#include <cstring>
+#include <fdt.hpp>
+#include <klog.hpp>
+#include <psci.hpp>
+
+namespace xino::psci {
+
+// Function IDs (see 5.1).
+static constexpr std::uint32_t PSCI_VERSION{0x84000000};
+static constexpr std::uint32_t PSCI_CPU_ON_64{0xc4000003};
+
+// Return codes (see 5.2.2).
+static constexpr std::int64_t PSCI_SUCCESS{0};
+
+__read_mostly constinit static std::uint32_t fn_cpu_on{0};
+__read_mostly constinit static std::uint32_t psci_version{0};
+
+/** @brief SMCCC call with up to three arguments; returns `x0`. */
+static std::int64_t smc(std::uint64_t fid, std::uint64_t a1,
+                        std::uint64_t a2, std::uint64_t a3) {
+  register std::uint64_t x0 __asm__("x0"){fid};
+  register std::uint64_t x1 __asm__("x1"){a1};
+  register std::uint64_t x2 __asm__("x2"){a2};
+  register std::uint64_t x3 __asm__("x3"){a3};
+
+  // SMCCC 1.0 does not preserve x4-x17.
+  __asm__ __volatile__("smc #0"
+                       : "+r"(x0), "+r"(x1), "+r"(x2), "+r"(x3)
+                       :
+                       : "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11",
+                         "x12", "x13", "x14", "x15", "x16", "x17", "memory");
+
+  return static_cast<std::int64_t>(x0);
+}
+
+xino::error_t init() noexcept {
+  xino::fdt::node n{xino::fdt::find_compatible("arm,psci-1.0")};
+  if (!n.valid())
+    n = xino::fdt::find_compatible("arm,psci-0.2");
+
+  const bool v0_1{!n.valid()};
+  if (v0_1)
+    n = xino::fdt::find_compatible("arm,psci");
+
+  if (!n.valid())
+    return xino::error_nr::invalid;
+
+  const char *method{xino::fdt::get_property(n, "method").str()};
+  if (method == nullptr || strcmp(method, "smc") != 0) {
+    xino::klog::log(xino::klog::level::err,
+                    "psci: method %s is not supported at EL2\n",
+                    method != nullptr ? method : "(none)");
+    return xino::error_nr::invalid;
+  }
+
+  if (v0_1) {
+    const xino::fdt::property p{xino::fdt::get_property(n, "cpu_on")};
+    if (p.nr_cells() != 1)
+      return xino::error_nr::invalid;
+
+    fn_cpu_on = p.u32(0);
+    psci_version = 1; // 0.1
+  } else {
+    fn_cpu_on = PSCI_CPU_ON_64;
+    psci_version = static_cast<std::uint32_t>(smc(PSCI_VERSION, 0, 0, 0));
+  }
+
+  return xino::error_nr::ok;
+}
+
+std::uint32_t version() noexcept { return psci_version; }
+
+xino::error_t cpu_on(std::uint64_t mpidr, xino::mm::phys_addr entry,
+                     std::uint64_t context_id) noexcept {
+  if (fn_cpu_on == 0)
+    return xino::error_nr::invalid;
+
+  const std::int64_t r{
+      smc(fn_cpu_on, mpidr, static_cast<xino::mm::phys_addr::value_type>(entry),
+          context_id)};
+  if (r != PSCI_SUCCESS) {
+    xino::klog::log(xino::klog::level::err, "psci: CPU_ON(%#lx) failed: %ld\n",
+                    (unsigned long)mpidr, (long)r);
+    return xino::error_nr::invalid;
+  }
+
+  return xino::error_nr::ok;
+}
+
+} // namespace xino::psci
@@ -0,0 +1,115 @@
+#include <percpu.hpp>
+#include <qspinlock.hpp>
+
+namespace xino::sync {
+
+/** @brief MCS queue node; `nodes[0].count` is the CPU's nesting depth. */
+struct qnode {
+  qnode *next;
+  std::uint32_t locked; // Set by the predecessor when this node is the head.
+  std::uint32_t count;
+};
+
+using qnodes_t = qnode[queued_spin_lock::max_nesting];
+
+// One cache line of nodes per CPU.
+[[gnu::used, gnu::section(".percpu_aligned")]]
+constinit xino::percpu::hot<qnodes_t> qnodes{};
+
+static std::uint32_t encode_tail(unsigned cpu, unsigned idx) {
+  return ((cpu + 1) << queued_spin_lock::tail_cpu_shift) |
+         (idx << queued_spin_lock::tail_idx_shift);
+}
+
+static qnode *decode_tail(std::uint32_t tail) {
+  const unsigned cpu{(tail >> queued_spin_lock::tail_cpu_shift) - 1};
+  const unsigned idx{(tail & queued_spin_lock::tail_idx_mask) >>
+                     queued_spin_lock::tail_idx_shift};
+
+  return &xino::percpu::per_cpu(qnodes, cpu)[idx];
+}
+
+void queued_spin_lock::lock_slowpath() noexcept {
+  qnodes_t &nodes{xino::percpu::this_cpu(qnodes)};
+
+  // An IRQ taken here nests and returns the count balanced.
+  const unsigned idx{nodes[0].count++};
+
+  if (idx >= max_nesting) {
+    // Out of nodes; spin on the lock word.
+    for (;;) {
+      xino::cpu::sevl();
+
+      while (__atomic_load_n(&val, __ATOMIC_RELAXED) != 0)
+        xino::cpu::wfe();
+
+      if (try_lock())
+        break;
+    }
+
+    nodes[0].count--;
+    return;
+  }
+
+  qnode *const node{&nodes[idx]};
+  __atomic_store_n(&node->next, nullptr, __ATOMIC_RELAXED);
+  __atomic_store_n(&node->locked, 0, __ATOMIC_RELAXED);
+
+  const std::uint32_t tail{encode_tail(xino::percpu::this_cpu_id(), idx)};
+
+  // Publish the node as the new tail, keeping the locked byte. Release, so the
+  // initialized node is visible to the successor that finds it; acquire, so
+  // the previous tail's node is visible to us.
+  std::uint32_t old{__atomic_load_n(&val, __ATOMIC_RELAXED)};
+  while (!__atomic_compare_exchange_n(&val, &old, (old & ~tail_mask) | tail,
+                                      true, __ATOMIC_ACQ_REL,
+                                      __ATOMIC_RELAXED))
+    ;
+
+  if ((old & tail_mask) != 0) {
+    // Link behind the previous tail and wait to become the queue head.
+    __atomic_store_n(&decode_tail(old)->next, node, __ATOMIC_RELAXED);
+    xino::cpu::sev();
+
+    xino::cpu::sevl();
+    while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE) == 0)
+      xino::cpu::wfe();
+  }
+
+  // Queue head: wait for the owner. unlock() sends the event.
+  std::uint32_t v;
+  xino::cpu::sevl();
+  while (((v = __atomic_load_n(&val, __ATOMIC_ACQUIRE)) & locked_mask) != 0)
+    xino::cpu::wfe();
+
+  // Take the lock. With a non-empty queue, only the head sets the locked byte
+  // (all other acquirers need the word to be `0`).
+  for (;;) {
+    if ((v & tail_mask) == tail) {
+      // Last in the queue; also clear the tail.
+      if (__atomic_compare_exchange_n(&val, &v, 1, false, __ATOMIC_ACQUIRE,
+                                      __ATOMIC_RELAXED)) {
+        nodes[0].count--;
+        return;
+      }
+
+      continue;
+    }
+
+    (void)__atomic_fetch_or(&val, 1, __ATOMIC_RELAXED);
+    break;
+  }
+
+  // A successor swapped the tail; wait until it links in, then hand it over.
+  qnode *next;
+  xino::cpu::sevl();
+  while ((next = __atomic_load_n(&node->next, __ATOMIC_RELAXED)) == nullptr)
+    xino::cpu::wfe();
+
+  __atomic_store_n(&next->locked, 1, __ATOMIC_RELEASE);
+  xino::cpu::sev();
+
+  nodes[0].count--;
+}
+
+} // namespace xino::sync
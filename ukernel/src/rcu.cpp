@@ -0,0 +1,157 @@
+#include <cache.hpp>
+#include <cpu.hpp>
+#include <cstdint>
+#include <percpu.hpp>
+#include <rcu.hpp>
+#include <sync.hpp>
+
+namespace xino::rcu {
+
+/** @brief `qs_seq` of a CPU in an extended quiescent state. */
+static constexpr std::uint64_t extended_qs{~std::uint64_t{0}};
+
+struct rcu_data {
+  std::uint64_t qs_seq; // Last gp_requested seen in a quiescent state.
+  rcu_head *next_list;  // Callbacks waiting for a grace period to start.
+  rcu_head *wait_list;  // Callbacks waiting for wait_gp to complete.
+  std::uint64_t wait_gp;
+};
+
+// All CPUs start offline.
+[[gnu::used, gnu::section(".percpu_aligned")]]
+constinit xino::percpu::hot<rcu_data> rcu_pcpu{{extended_qs}};
+
+__cacheline_aligned constinit static std::uint64_t gp_requested{0};
+__cacheline_aligned constinit static std::uint64_t gp_completed{0};
+
+/** @brief Request a new grace period; returns its number. */
+static std::uint64_t gp_start() {
+  // Full barrier: prior unpublishing stores are ordered before the request.
+  return __atomic_add_fetch(&gp_requested, 1, __ATOMIC_SEQ_CST);
+}
+
+static bool gp_pending() {
+  return __atomic_load_n(&gp_completed, __ATOMIC_RELAXED) <
+         __atomic_load_n(&gp_requested, __ATOMIC_RELAXED);
+}
+
+static void note_qs(rcu_data &d) {
+  // Acquire: a grace period observed here has its updates visible to the
+  // read-side sections that follow. Release: those that precede, happen
+  // before the report.
+  __atomic_store_n(&d.qs_seq, __atomic_load_n(&gp_requested, __ATOMIC_ACQUIRE),
+                   __ATOMIC_RELEASE);
+}
+
+static void report_qs(rcu_data &d) {
+  // An idle or offline CPU stays out of grace periods.
+  if (__atomic_load_n(&d.qs_seq, __ATOMIC_RELAXED) != extended_qs)
+    note_qs(d);
+}
+
+/** @brief Complete grace periods that every CPU has passed. */
+static void gp_advance() {
+  const std::uint64_t req{__atomic_load_n(&gp_requested, __ATOMIC_ACQUIRE)};
+  std::uint64_t done{req};
+
+  xino::percpu::for_each_cpu(rcu_pcpu, [&](unsigned, rcu_data &d) {
+    const std::uint64_t s{__atomic_load_n(&d.qs_seq, __ATOMIC_ACQUIRE)};
+    if (s < done)
+      done = s;
+  });
+
+  std::uint64_t cur{__atomic_load_n(&gp_completed, __ATOMIC_RELAXED)};
+  while (cur < done)
+    if (__atomic_compare_exchange_n(&gp_completed, &cur, done, true,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+      xino::cpu::sev(); // Wake synchronize_rcu() waiters.
+      break;
+    }
+}
+
+static void invoke_callbacks(rcu_head *h) {
+  while (h != nullptr) {
+    rcu_head *const next{h->next};
+    h->func(h);
+    h = next;
+  }
+}
+
+void rcu_quiescent_state() noexcept {
+  rcu_data &d{xino::percpu::this_cpu(rcu_pcpu)};
+
+  report_qs(d);
+
+  // This report may be the last one a grace period is waiting for.
+  if (gp_pending())
+    gp_advance();
+
+  // call_rcu() may run from IRQs on this CPU.
+  const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+
+  rcu_head *done{nullptr};
+  if (d.wait_list != nullptr &&
+      __atomic_load_n(&gp_completed, __ATOMIC_ACQUIRE) >= d.wait_gp) {
+    done = d.wait_list;
+    d.wait_list = nullptr;
+  }
+
+  // Everything queued since the last batch waits for one new grace period.
+  if (d.wait_list == nullptr && d.next_list != nullptr) {
+    d.wait_list = d.next_list;
+    d.next_list = nullptr;
+    d.wait_gp = gp_start();
+  }
+
+  xino::sync::irq_restore(f);
+
+  invoke_callbacks(done);
+}
+
+void rcu_idle_enter() noexcept {
+  rcu_data &d{xino::percpu::this_cpu(rcu_pcpu)};
+
+  __atomic_store_n(&d.qs_seq, extended_qs, __ATOMIC_RELEASE);
+  if (gp_pending())
+    gp_advance();
+}
+
+void rcu_idle_exit() noexcept {
+  rcu_data &d{xino::percpu::this_cpu(rcu_pcpu)};
+
+  note_qs(d);
+  // Full barrier: a grace period that saw this CPU idle has its request
+  // visible to the read-side sections that follow.
+  xino::barrier::smp_mb();
+}
+
+void call_rcu(rcu_head *head, void (*func)(rcu_head *)) noexcept {
+  head->func = func;
+
+  const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+
+  rcu_data &d{xino::percpu::this_cpu(rcu_pcpu)};
+  head->next = d.next_list;
+  d.next_list = head;
+
+  xino::sync::irq_restore(f);
+}
+
+void synchronize_rcu() noexcept {
+  const std::uint64_t target{gp_start()};
+  rcu_data &d{xino::percpu::this_cpu(rcu_pcpu)};
+
+  // The caller is quiescent while it waits; report it on every iteration so
+  // concurrent synchronize_rcu() callers wait for each other's requests.
+  for (;;) {
+    report_qs(d);
+    gp_advance();
+
+    if (__atomic_load_n(&gp_completed, __ATOMIC_ACQUIRE) >= target)
+      return;
+
+    xino::cpu::wfe();
+  }
+}
+
+} // namespace xino::rcu
@@ -1,9 +1,25 @@
 
-#include <allocator.hpp> // xino::allocator::boot_allocator
+#include <allocator.hpp> // xino::allocator::page_allocator
+#include <cache.hpp>
+#include <cache_maint.hpp>
 #include <cstdio>
 #include <cstdlib> // for std::malloc and ste::free
+#include <dma.hpp>
+#include <exception.hpp>
+#include <fdt.hpp>
+#include <klog.hpp>
+#include <mm_ioremap.hpp>
+#include <mm_memblock.hpp>
+#include <mm_paging.hpp>
 #include <mm_va_layout.hpp>
+#include <mm_vmalloc.hpp>
 #include <new>
+#include <percpu.hpp>
+#include <plat_gic.hpp>
+#include <plat_uart.hpp>
+#include <rcu.hpp>
+#include <smp.hpp>
+#include <trace.hpp>
 
 namespace xino::runtime {
 
@@ -45,9 +61,107 @@ static void deregister_eh_frames() {
 
 void main();
 
-extern "C" void ukernel_entry() {
+extern "C" void uart_remap();
+
+/** @brief Parse a hexadecimal string (optional `0x` prefix); zero on error. */
+static std::uintptr_t parse_hex(const char *s) noexcept {
+  std::uintptr_t v{0};
+
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    s += 2;
+
+  for (; *s != '\0'; s++) {
+    unsigned d;
+    if (*s >= '0' && *s <= '9')
+      d = *s - '0';
+    else if (*s >= 'a' && *s <= 'f')
+      d = *s - 'a' + 10;
+    else if (*s >= 'A' && *s <= 'F')
+      d = *s - 'A' + 10;
+    else
+      return 0;
+
+    v = (v << 4) | d;
+  }
+
+  return v;
+}
+
+/**
+ * @brief Find and index the DTB handed over by the bootloader.
+ *
+ * A Linux-style boot passes the DTB address in x0. U-Boot's `go` passes
+ * `argc` and `argv` instead, so the DTB address is expected as the first
+ * argument, e.g. `go ${xino_addr} ${fdtcontroladdr}`.
+ *
+ * Without a DTB, the uKernel keeps running on the build-time configuration.
+ */
+static void fdt_setup(std::uintptr_t x0, std::uintptr_t x1) noexcept {
+  // A small x0 is `argc`, not a DTB address.
+  if (x0 >= xino::mm::va_layout::granule_size()) {
+    if (xino::fdt::init(xino::mm::phys_addr{x0}) != xino::error_nr::ok)
+      return;
+  } else {
+    const auto argv{reinterpret_cast<const char *const *>(x1)};
+    if (x0 == 0 || argv == nullptr || argv[0] == nullptr)
+      return;
+
+    if (xino::fdt::init(xino::mm::phys_addr{parse_hex(argv[0])}) !=
+        xino::error_nr::ok)
+      return;
+  }
+
+  if (xino::fdt::memblock_setup() != xino::error_nr::ok)
+    xino::cpu::panic();
+}
+
+extern "C" void ukernel_entry(std::uintptr_t x0, std::uintptr_t x1) {
   /* uKernel has been relocated, and the boot allocator is functional. */
 
+  xino::percpu::percpu_bootstrap_init();
+  xino::exception::exception_init();
+  xino::cache::cache_init();
+  xino::mm::paging::init_paging();
+  xino::mm::memblock::reserve_image();
+  fdt_setup(x0, x1);
+  // Hand page allocation over to the main allocator once RAM is known.
+  if (xino::mm::memblock::memory.count() != 0 &&
+      xino::allocator::page_allocator.handoff() != xino::error_nr::ok)
+    xino::cpu::panic();
+  xino::mm::paging::kernel_page_table_init();
+  if (xino::mm::ioremap_init() != xino::error_nr::ok)
+    xino::cpu::panic();
+  if (xino::mm::vmalloc_init() != xino::error_nr::ok)
+    xino::cpu::panic();
+  // Nothing in the boot path needs the DMA pool; without it,
+  // alloc_coherent() and bounce buffers fail, but the rest still works.
+  if (xino::dma::dma_init() != xino::error_nr::ok)
+    xino::klog::log(xino::klog::level::warn, "dma: no DMA pool\n");
+  // Without a DTB, only the boot CPU is known.
+  unsigned ncpu{xino::fdt::nr_cpus() != 0 ? xino::fdt::nr_cpus() : 1};
+  if (ncpu > xino::smp::nr_cpus_max)
+    ncpu = xino::smp::nr_cpus_max;
+  if (xino::percpu::percpu_init(ncpu) != xino::error_nr::ok)
+    xino::cpu::panic();
+#ifdef UKERNEL_TRACE
+  if (xino::trace::trace_init() != xino::error_nr::ok)
+    xino::klog::log(xino::klog::level::warn, "trace: no memory for rings\n");
+#endif
+  xino::rcu::rcu_cpu_online();
+  uart_remap();
+  if (xino::plat::gic::init() != xino::error_nr::ok ||
+      xino::plat::gic::cpu_init() != xino::error_nr::ok)
+    xino::cpu::panic();
+  // Without a TX interrupt, the console stays polled.
+  (void)xino::plat::uart::tx_async_init();
+  if (xino::smp::smp_init() != xino::error_nr::ok)
+    xino::cpu::panic();
+  xino::klog::klog_init();
+  xino::smp::smp_cpu_online();
+  xino::klog::klog_cpu_online();
+  xino::cpu::daifclr::write<xino::cpu::daifclr::flags::irq>();
+  xino::smp::smp_boot_secondaries();
+
   register_eh_frames();
   run_init_array();
   main();
@@ -132,7 +246,7 @@ void operator delete[](void *ptr, std::size_t sz,
 namespace xino::runtime {
 
 /** @brief State of uKernel mapping: [true] established, [false]: identity. */
-constinit bool use_mapping{};
+__read_mostly constinit bool use_mapping{};
 
 /* malloc()-family allocator; see c_shim/src.malloc.c. */
 
@@ -140,7 +254,7 @@ constinit bool use_mapping{};
  * @brief Allocate a physically-contiguous pages and return a kernel VA.
  *
  * This is a C-ABI wrapper intended for a malloc()-family page allocator hook.
- * It requests `2^order` contiguous pages from the boot allocator and converts
+ * It requests `2^order` contiguous pages from the page allocator and converts
  * the resulting physical address to a kernel virtual address using the current
  * global translation policy (`use_mapping`).
  *
@@ -150,7 +264,7 @@ constinit bool use_mapping{};
  */
 extern "C" void *alloc_page(unsigned order) {
   xino::mm::phys_addr pa{
-      xino::allocator::boot_allocator.alloc_pages(xino::nothrow, order)};
+      xino::allocator::page_allocator.alloc_pages(xino::nothrow, order)};
 
   if (pa == xino::mm::phys_addr{0})
     return NULL;
@@ -178,7 +292,7 @@ extern "C" void free_page(void *va, unsigned order) {
       xino::mm::va_layout::virt_to_phys(xino::mm::virt_addr{va}, use_mapping)};
 
   if (pa.has_value())
-    xino::allocator::boot_allocator.free_pages(pa.value(), order);
+    xino::allocator::page_allocator.free_pages(pa.value(), order);
 }
 
 } // namespace xino::runtime
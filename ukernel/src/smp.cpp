@@ -0,0 +1,376 @@
+#include <cache.hpp>
+#include <cache_maint.hpp>
+#include <config.h> // for UKERNEL_SMP and UKERNEL_STACK_SIZE
+#include <cpu.hpp>
+#include <cstddef> // for offsetof
+#include <cstdlib> // for std::aligned_alloc and std::free
+#include <exception.hpp>
+#include <fdt.hpp>
+#include <klog.hpp>
+#include <mm_paging.hpp>
+#include <mm_va_layout.hpp>
+#include <percpu.hpp>
+#include <plat_gic.hpp>
+#include <plat_uart.hpp>
+#include <psci.hpp>
+#include <rcu.hpp>
+#include <smp.hpp>
+#include <sync.hpp>
+
+namespace xino::smp {
+
+/** @brief SGI used for function calls. */
+static constexpr unsigned sgi_call_function{0};
+
+/** @brief Affinity fields of `MPIDR_EL1` (Aff3, Aff2, Aff1 and Aff0). */
+static constexpr std::uint64_t affinity_mask{0xff00ffffffUL};
+
+static constexpr unsigned csd_locked{1U << 0}; // Queued or running.
+static constexpr unsigned csd_sync{1U << 1};   // Unlock after fn returns.
+
+/** @brief Call descriptor; owned by the sender, one per target CPU. */
+struct call_data {
+  call_data *next;
+  smp_call_func_t fn;
+  void *arg;
+  unsigned flags;
+};
+
+__read_mostly constinit static std::uint64_t mpidrs[nr_cpus_max]{};
+
+/** @brief Per-CPU array of `nr_cpu_ids()` descriptors, see alloc_percpu(). */
+__read_mostly constinit static call_data *csd_pcpu{nullptr};
+
+__cacheline_aligned constinit static cpumask online{};
+
+/** @brief Calls queued for this CPU, most recent first. */
+[[gnu::used, gnu::section(".percpu")]]
+constinit xino::percpu::var<call_data *> call_queue{};
+
+[[gnu::used, gnu::section(".percpu")]]
+constinit xino::percpu::var<std::uint64_t> call_ipis{};
+
+/** @brief Wait until the target is done with @p c. */
+static void csd_lock_wait(const call_data &c) {
+  xino::cpu::sevl();
+  while (__atomic_load_n(&c.flags, __ATOMIC_ACQUIRE) & csd_locked)
+    xino::cpu::wfe();
+}
+
+static void csd_unlock(call_data &c) {
+  // Release: the call (or the copy of fn and arg) is done before reuse.
+  __atomic_store_n(&c.flags, 0, __ATOMIC_RELEASE);
+  xino::cpu::sev();
+}
+
+/** @brief Queue @p c on @p cpu; returns whether the queue was empty. */
+static bool queue_push(unsigned cpu, call_data &c) {
+  call_data **const head{&xino::percpu::per_cpu(call_queue, cpu)};
+
+  call_data *first{__atomic_load_n(head, __ATOMIC_RELAXED)};
+  do
+    c.next = first;
+  while (!__atomic_compare_exchange_n(head, &first, &c, true, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED));
+
+  return first == nullptr;
+}
+
+static void call_function_ipi(unsigned, void *) {
+  xino::percpu::this_cpu_inc(call_ipis);
+
+  // Take the whole queue; senders that find it empty send a new SGI.
+  call_data *c{__atomic_exchange_n(&xino::percpu::this_cpu(call_queue),
+                                   nullptr, __ATOMIC_ACQUIRE)};
+
+  // Restore the queuing order.
+  call_data *list{nullptr};
+  while (c != nullptr) {
+    call_data *const next{c->next};
+    c->next = list;
+    list = c;
+    c = next;
+  }
+
+  while (list != nullptr) {
+    call_data &d{*list};
+    // The sender may reuse `d` as soon as it is unlocked.
+    list = d.next;
+
+    const smp_call_func_t fn{d.fn};
+    void *const arg{d.arg};
+
+    if (d.flags & csd_sync) {
+      fn(arg);
+      csd_unlock(d);
+    } else {
+      csd_unlock(d);
+      fn(arg);
+    }
+  }
+}
+
+xino::error_t smp_init() noexcept {
+  const unsigned n{xino::percpu::nr_cpu_ids()};
+  const std::uint64_t boot{xino::cpu::mpidr_el1::read() & affinity_mask};
+
+  // The boot CPU is 0; the others follow in DTB order.
+  mpidrs[0] = boot;
+  unsigned next{1};
+  xino::fdt::for_each_cpu_node([&](xino::fdt::node, std::uint64_t mpidr) {
+    mpidr &= affinity_mask;
+    if (mpidr != boot && next < n)
+      mpidrs[next++] = mpidr;
+  });
+
+  csd_pcpu = static_cast<call_data *>(
+      xino::percpu::alloc_percpu(sizeof(call_data) * n, alignof(call_data)));
+  if (csd_pcpu == nullptr)
+    return xino::error_nr::nomem;
+
+  xino::plat::gic::set_handler(sgi_call_function, call_function_ipi, nullptr);
+
+  return xino::error_nr::ok;
+}
+
+void smp_cpu_online() noexcept {
+  xino::plat::gic::enable(sgi_call_function);
+  online.set_atomic(xino::percpu::this_cpu_id());
+}
+
+std::uint64_t cpu_mpidr(unsigned cpu) noexcept {
+  return cpu < nr_cpus_max ? mpidrs[cpu] : 0;
+}
+
+unsigned cpu_index(std::uint64_t mpidr) noexcept {
+  const unsigned n{xino::percpu::nr_cpu_ids()};
+
+  mpidr &= affinity_mask;
+  for (unsigned cpu{0}; cpu < n && cpu < nr_cpus_max; cpu++)
+    if (mpidrs[cpu] == mpidr)
+      return cpu;
+
+  return ~0U;
+}
+
+cpumask cpu_online_mask() noexcept {
+  cpumask m{};
+  m.set_all(nr_cpus_max);
+
+  return m &= online;
+}
+
+std::uint64_t nr_call_ipis(unsigned cpu) noexcept {
+  return __atomic_load_n(&xino::percpu::per_cpu(call_ipis, cpu),
+                         __ATOMIC_RELAXED);
+}
+
+void smp_call_function_many(const cpumask &mask, smp_call_func_t fn,
+                            void *arg, bool wait) noexcept {
+  const unsigned self{xino::percpu::this_cpu_id()};
+  call_data *const csd{xino::percpu::this_cpu_ptr(csd_pcpu)};
+
+  cpumask targets{mask};
+  targets &= online;
+  targets.clear(self);
+
+  cpumask ipi{};
+  targets.for_each([&](unsigned cpu) {
+    call_data &c{csd[cpu]};
+
+    // The previous call to `cpu` (without wait) may still be queued.
+    csd_lock_wait(c);
+
+    c.fn = fn;
+    c.arg = arg;
+    c.flags = csd_locked | (wait ? csd_sync : 0);
+
+    if (queue_push(cpu, c))
+      ipi.set(cpu);
+  });
+
+  if (!ipi.empty())
+    xino::plat::gic::send_sgi(sgi_call_function, ipi);
+
+  if (wait)
+    targets.for_each([&](unsigned cpu) { csd_lock_wait(csd[cpu]); });
+}
+
+void smp_call_function_single(unsigned cpu, smp_call_func_t fn, void *arg,
+                              bool wait) noexcept {
+  if (cpu == xino::percpu::this_cpu_id()) {
+    const xino::sync::irq_flags_t f{xino::sync::irq_save()};
+    fn(arg);
+    xino::sync::irq_restore(f);
+    return;
+  }
+
+  if (cpu >= nr_cpus_max)
+    return;
+
+  cpumask m{};
+  m.set(cpu);
+  smp_call_function_many(m, fn, arg, wait);
+}
+
+/* Secondary CPUs. */
+
+/**
+ * @brief Boot record of a secondary CPU; layout shared with start.S.
+ *
+ * The secondary reads it with the MMU off, so it is cleaned to the PoC.
+ */
+struct alignas(UKERNEL_CACHE_LINE) secondary_boot {
+  // Boot CPU's EL2 translation regime.
+  std::uint64_t hcr;
+  std::uint64_t mair;
+  std::uint64_t tcr;
+  std::uint64_t ttbr0;
+  std::uint64_t sctlr;
+
+  std::uint64_t stack; // Initial SP.
+  unsigned cpu;
+  unsigned state;
+};
+
+static_assert(offsetof(secondary_boot, sctlr) == 32);
+static_assert(offsetof(secondary_boot, stack) == 40);
+
+static constexpr unsigned boot_pending{0};
+static constexpr unsigned boot_online{1};
+static constexpr unsigned boot_failed{2};
+
+extern "C" {
+/* See start.S. */
+extern char secondary_start[];
+}
+
+/** @brief Serializes the per-CPU feature discovery into shared state. */
+__cacheline_aligned constinit static xino::sync::spin_lock cpu_init_lock{
+    "cpu_init"};
+
+static void boot_report(secondary_boot &b, unsigned state) {
+  __atomic_store_n(&b.state, state, __ATOMIC_RELEASE);
+  xino::cpu::sev();
+}
+
+extern "C" [[noreturn]] void ukernel_secondary_entry(secondary_boot *b) {
+  xino::percpu::percpu_cpu_online(b->cpu);
+  xino::exception::exception_init();
+
+  cpu_init_lock.lock();
+  xino::cache::cache_init();
+  xino::mm::paging::init_paging();
+  cpu_init_lock.unlock();
+
+  if (xino::plat::gic::cpu_init() != xino::error_nr::ok) {
+    boot_report(*b, boot_failed);
+    for (;;)
+      xino::cpu::wfi(); // IRQs stay masked.
+  }
+
+  xino::rcu::rcu_cpu_online();
+  smp_cpu_online();
+  xino::klog::klog_cpu_online();
+  boot_report(*b, boot_online);
+
+  cpu_idle();
+}
+
+void smp_boot_secondaries() noexcept {
+#ifdef UKERNEL_SMP
+  using namespace xino::cpu;
+
+  const unsigned n{xino::percpu::nr_cpu_ids()};
+  if (n <= 1)
+    return;
+
+  if (xino::psci::init() != xino::error_nr::ok) {
+    xino::klog::log(xino::klog::level::warn,
+                    "smp: no PSCI, running on the boot CPU only\n");
+    return;
+  }
+
+  const std::optional<xino::mm::phys_addr> entry{
+      xino::mm::va_layout::virt_to_phys(xino::mm::virt_addr{secondary_start},
+                                        xino::runtime::use_mapping)};
+
+  // Not freed: a late CPU may still read its record.
+  auto *const boot{static_cast<secondary_boot *>(
+      std::aligned_alloc(alignof(secondary_boot), sizeof(secondary_boot) * n))};
+  if (!entry.has_value() || boot == nullptr) {
+    xino::klog::log(xino::klog::level::err,
+                    "smp: can not start the secondary CPUs\n");
+    return;
+  }
+
+  // Start all the CPUs first; they come up in parallel.
+  for (unsigned cpu{1}; cpu < n; cpu++) {
+    secondary_boot &b{boot[cpu]};
+    b = {hcr_el2::read(), mair_el2::read(), tcr_el2::read(), ttbr0_el2::read(),
+         sctlr_el2::read(), 0, cpu, boot_pending};
+
+    void *const stack{std::aligned_alloc(16, UKERNEL_STACK_SIZE)};
+    const std::optional<xino::mm::phys_addr> pa{
+        xino::mm::va_layout::virt_to_phys(xino::mm::virt_addr{&b},
+                                          xino::runtime::use_mapping)};
+    if (stack == nullptr || !pa.has_value()) {
+      std::free(stack);
+      b.state = boot_failed;
+      continue;
+    }
+
+    b.stack = reinterpret_cast<std::uintptr_t>(stack) + UKERNEL_STACK_SIZE;
+    xino::cache::clean_dcache_range(xino::mm::virt_addr{&b}, sizeof(b));
+
+    if (xino::psci::cpu_on(cpu_mpidr(cpu), entry.value(),
+                           static_cast<xino::mm::phys_addr::value_type>(
+                               pa.value())) != xino::error_nr::ok) {
+      std::free(stack);
+      b.state = boot_failed;
+    }
+  }
+
+  const std::uint64_t deadline{cntvct_el0::read() + cntfrq_el0::read()};
+  unsigned online{1};
+
+  for (unsigned cpu{1}; cpu < n; cpu++) {
+    unsigned state;
+    while ((state = __atomic_load_n(&boot[cpu].state, __ATOMIC_ACQUIRE)) ==
+               boot_pending &&
+           cntvct_el0::read() < deadline) {
+      /* Spin. */
+    }
+
+    if (state == boot_online)
+      online++;
+    else
+      xino::klog::log(xino::klog::level::err,
+                      "smp: cpu%u (mpidr %#lx) did not come online\n", cpu,
+                      (unsigned long)cpu_mpidr(cpu));
+  }
+
+  xino::klog::log(xino::klog::level::info, "smp: %u of %u CPUs online\n",
+                  online, n);
+#endif
+}
+
+void cpu_idle() noexcept {
+  for (;;) {
+    // Help the console: flush the log and send queued text before sleeping.
+    xino::klog::flush();
+    xino::plat::uart::tx_kick();
+
+    // Wait with IRQs masked, so the IRQ is taken outside the extended
+    // quiescent state; `WFI` still wakes up.
+    xino::cpu::daifset::write<xino::cpu::daifset::flags::irq>();
+    xino::rcu::rcu_idle_enter();
+    xino::cpu::wfi();
+    xino::rcu::rcu_idle_exit();
+    xino::cpu::daifclr::write<xino::cpu::daifclr::flags::irq>();
+
+    xino::rcu::rcu_quiescent_state();
+  }
+}
+
+} // namespace xino::smp
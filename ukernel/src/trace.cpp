@@ -0,0 +1,85 @@
+#include <config.h>
+
+#ifdef UKERNEL_TRACE
+
+#include <cache.hpp>
+#include <cpu.hpp>
+#include <cpumask.hpp>
+#include <cstdio>
+#include <new>
+#include <percpu.hpp>
+#include <ring.hpp>
+#include <trace.hpp>
+
+namespace xino::trace {
+
+/** @brief Entries of one CPU. */
+using trace_ring = xino::sync::overwrite_ring<entry, nr_entries>;
+
+/** @brief Rings of CPUs `[0, nr_rings)`; set by trace_init(). */
+__read_mostly constinit static trace_ring *rings{};
+__read_mostly constinit static unsigned nr_rings{};
+
+void write(std::uint32_t id, const std::uint64_t *args,
+           std::uint32_t nr_args) noexcept {
+  const unsigned cpu{xino::percpu::this_cpu_id()};
+
+  // trace_init() sets `nr_rings` last; a CPU that sees it sees the array.
+  if (cpu >= __atomic_load_n(&nr_rings, __ATOMIC_ACQUIRE))
+    return;
+
+  trace_ring &r{__atomic_load_n(&rings, __ATOMIC_RELAXED)[cpu]};
+
+  std::uint64_t pos;
+  entry &e{r.reserve(pos)};
+
+  e.ts = xino::cpu::cntvct_el0::read();
+  e.id = id;
+  e.nr_args = nr_args;
+  for (std::uint32_t i{0}; i < nr_args; i++)
+    e.args[i] = args[i];
+
+  r.commit(e, pos);
+}
+
+xino::error_t trace_init() noexcept {
+  const unsigned n{xino::percpu::nr_cpu_ids()};
+  trace_ring *const rs{new (std::nothrow) trace_ring[n]{}};
+  if (rs == nullptr)
+    return xino::error_nr::nomem;
+
+  __atomic_store_n(&rings, rs, __ATOMIC_RELEASE);
+  __atomic_store_n(&nr_rings, n, __ATOMIC_RELEASE);
+
+  return xino::error_nr::ok;
+}
+
+void dump() noexcept {
+  const unsigned n{__atomic_load_n(&nr_rings, __ATOMIC_ACQUIRE)};
+
+  // Format version, timer frequency and CPUs; see tools/xino_trace.py.
+  printf("xino-trace: v1 %lu %u\n",
+         (unsigned long)xino::cpu::cntfrq_el0::read(), n);
+
+  for (unsigned cpu{0}; cpu < n; cpu++) {
+    const trace_ring &r{rings[cpu]};
+    const std::uint64_t head{r.load_head()};
+
+    for (std::uint64_t pos{r.first(head)}; pos < head; pos++) {
+      entry e;
+      if (!r.read(pos, e))
+        continue;
+
+      printf("xino-trace: %u %lx %x", cpu, (unsigned long)e.ts, e.id);
+      for (std::uint32_t i{0}; i < e.nr_args && i < max_args; i++)
+        printf(" %lx", (unsigned long)e.args[i]);
+      printf("\n");
+    }
+  }
+
+  printf("xino-trace: end\n");
+}
+
+} // namespace xino::trace
+
+#endif // UKERNEL_TRACE